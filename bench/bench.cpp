@@ -0,0 +1,348 @@
+#include <trigger-generator.h>
+#include <collected-set.h>
+#include <converter.h>
+#include <thread-pool.h>
+#include <trigger-index.h>
+#include <trigger-selection.h>
+#include <trigger-table.h>
+#include <binary-io/platform-traits.h>
+
+#include <QFile>
+#include <QString>
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+	using Platform = ConverterOptions::Platform;
+
+	struct Settings
+	{
+		int triggerCount = 100000;
+		int repetitions = 5;
+		int threadCount = 0;
+		std::string filter; // Only benchmarks whose name contains this are run
+	};
+
+	void showUsage()
+	{
+		std::cout << "Usage: TriggersToGLTF_bench [options]\n"
+			<< "       TriggersToGLTF_bench --generate <platform> <trigger count> <output file> [output savegame]\n\n"
+			<< "Runs each benchmark on a generated triggers resource and reports triggers per second.\n"
+			<< "Generated resources only depend on the trigger count.\n\n"
+			<< "Options:\n"
+			<< " -n   Number of triggers to generate. Default: 100000\n"
+			<< " -r   Number of timed runs of each benchmark, after one warm-up run. Default: 5\n"
+			<< " -j   Number of worker threads for conversion. Default: one per hardware thread\n"
+			<< " -b   Only run benchmarks whose name contains this text";
+	}
+
+	bool parsePlatform(const char* name, Platform& platform)
+	{
+		const char* names[] = { "PS3", "X360", "PC", "PS4", "NX" };
+		for (int i = 0; i < 5; ++i)
+		{
+			if (strcmp(name, names[i]) == 0)
+			{
+				platform = (Platform)i;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool writeFile(const QString& fileName, const QByteArray& data)
+	{
+		QFile file(fileName);
+		return file.open(QIODevice::WriteOnly | QIODevice::Truncate) && file.write(data) == data.size();
+	}
+
+	// Times repeated runs of a benchmark after a warm-up run and prints the median and best
+	void run(const Settings& settings, const std::string& name, qint64 triggerCount, const std::function<void()>& function)
+	{
+		if (name.find(settings.filter) == std::string::npos)
+			return;
+
+		function();
+		std::vector<double> seconds;
+		for (int i = 0; i < settings.repetitions; ++i)
+		{
+			auto start = std::chrono::steady_clock::now();
+			function();
+			seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+		std::sort(seconds.begin(), seconds.end());
+		double median = seconds[seconds.size() / 2];
+
+		std::cout << std::left << std::setw(32) << name << std::right << std::fixed << std::setprecision(3)
+			<< std::setw(12) << median * 1000.0
+			<< std::setw(12) << seconds.front() * 1000.0
+			<< std::setw(16) << std::setprecision(0) << triggerCount / median << "\n";
+	}
+
+	template <typename Traits>
+	void readTriggerData(const QByteArray& data, TriggerData& triggerData, uint16_t sections = TriggerData::allSections)
+	{
+		MappedStream<Traits> stream((const uchar*)data.constData(), data.size());
+		triggerData.read(stream, sections);
+		if (stream.status() != QDataStream::Ok)
+			throw std::runtime_error("Generated resource failed to parse");
+	}
+
+	// Parses each resource layout
+	void benchRead(const Settings& settings, TriggerGenerator& generator)
+	{
+		struct Layout
+		{
+			const char* name;
+			Platform platform;
+			void (*read)(const QByteArray&, TriggerData&, uint16_t);
+		} layouts[] = {
+			{ "read PC", Platform::PC, readTriggerData<PCTraits> },
+			{ "read PS3/X360", Platform::PS3, readTriggerData<BigEndian32Traits> },
+			{ "read PS4/NX", Platform::PS4, readTriggerData<LittleEndian64Traits> }
+		};
+
+		for (const Layout& layout : layouts)
+		{
+			QByteArray data = generator.write(layout.platform);
+			run(settings, layout.name, generator.getTriggerCount(), [&]()
+			{
+				TriggerData triggerData;
+				layout.read(data, triggerData, TriggerData::allSections);
+			});
+		}
+
+		// Filtered exports only read generic regions
+		QByteArray data = generator.write(Platform::PC);
+		run(settings, "read PC generic regions", generator.getTriggerCount(), [&]()
+		{
+			TriggerData triggerData;
+			readTriggerData<PCTraits>(data, triggerData, (uint16_t)TriggerData::Section::genericRegions);
+		});
+	}
+
+	// Builds the trigger index and checks every TriggerRegion the way the converter does
+	void benchIndex(const Settings& settings, TriggerGenerator& generator)
+	{
+		QByteArray data = generator.write(Platform::PC);
+		TriggerData triggerData;
+		readTriggerData<PCTraits>(data, triggerData);
+
+		TriggerIndex index;
+		run(settings, "index build", generator.getTriggerCount(), [&]()
+		{
+			index.build(triggerData);
+		});
+
+		// Same categories as Converter::triggerRegionExists()
+		uint8_t regionCategories = (uint8_t)TriggerIndex::Category::landmark
+			| (uint8_t)TriggerIndex::Category::blackspot
+			| (uint8_t)TriggerIndex::Category::vfxBoxRegion
+			| (uint8_t)TriggerIndex::Category::genericRegion;
+		uint8_t genericRegionCategories = (uint8_t)TriggerIndex::Category::landmark
+			| (uint8_t)TriggerIndex::Category::blackspot
+			| (uint8_t)TriggerIndex::Category::vfxBoxRegion
+			| (uint8_t)TriggerIndex::Category::stuntElement
+			| (uint8_t)TriggerIndex::Category::killzoneTrigger;
+		volatile int found = 0;
+		run(settings, "triggerRegionExists", triggerData.regionCount + triggerData.genericRegionCount, [&]()
+		{
+			int count = 0;
+			for (int i = 0; i < triggerData.regionCount; ++i)
+				count += index.contains(triggerData.regions[i].id, regionCategories);
+			for (int i = 0; i < triggerData.genericRegionCount; ++i)
+				count += index.contains(triggerData.genericRegions[i].id, genericRegionCategories);
+			found = count;
+		});
+	}
+
+	// Builds the collected set of a savegame and checks every generic region against it
+	void benchSavegame(const Settings& settings, TriggerGenerator& generator)
+	{
+		QByteArray data = generator.write(Platform::PC);
+		TriggerData triggerData;
+		readTriggerData<PCTraits>(data, triggerData);
+
+		// Every other generic region is collected
+		CollectedSet collected;
+		run(settings, "savegame set build", triggerData.genericRegionCount, [&]()
+		{
+			collected.clear();
+			for (int i = 0; i < triggerData.genericRegionCount; i += 2)
+				collected.insert((uint64_t)triggerData.genericRegions[i].id);
+			collected.finalize();
+		});
+
+		volatile int found = 0;
+		run(settings, "savegame filter", triggerData.genericRegionCount, [&]()
+		{
+			int count = 0;
+			for (int i = 0; i < triggerData.genericRegionCount; ++i)
+			{
+				count += collected.contains((uint64_t)triggerData.genericRegions[i].id)
+					|| collected.contains((uint64_t)triggerData.genericRegions[i].groupId);
+			}
+			found = count;
+		});
+	}
+
+	// Builds the trigger table and evaluates a selection over it
+	void benchSelect(const Settings& settings, TriggerGenerator& generator)
+	{
+		QByteArray data = generator.write(Platform::PC);
+		TriggerData triggerData;
+		readTriggerData<PCTraits>(data, triggerData);
+
+		TriggerTable table;
+		table.build(triggerData);
+		run(settings, "selection table build", table.size(), [&]()
+		{
+			table.build(triggerData);
+		});
+
+		TriggerSelection selection;
+		std::string error;
+		if (!selection.parse("type=jump,smash,signatureCrash and oneWay=0 or kind=landmark district=1..3", error))
+			throw std::runtime_error(error);
+		volatile uint64_t found = 0;
+		run(settings, "selection evaluate", table.size(), [&]()
+		{
+			std::vector<uint64_t> selected = selection.evaluate(table);
+			found = selected.empty() ? 0 : selected[0];
+		});
+	}
+
+	// Converts whole files, from reading the resource to writing the glTF
+	void benchConvert(const Settings& settings, TriggerGenerator& generator, ThreadPool& pool)
+	{
+		QTemporaryDir dir;
+		if (!dir.isValid())
+			throw std::runtime_error("Failed to create a temporary directory");
+		QString inFileName = dir.filePath("TRIGGERS.DAT");
+		QString profileFileName = dir.filePath("BurnoutPR0.dat");
+		if (!writeFile(inFileName, generator.write(Platform::PC))
+			|| !writeFile(profileFileName, generator.writeProfile(Platform::PC)))
+			throw std::runtime_error("Failed to write the generated files");
+
+		struct Conversion
+		{
+			const char* name;
+			const char* outFileName;
+			QStringList args;
+		} conversions[] = {
+			{ "convert nodes glTF", "nodes.gltf", { "-m", "nodes" } },
+			{ "convert nodes GLB", "nodes.glb", { "-m", "nodes" } },
+			{ "convert instanced glTF", "instanced.gltf", { "-m", "instanced" } },
+			{ "convert instanced GLB", "instanced.glb", { "-m", "instanced" } },
+			{ "convert metadata glTF", "metadata.gltf", { "-m", "metadata" } },
+			{ "convert metadata GLB", "metadata.glb", { "-m", "metadata" } },
+			{ "convert savegame filter", "collectibles.gltf", { "-f", "9", "-s", profileFileName } }
+		};
+
+		for (const Conversion& conversion : conversions)
+		{
+			ConverterOptions options;
+			std::ostringstream err;
+			if (options.parse(conversion.args, err) != 0)
+				throw std::runtime_error(err.str());
+			options.setFiles(inFileName.toStdString(), dir.filePath(conversion.outFileName).toStdString());
+
+			run(settings, conversion.name, generator.getTriggerCount(), [&]()
+			{
+				Converter converter(options, err, &pool);
+				if (converter.result != 0)
+					throw std::runtime_error(err.str());
+			});
+		}
+	}
+
+	int generate(int argc, char* argv[])
+	{
+		Platform platform;
+		if (argc < 5 || !parsePlatform(argv[2], platform))
+		{
+			showUsage();
+			return 1;
+		}
+
+		TriggerGenerator generator(atoi(argv[3]));
+		if (!writeFile(QString::fromLocal8Bit(argv[4]), generator.write(platform))
+			|| (argc > 5 && !writeFile(QString::fromLocal8Bit(argv[5]), generator.writeProfile(platform))))
+		{
+			std::cerr << "Failed to write output file";
+			return 6;
+		}
+
+		std::cout << "Generated " << generator.getTriggerCount() << " triggers";
+		return 0;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1 && strcmp(argv[1], "--generate") == 0)
+		return generate(argc, argv);
+
+	Settings settings;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (i + 1 >= argc)
+		{
+			showUsage();
+			return 1;
+		}
+
+		if (strcmp(argv[i], "-n") == 0)
+			settings.triggerCount = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "-r") == 0)
+			settings.repetitions = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "-j") == 0)
+			settings.threadCount = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "-b") == 0)
+			settings.filter = argv[i + 1];
+		else
+		{
+			showUsage();
+			return 1;
+		}
+		i++;
+	}
+	if (settings.triggerCount <= 0 || settings.repetitions <= 0)
+	{
+		showUsage();
+		return 1;
+	}
+
+	TriggerGenerator generator(settings.triggerCount);
+	ThreadPool pool(settings.threadCount);
+	std::cout << generator.getTriggerCount() << " triggers, " << pool.getThreadCount() << " threads, "
+		<< settings.repetitions << " runs\n\n"
+		<< std::left << std::setw(32) << "Benchmark" << std::right
+		<< std::setw(12) << "Median ms" << std::setw(12) << "Best ms" << std::setw(16) << "Triggers/s" << "\n";
+
+	try
+	{
+		benchRead(settings, generator);
+		benchIndex(settings, generator);
+		benchSavegame(settings, generator);
+		benchSelect(settings, generator);
+		benchConvert(settings, generator, pool);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what();
+		return 7;
+	}
+
+	return 0;
+}
@@ -0,0 +1,460 @@
+#include <trigger-generator.h>
+#include <binary-io/platform-traits.h>
+
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	const float pi = 3.14159265f;
+
+	// Share of the triggers in each category, in percent. Generic regions make up the rest
+	const int landmarkShare = 4;
+	const int signatureStuntShare = 1;
+	const int killzoneShare = 1;
+	const int blackspotShare = 1;
+	const int vfxBoxRegionShare = 1;
+	const int roamingLocationShare = 3;
+	const int spawnLocationShare = 3;
+	const int otherRegionShare = 2;
+
+	const int stuntElementsPerStunt = 3;
+	const int triggersPerKillzone = 3;
+	const int regionIdsPerKillzone = 2;
+
+	int share(int triggerCount, int percent)
+	{
+		return std::max(1, triggerCount * percent / 100);
+	}
+
+	// Writes values in the byte order and pointer width of a resource layout
+	template <typename Traits>
+	class ResourceWriter
+	{
+	public:
+		ResourceWriter(qint64 size) : data(size, 0) {}
+
+		template <typename T>
+		ResourceWriter& operator<<(T value)
+		{
+			if constexpr (std::is_enum_v<T>)
+				return *this << (std::underlying_type_t<T>)value;
+			else if constexpr (std::is_same_v<T, float>)
+			{
+				quint32 bits;
+				memcpy(&bits, &value, sizeof(bits));
+				return *this << bits;
+			}
+			else
+			{
+				uchar* bytes = (uchar*)data.data() + offset;
+				if constexpr (Traits::byteOrder == QDataStream::BigEndian)
+					qToBigEndian(value, bytes);
+				else
+					qToLittleEndian(value, bytes);
+				offset += sizeof(T);
+				return *this;
+			}
+		}
+
+		void writePointer(qint64 target)
+		{
+			if constexpr (Traits::is64Bit)
+				*this << (quint64)target;
+			else
+				*this << (quint32)target;
+		}
+
+		// Vectors are padded to 16 bytes
+		void writeVector(const Vector3& vector)
+		{
+			*this << vector.x << vector.y << vector.z << 0.0f;
+		}
+
+		void writeTriggerRegion(const TriggerRegion& region)
+		{
+			const BoxRegion& box = region.boxRegion;
+			*this << box.positionX << box.positionY << box.positionZ
+				<< box.rotationX << box.rotationY << box.rotationZ
+				<< box.dimensionX << box.dimensionY << box.dimensionZ;
+			*this << region.id << region.regionIndex << region.type << region.unk0;
+		}
+
+		void seek(qint64 offset) { this->offset = offset; }
+		void skip(qint64 length) { offset += length; }
+		void skipIf64(qint64 length) { offset += Traits::padIf64(length); }
+
+		QByteArray data;
+
+	private:
+		qint64 offset = 0;
+	};
+}
+
+TriggerGenerator::TriggerGenerator(int triggerCount, uint32_t seed)
+	: random(seed)
+{
+	landmarks.resize(share(triggerCount, landmarkShare));
+	signatureStunts.resize(share(triggerCount, signatureStuntShare));
+	killzones.resize(share(triggerCount, killzoneShare));
+	blackspots.resize(share(triggerCount, blackspotShare));
+	vfxBoxRegions.resize(share(triggerCount, vfxBoxRegionShare));
+	roamingLocations.resize(share(triggerCount, roamingLocationShare));
+	spawnLocations.resize(share(triggerCount, spawnLocationShare));
+	otherRegions.resize(share(triggerCount, otherRegionShare));
+	int genericRegionCount = triggerCount - (int)(landmarks.size() + signatureStunts.size() + killzones.size()
+		+ blackspots.size() + vfxBoxRegions.size() + roamingLocations.size() + spawnLocations.size() + otherRegions.size());
+	genericRegions.resize(std::max(stuntElementsPerStunt, genericRegionCount));
+
+	// Every fourth landmark has a starting grid
+	for (size_t i = 0; i < landmarks.size(); ++i)
+	{
+		Landmark& landmark = landmarks[i];
+		randomTriggerRegion(landmark, TriggerRegion::Type::landmark);
+		landmark.startingGridCount = i % 4 == 0 ? 1 : 0;
+		landmark.designIndex = (uint8_t)i;
+		landmark.district = (uint8_t)(random() % 5);
+		landmark.flags = (Landmark::Flags)(random() % 2);
+		for (int j = 0; j < landmark.startingGridCount; ++j)
+		{
+			StartingGrid grid;
+			for (int k = 0; k < 8; ++k)
+			{
+				grid.startingPositions[k] = randomPoint();
+				grid.startingDirections[k] = Vector3(0, uniform(-pi, pi), 0, true);
+			}
+			startingGrids.push_back(grid);
+		}
+	}
+
+	for (size_t i = 0; i < genericRegions.size(); ++i)
+	{
+		GenericRegion& region = genericRegions[i];
+		randomTriggerRegion(region, TriggerRegion::Type::genericRegion);
+		region.groupId = random() % 2 == 0 ? 0 : 500000 + (int32_t)(random() % 10000);
+		region.cameraCut1 = (int16_t)(random() % 100);
+		region.cameraCut2 = (int16_t)(random() % 100);
+		region.cameraType1 = (GenericRegion::StuntCameraType)(random() % 3);
+		region.cameraType2 = (GenericRegion::StuntCameraType)(random() % 3);
+		region.type = (GenericRegion::Type)(random() % 32);
+		region.isOneWay = (int8_t)(random() % 2);
+	}
+
+	// Stunt elements and killzone triggers are generic regions of the main array
+	for (size_t i = 0; i < signatureStunts.size(); ++i)
+	{
+		signatureStunts[i].id = 0x1000000000ull + i;
+		signatureStunts[i].camera = (int64_t)(random() % 1000);
+		signatureStunts[i].stuntElementCount = stuntElementsPerStunt;
+		stuntElements.emplace_back();
+		for (int j = 0; j < stuntElementsPerStunt; ++j)
+			stuntElements.back().push_back((int)(random() % genericRegions.size()));
+	}
+
+	for (size_t i = 0; i < killzones.size(); ++i)
+	{
+		killzones[i].triggerCount = triggersPerKillzone;
+		killzones[i].regionIdCount = regionIdsPerKillzone;
+		killzoneTriggers.emplace_back();
+		for (int j = 0; j < triggersPerKillzone; ++j)
+			killzoneTriggers.back().push_back((int)(random() % genericRegions.size()));
+		killzoneRegionIds.emplace_back();
+		for (int j = 0; j < regionIdsPerKillzone; ++j)
+			killzoneRegionIds.back().push_back(0x2000000000ull + random() % 10000);
+	}
+
+	for (Blackspot& blackspot : blackspots)
+	{
+		randomTriggerRegion(blackspot, TriggerRegion::Type::blackspot);
+		blackspot.scoreType = (Blackspot::ScoreType)(random() % 2);
+		blackspot.scoreAmount = (int32_t)(random() % 100000);
+	}
+
+	for (VFXBoxRegion& vfxBoxRegion : vfxBoxRegions)
+		randomTriggerRegion(vfxBoxRegion, TriggerRegion::Type::vfxBoxRegion);
+
+	for (RoamingLocation& location : roamingLocations)
+	{
+		location.position = randomPoint();
+		location.districtIndex = (uint8_t)(random() % 5);
+	}
+
+	for (SpawnLocation& location : spawnLocations)
+	{
+		location.position = randomPoint();
+		location.direction = Vector3(0, uniform(-pi, pi), 0, true);
+		location.junkyardId = 0x3000000000ull + random() % 100;
+		location.type = (SpawnLocation::Type)(random() % 4);
+	}
+
+	for (TriggerRegion& region : otherRegions)
+		randomTriggerRegion(region, (TriggerRegion::Type)(random() % 4));
+
+	this->triggerCount = (int)(landmarks.size() + signatureStunts.size() + genericRegions.size() + killzones.size()
+		+ blackspots.size() + vfxBoxRegions.size() + roamingLocations.size() + spawnLocations.size() + otherRegions.size());
+}
+
+// Writes the resource in the layout of a platform
+QByteArray TriggerGenerator::write(Platform platform)
+{
+	switch (platform)
+	{
+	case Platform::PS3:
+	case Platform::X360:
+		return write<BigEndian32Traits>();
+	case Platform::PS4:
+	case Platform::NX:
+		return write<LittleEndian64Traits>();
+	case Platform::PC:
+		break;
+	}
+	return write<PCTraits>();
+}
+
+template <typename Traits>
+QByteArray TriggerGenerator::write()
+{
+	// Arrays follow the header, each aligned to 16 bytes
+	qint64 end = TriggerData::recordSize<Traits>;
+	auto allocate = [&end](qint64 size)
+	{
+		qint64 offset = (end + 15) & ~(qint64)15;
+		end = offset + size;
+		return offset;
+	};
+	const qint64 pointerSize = Traits::pointerSize;
+	qint64 landmarkOffset = allocate(landmarks.size() * Landmark::recordSize<Traits>);
+	qint64 signatureStuntOffset = allocate(signatureStunts.size() * SignatureStunt::recordSize<Traits>);
+	qint64 genericRegionOffset = allocate(genericRegions.size() * GenericRegion::recordSize<Traits>);
+	qint64 killzoneOffset = allocate(killzones.size() * Killzone::recordSize<Traits>);
+	qint64 blackspotOffset = allocate(blackspots.size() * Blackspot::recordSize<Traits>);
+	qint64 vfxBoxRegionOffset = allocate(vfxBoxRegions.size() * VFXBoxRegion::recordSize<Traits>);
+	qint64 roamingLocationOffset = allocate(roamingLocations.size() * RoamingLocation::recordSize<Traits>);
+	qint64 spawnLocationOffset = allocate(spawnLocations.size() * SpawnLocation::recordSize<Traits>);
+	qint64 otherRegionOffset = allocate(otherRegions.size() * TriggerRegion::recordSize<Traits>);
+	int regionCount = (int)(landmarks.size() + genericRegions.size() + blackspots.size()
+		+ vfxBoxRegions.size() + otherRegions.size());
+	qint64 regionTableOffset = allocate(regionCount * pointerSize);
+	qint64 startingGridOffset = allocate(startingGrids.size() * StartingGrid::recordSize<Traits>);
+	qint64 stuntElementTableOffset = allocate(signatureStunts.size() * stuntElementsPerStunt * pointerSize);
+	qint64 killzoneTriggerTableOffset = allocate(killzones.size() * triggersPerKillzone * pointerSize);
+	qint64 killzoneRegionIdOffset = allocate(killzones.size() * regionIdsPerKillzone * sizeof(CgsID));
+
+	ResourceWriter<Traits> out(end);
+	auto genericRegionAt = [&](int index)
+	{
+		return genericRegionOffset + index * GenericRegion::recordSize<Traits>;
+	};
+
+	// Header, in the order TriggerData::read() expects
+	out << (int32_t)42 << (uint32_t)end;
+	out.skip(0x8);
+	out.writeVector(Vector3(0, 0, 0));
+	out.writeVector(Vector3(0, 0, 1));
+	out.writePointer(landmarkOffset);
+	out << (int32_t)landmarks.size() << (int32_t)landmarks.size();
+	out.writePointer(signatureStuntOffset);
+	out.skipIf64(0x4);
+	out << (int32_t)signatureStunts.size();
+	auto writeArray = [&out](qint64 offset, size_t count)
+	{
+		out.writePointer(offset);
+		out << (int32_t)count;
+		out.skipIf64(0x4);
+	};
+	writeArray(genericRegionOffset, genericRegions.size());
+	writeArray(killzoneOffset, killzones.size());
+	writeArray(blackspotOffset, blackspots.size());
+	writeArray(vfxBoxRegionOffset, vfxBoxRegions.size());
+	writeArray(roamingLocationOffset, roamingLocations.size());
+	writeArray(spawnLocationOffset, spawnLocations.size());
+	out.writePointer(regionTableOffset);
+	out << (int32_t)regionCount;
+
+	// Every TriggerRegion is listed in the region table, which sets its region index
+	qint64 regionPointer = regionTableOffset;
+	int16_t regionIndex = 0;
+	auto writeRegion = [&](TriggerRegion region, qint64 offset)
+	{
+		out.seek(regionPointer);
+		out.writePointer(offset);
+		regionPointer += pointerSize;
+		region.regionIndex = regionIndex++;
+		out.seek(offset);
+		out.writeTriggerRegion(region);
+	};
+
+	int gridIndex = 0;
+	for (size_t i = 0; i < landmarks.size(); ++i)
+	{
+		qint64 offset = landmarkOffset + i * Landmark::recordSize<Traits>;
+		writeRegion(landmarks[i], offset);
+		out.skipIf64(0x4);
+		out.writePointer(startingGridOffset + gridIndex * StartingGrid::recordSize<Traits>);
+		out << landmarks[i].startingGridCount << landmarks[i].designIndex << landmarks[i].district << landmarks[i].flags;
+
+		for (int j = 0; j < landmarks[i].startingGridCount; ++j, ++gridIndex)
+		{
+			out.seek(startingGridOffset + gridIndex * StartingGrid::recordSize<Traits>);
+			for (const Vector3& position : startingGrids[gridIndex].startingPositions)
+				out.writeVector(position);
+			for (const Vector3& direction : startingGrids[gridIndex].startingDirections)
+				out.writeVector(direction);
+		}
+	}
+
+	for (size_t i = 0; i < genericRegions.size(); ++i)
+	{
+		const GenericRegion& region = genericRegions[i];
+		writeRegion(region, genericRegionAt((int)i));
+		out << region.groupId << region.cameraCut1 << region.cameraCut2
+			<< region.cameraType1 << region.cameraType2 << region.type << region.isOneWay;
+	}
+
+	for (size_t i = 0; i < blackspots.size(); ++i)
+	{
+		writeRegion(blackspots[i], blackspotOffset + i * Blackspot::recordSize<Traits>);
+		out << blackspots[i].scoreType;
+		out.skip(0x3);
+		out << blackspots[i].scoreAmount;
+	}
+
+	for (size_t i = 0; i < vfxBoxRegions.size(); ++i)
+		writeRegion(vfxBoxRegions[i], vfxBoxRegionOffset + i * VFXBoxRegion::recordSize<Traits>);
+
+	for (size_t i = 0; i < otherRegions.size(); ++i)
+		writeRegion(otherRegions[i], otherRegionOffset + i * TriggerRegion::recordSize<Traits>);
+
+	for (size_t i = 0; i < signatureStunts.size(); ++i)
+	{
+		qint64 tableOffset = stuntElementTableOffset + i * stuntElementsPerStunt * pointerSize;
+		out.seek(signatureStuntOffset + i * SignatureStunt::recordSize<Traits>);
+		out << signatureStunts[i].id << signatureStunts[i].camera;
+		out.writePointer(tableOffset);
+		out << signatureStunts[i].stuntElementCount;
+
+		out.seek(tableOffset);
+		for (int element : stuntElements[i])
+			out.writePointer(genericRegionAt(element));
+	}
+
+	for (size_t i = 0; i < killzones.size(); ++i)
+	{
+		qint64 tableOffset = killzoneTriggerTableOffset + i * triggersPerKillzone * pointerSize;
+		qint64 regionIdOffset = killzoneRegionIdOffset + i * regionIdsPerKillzone * sizeof(CgsID);
+		out.seek(killzoneOffset + i * Killzone::recordSize<Traits>);
+		out.writePointer(tableOffset);
+		out << killzones[i].triggerCount;
+		out.skipIf64(0x4);
+		out.writePointer(regionIdOffset);
+		out << killzones[i].regionIdCount;
+
+		out.seek(tableOffset);
+		for (int trigger : killzoneTriggers[i])
+			out.writePointer(genericRegionAt(trigger));
+		out.seek(regionIdOffset);
+		for (CgsID id : killzoneRegionIds[i])
+			out << id;
+	}
+
+	for (size_t i = 0; i < roamingLocations.size(); ++i)
+	{
+		out.seek(roamingLocationOffset + i * RoamingLocation::recordSize<Traits>);
+		out.writeVector(roamingLocations[i].position);
+		out << roamingLocations[i].districtIndex;
+	}
+
+	for (size_t i = 0; i < spawnLocations.size(); ++i)
+	{
+		out.seek(spawnLocationOffset + i * SpawnLocation::recordSize<Traits>);
+		out.writeVector(spawnLocations[i].position);
+		out.writeVector(spawnLocations[i].direction);
+		out << spawnLocations[i].junkyardId << spawnLocations[i].type;
+	}
+
+	return out.data;
+}
+
+// Writes a savegame of a platform in which every other collectible is collected.
+// Only the stunt element lists read by the converter are filled in
+QByteArray TriggerGenerator::writeProfile(Platform platform)
+{
+	// Same offsets as Converter::readProfileTriggers()
+	int base = 0;
+	if (platform == Platform::X360)
+		base = 0x1C;
+	else if (platform == Platform::PC)
+		base = 0x1D246;
+	int stunts = base + 0x75E8;
+	const int alloc = 512;
+
+	// Jumps, smashes, and billboards, from the types of the collectible filters
+	std::vector<uint64_t> lists[3];
+	const GenericRegion::Type types[3] = {
+		GenericRegion::Type::smash,
+		GenericRegion::Type::signatureCrash,
+		GenericRegion::Type::overdriveStrength
+	};
+	int seen[3] = {};
+	for (const GenericRegion& region : genericRegions)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			if (region.type == types[i] && seen[i]++ % 2 == 0 && lists[i].size() < alloc)
+				lists[i].push_back((uint64_t)region.id);
+		}
+	}
+
+	// Large enough for the island offsets of every platform, without matching
+	// the size of the original PC release
+	QByteArray profile(0x80000, 0);
+	for (int i = 0; i < 3; ++i)
+	{
+		int listOffset = stunts + (alloc * 8 + 8) * i;
+		for (size_t j = 0; j < lists[i].size(); ++j)
+			qToLittleEndian(lists[i][j], (uchar*)profile.data() + listOffset + j * 8);
+		qToLittleEndian((int32_t)lists[i].size(), (uchar*)profile.data() + listOffset + alloc * 8);
+	}
+	return profile;
+}
+
+float TriggerGenerator::uniform(float min, float max)
+{
+	// Not std::uniform_real_distribution, whose output differs between standard libraries
+	return min + (max - min) * (float)(random() / 4294967296.0);
+}
+
+BoxRegion TriggerGenerator::randomBox()
+{
+	BoxRegion box;
+	Vector3 position = randomPoint();
+	box.positionX = position.x;
+	box.positionY = position.y;
+	box.positionZ = position.z;
+	box.rotationX = uniform(-pi, pi);
+	box.rotationY = uniform(-pi, pi);
+	box.rotationZ = uniform(-pi, pi);
+	box.dimensionX = uniform(1, 50);
+	box.dimensionY = uniform(1, 20);
+	box.dimensionZ = uniform(1, 50);
+	return box;
+}
+
+// Points are spread over an area the size of the game world
+Vector3 TriggerGenerator::randomPoint()
+{
+	float x = uniform(-4000, 4000);
+	float y = uniform(0, 300);
+	float z = uniform(-4000, 4000);
+	return Vector3(x, y, z, true);
+}
+
+void TriggerGenerator::randomTriggerRegion(TriggerRegion& region, TriggerRegion::Type type)
+{
+	region.boxRegion = randomBox();
+	region.id = nextId++;
+	region.type = type;
+	region.unk0 = (uint8_t)(random() % 2);
+}
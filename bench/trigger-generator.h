@@ -0,0 +1,56 @@
+#pragma once
+
+#include <converter.h>
+
+#include <QByteArray>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Generates synthetic TriggerData resources of any size for benchmarks.
+// The triggers only depend on the count and seed, so the same resource can be
+// written in every platform layout and runs are comparable across machines.
+class TriggerGenerator
+{
+public:
+	using Platform = ConverterOptions::Platform;
+
+	TriggerGenerator(int triggerCount, uint32_t seed = 1);
+
+	// Get the number of triggers generated, which may be slightly more than requested
+	int getTriggerCount() { return triggerCount; }
+
+	// Writes the resource in the layout of a platform
+	QByteArray write(Platform platform);
+
+	// Writes a savegame of a platform in which every other collectible is collected
+	QByteArray writeProfile(Platform platform);
+
+private:
+	template <typename Traits>
+	QByteArray write();
+
+	float uniform(float min, float max);
+	BoxRegion randomBox();
+	Vector3 randomPoint();
+	void randomTriggerRegion(TriggerRegion& region, TriggerRegion::Type type);
+
+	std::mt19937 random;
+	int triggerCount = 0;
+	int32_t nextId = 1000;
+
+	std::vector<Landmark> landmarks;
+	std::vector<StartingGrid> startingGrids; // In landmark order
+	std::vector<SignatureStunt> signatureStunts;
+	std::vector<std::vector<int>> stuntElements; // Generic region indices of each stunt
+	std::vector<GenericRegion> genericRegions;
+	std::vector<Killzone> killzones;
+	std::vector<std::vector<int>> killzoneTriggers; // Generic region indices of each killzone
+	std::vector<std::vector<CgsID>> killzoneRegionIds;
+	std::vector<Blackspot> blackspots;
+	std::vector<VFXBoxRegion> vfxBoxRegions;
+	std::vector<RoamingLocation> roamingLocations;
+	std::vector<SpawnLocation> spawnLocations;
+	std::vector<TriggerRegion> otherRegions; // Listed in the region table only
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <QtGlobal>
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+// A single block of memory that objects are allocated from in sequence.
+// Nothing is freed individually. The whole block is released at once when the
+// arena is reset or destroyed, so only trivially destructible types may be allocated.
+class Arena
+{
+public:
+	Arena();
+	~Arena();
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	// Frees the current block and allocates a new one of the specified size
+	void reserve(qint64 size);
+
+	// Frees the current block
+	void reset();
+
+	// Get the size of the current block
+	qint64 capacity();
+
+	// Get the number of bytes allocated from the current block
+	qint64 used();
+
+	// Get the number of bytes needed to allocate count objects of type T
+	template <typename T>
+	static constexpr qint64 sizeFor(qint64 count)
+	{
+		return (count * (qint64)sizeof(T) + alignment - 1) & ~(alignment - 1);
+	}
+
+	// Allocates count value-initialized objects of type T
+	// Returns nullptr if count is not positive or the block is exhausted
+	template <typename T>
+	T* allocate(qint64 count)
+	{
+		static_assert(std::is_trivially_destructible_v<T>, "Arena objects are never destroyed");
+		static_assert(alignof(T) <= alignment);
+
+		if (count <= 0 || offset + sizeFor<T>(count) > size)
+			return nullptr;
+
+		T* entries = (T*)(block + offset);
+		offset += sizeFor<T>(count);
+		std::uninitialized_value_construct_n(entries, count);
+		return entries;
+	}
+
+private:
+	static constexpr qint64 alignment = 16;
+
+	std::byte* block = nullptr;
+	qint64 size = 0;
+	qint64 offset = 0;
+};
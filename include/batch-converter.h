@@ -0,0 +1,53 @@
+#pragma once
+
+#include <converter.h>
+
+#include <QString>
+#include <QStringList>
+
+#include <string>
+#include <vector>
+
+// Converts many files in one process.
+// Inputs come from a manifest or a directory and are converted in parallel.
+// A file that fails to convert does not stop the others.
+class BatchConverter
+{
+public:
+	BatchConverter(int argc, char* argv[]);
+
+	int result = 0;
+
+	// A file to convert and its result
+	struct Job
+	{
+		ConverterOptions options;
+		int result = 0;
+		std::string error;
+	};
+
+	// Reads the files of a manifest or input directory, with outputs in an output directory.
+	// Manifest line options are parsed over the defaults. Returns 0 on success
+	static int readJobs(const QString& source, const QString& outDir, const ConverterOptions& defaults,
+		std::vector<Job>& jobs);
+
+private:
+	ConverterOptions defaults; // Options given on the command line
+	int threadCount = 0;
+	QString source;
+	QString outDir;
+	std::vector<Job> jobs;
+
+	const int minArgCount = 4;
+	int getArgs(int argc, char* argv[]);
+	void showUsage();
+
+	static int readManifest(const QString& source, const QString& outDir, const ConverterOptions& defaults,
+		std::vector<Job>& jobs);
+	static int readDirectory(const QString& source, const QString& outDir, const ConverterOptions& defaults,
+		std::vector<Job>& jobs);
+	static void setStatsPath(Job& job, const ConverterOptions& defaults, const QString& outputPath);
+	static QString getOutputPath(const QString& outDir, const QString& path);
+	static bool isInsideOutputDir(const QString& path);
+	void convert();
+};
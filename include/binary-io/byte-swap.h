@@ -0,0 +1,8 @@
+#pragma once
+
+#include <QtGlobal>
+
+// Copies count 32 bit words from src to dst, reversing the byte order of each.
+// Uses AVX2 or SSSE3 shuffles when the CPU supports them, with a scalar fallback.
+// src and dst do not need to be aligned.
+void byteSwap32(const uchar* src, void* dst, qsizetype count);
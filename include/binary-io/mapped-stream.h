@@ -0,0 +1,222 @@
+#pragma once
+
+#include <arena.h>
+#include <binary-io/platform-traits.h>
+
+#include <QDataStream>
+#include <QFile>
+
+#include <type_traits>
+
+// A file mapped into memory for reading.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Maps the specified file
+	// Returns false if the file could not be opened or mapped
+	bool open(const QString& fileName);
+
+	// Unmaps and closes the file
+	void close();
+
+	// Get the mapped bytes
+	const uchar* data();
+
+	// Get the size of the mapped bytes
+	qint64 size();
+
+private:
+	QFile file;
+	const uchar* bytes = nullptr;
+	qint64 length = 0;
+};
+
+// Read-only stream over mapped bytes in the resource layout described by Traits.
+// Provides the reading side of DataStream, but decodes values directly from memory
+// instead of going through QIODevice for every read and seek.
+template <typename Traits>
+class MappedStream
+{
+public:
+	MappedStream(const uchar* data, qint64 size)
+		: data(data), length(size)
+	{
+
+	}
+
+	// Get the stream status. Set to ReadPastEnd if any read or seek went out of bounds
+	QDataStream::Status status() { return readStatus; }
+
+	// Reads an integer, float, or enum from the stream
+	template <typename T>
+	friend MappedStream& operator>>(MappedStream& s, T& value) requires(std::is_arithmetic_v<T> || std::is_enum_v<T>)
+	{
+		const uchar* bytes = s.take(sizeof(T));
+		value = bytes != nullptr ? decode<Traits, T>(bytes) : T();
+		return s;
+	}
+
+	// Reads a pointer from the stream
+	template <typename T>
+	friend MappedStream& operator>>(MappedStream& s, T& ptr) requires(std::is_pointer_v<T>)
+	{
+		if constexpr (!Traits::is64Bit)
+		{
+			quint32 offset;
+			s >> offset;
+			ptr = (T)(quintptr)offset;
+		}
+		else
+		{
+			quint64 offset;
+			s >> offset;
+			ptr = (T)(quintptr)offset;
+		}
+		return s;
+	}
+
+	// Get the arena arrays are allocated from
+	Arena* getArena() { return arena; }
+
+	// Set the arena arrays are allocated from
+	void setArena(Arena* arena) { this->arena = arena; }
+
+	// Allocates from the arena and reads data from the stream using MappedStream's operator>>(MappedStream&, T&)
+	template <typename T>
+	void allocAndQtRead(T*& entries, int count)
+	{
+		seek((qint64)entries); // Seek to the offset in the stream
+		entries = allocate<T>(count, entrySize<T>());
+		if (entries == nullptr)
+			return;
+		for (int i = 0; i < count; ++i)
+			*this >> entries[i];
+	}
+
+	// Allocates from the arena and reads data from the stream using T's read(MappedStream&)
+	template <typename T>
+	void allocAndCustomRead(T*& entries, int count)
+	{
+		seek((qint64)entries); // Seek to the offset in the stream
+		entries = allocate<T>(count, T::template recordSize<Traits>);
+		if (entries == nullptr)
+			return;
+		for (int i = 0; i < count; ++i)
+			entries[i].read(*this);
+	}
+
+	// Reads a table of pointers to T, storing the entries they point to contiguously in the arena
+	// using T's read(MappedStream&). The stream is left after the pointer table.
+	template <typename T>
+	void allocAndIndirectRead(T*& entries, int count)
+	{
+		seek((qint64)entries); // Seek to the pointer table in the stream
+		entries = allocate<T>(count, Traits::pointerSize);
+		if (entries == nullptr)
+			return;
+		for (int i = 0; i < count; ++i)
+		{
+			T* entry;
+			*this >> entry;
+			qint64 nextPointer = pos();
+			seek((qint64)entry);
+			entries[i].read(*this);
+			seek(nextPointer);
+		}
+	}
+
+	// Returns the next length bytes and skips past them, or nullptr if they are out of bounds
+	// Lets fixed-size records be bounds checked once and decoded directly
+	const uchar* take(qint64 length)
+	{
+		if (offset + length > this->length)
+		{
+			readStatus = QDataStream::ReadPastEnd;
+			offset = this->length;
+			return nullptr;
+		}
+		const uchar* bytes = data + offset;
+		offset += length;
+		return bytes;
+	}
+
+	// Returns length bytes at an absolute offset without moving the stream,
+	// or nullptr if they are out of bounds. Does not affect the stream status.
+	const uchar* peek(qint64 offset, qint64 length)
+	{
+		if (offset < 0 || length < 0 || offset + length > this->length)
+			return nullptr;
+		return data + offset;
+	}
+
+	// Get the current offset the stream is reading from
+	qint64 pos() { return offset; }
+
+	// Get the size of the data
+	qint64 size() { return length; }
+
+	// Seeks to a specified offset in the data
+	void seek(qint64 offset)
+	{
+		if (offset < 0 || offset > length)
+		{
+			readStatus = QDataStream::ReadPastEnd;
+			this->offset = length;
+			return;
+		}
+		this->offset = offset;
+	}
+
+	// Skips a specified number of bytes in the stream
+	void skip(qint64 length) { seek(offset + length); }
+
+	// Skips a specified number of bytes in the stream if pointers are 64 bit
+	// Useful for 64 bit-only alignment
+	void skipIf64(qint64 length)
+	{
+		if constexpr (Traits::is64Bit)
+			skip(length);
+	}
+
+private:
+	// Get the size of a value read with operator>>
+	template <typename T>
+	static constexpr qint64 entrySize()
+	{
+		if constexpr (std::is_pointer_v<T>)
+			return Traits::pointerSize;
+		else
+			return sizeof(T);
+	}
+
+	// Allocates count entries of type T from the arena, after checking count entries of
+	// entrySize bytes each can be read from the current offset
+	template <typename T>
+	T* allocate(int count, qint64 entrySize)
+	{
+		if (count <= 0)
+			return nullptr;
+		if (readStatus != QDataStream::Ok || count * entrySize > length - offset)
+		{
+			readStatus = QDataStream::ReadPastEnd;
+			return nullptr;
+		}
+
+		T* entries = arena != nullptr ? arena->allocate<T>(count) : nullptr;
+		if (entries == nullptr)
+			readStatus = QDataStream::ReadCorruptData;
+		return entries;
+	}
+
+	const uchar* data = nullptr;
+	qint64 length = 0;
+	qint64 offset = 0;
+	QDataStream::Status readStatus = QDataStream::Ok;
+	Arena* arena = nullptr;
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <binary-io/byte-swap.h>
+
+#include <QDataStream>
+#include <QtEndian>
+
+#include <cstring>
+#include <type_traits>
+
+// Byte order and pointer width of a resource layout, known at compile time.
+// Parsers are instantiated once per layout so neither needs checking per field.
+template <QDataStream::ByteOrder Order, bool Is64Bit>
+struct PlatformTraits
+{
+	static constexpr QDataStream::ByteOrder byteOrder = Order;
+	static constexpr bool is64Bit = Is64Bit;
+	static constexpr qint64 pointerSize = Is64Bit ? 8 : 4;
+
+	// Returns length if pointers are 64 bit, otherwise 0
+	// Mirrors skipIf64 for use in constexpr layout sizes
+	static constexpr qint64 padIf64(qint64 length) { return Is64Bit ? length : 0; }
+};
+
+// PC
+typedef PlatformTraits<QDataStream::LittleEndian, false> PCTraits;
+
+// PS3 and X360
+typedef PlatformTraits<QDataStream::BigEndian, false> BigEndian32Traits;
+
+// PS4 and NX
+typedef PlatformTraits<QDataStream::LittleEndian, true> LittleEndian64Traits;
+
+// Decodes an integer, float, or enum from raw bytes in the layout's byte order
+template <typename Traits, typename T>
+T decode(const uchar* data) requires(std::is_arithmetic_v<T> || std::is_enum_v<T>)
+{
+	if constexpr (std::is_enum_v<T>)
+		return (T)decode<Traits, std::underlying_type_t<T>>(data);
+	else if constexpr (std::is_same_v<T, float>)
+	{
+		quint32 bits = decode<Traits, quint32>(data);
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+	else if constexpr (std::is_same_v<T, double>)
+	{
+		quint64 bits = decode<Traits, quint64>(data);
+		double value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+	else if constexpr (Traits::byteOrder == QDataStream::BigEndian)
+		return qFromBigEndian<T>(data);
+	else
+		return qFromLittleEndian<T>(data);
+}
+
+// Decodes a run of count consecutive floats from raw bytes in the layout's byte order
+// Big endian runs are byte swapped in bulk rather than one value at a time
+template <typename Traits>
+void decodeFloats(const uchar* data, float* values, qsizetype count)
+{
+	if constexpr (Traits::byteOrder == QDataStream::BigEndian)
+		byteSwap32(data, values, count);
+	else
+		memcpy(values, data, count * sizeof(float));
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Set of collected trigger IDs read from a savegame.
+// IDs are appended while reading, then sorted once so lookups are a branchless binary search.
+class CollectedSet
+{
+public:
+	// Adds an ID. Call finalize() after the last insert and before any lookup
+	void insert(uint64_t id) { ids.push_back(id); }
+
+	// Sorts and deduplicates the IDs
+	void finalize();
+
+	// Get whether an ID has been collected
+	bool contains(uint64_t id) const;
+
+	// Get the number of distinct IDs
+	int64_t size() const { return (int64_t)ids.size(); }
+
+	// Removes all IDs
+	void clear() { ids.clear(); }
+
+private:
+	std::vector<uint64_t> ids;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+// Stores finished outputs in a directory, keyed by a hash of everything they depend on.
+// Each entry is a directory named by its key, holding a manifest and the output files.
+// Entries are filled under a temporary name and then renamed into place, and the
+// cache is locked while entries are looked up, added, or evicted, so processes and
+// batch workers may share a cache. Entries being copied out are pinned, not locked.
+// Once the cache is larger than its limit, the least recently used entries are evicted.
+class ConversionCache
+{
+public:
+	ConversionCache(const QString& dir, qint64 maxSize);
+
+	// Copies the files of an entry to an output file, or into an output directory if
+	// tiled. outputFiles receives the paths written. Returns false on a miss
+	bool restore(const QByteArray& key, const QString& output, bool tiled, QStringList& outputFiles);
+
+	// Adds the files of an output as an entry. Returns false if it could not be added
+	bool store(const QByteArray& key, const QStringList& outputFiles);
+
+private:
+	void evict();
+
+	QString dir;
+	qint64 maxSize = 0;
+};
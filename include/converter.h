@@ -1,61 +1,261 @@
 #pragma once
 
 #include <binary-io/data-stream.h>
+#include <binary-io/mapped-stream.h>
+#include <collected-set.h>
+#include <gltf-stream-writer.h>
+#include <run-stats.h>
+#include <structural-metadata.h>
+#include <thread-pool.h>
+#include <tileset.h>
 #include <trigger-data.h>
+#include <trigger-index.h>
+#include <trigger-selection.h>
+#include <trigger-table.h>
 
 #include <tiny_gltf.h>
 
+#include <QByteArray>
 #include <QFile>
+#include <QStringList>
 
+#include <memory>
+#include <ostream>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 using namespace BrnTrigger;
 using namespace tinygltf;
 
+// Options for converting a single file
+struct ConverterOptions
+{
+	enum class Platform
+	{
+		PS3,
+		X360,
+		PC,
+		PS4,
+		NX
+	} platform = Platform::PC;
+
+	enum class ExportMode
+	{
+		nodes, // One node per trigger
+		instanced, // One EXT_mesh_gpu_instancing node per trigger category
+		metadata // One node per trigger, with attributes in EXT_structural_metadata property tables
+	} exportMode = ExportMode::nodes;
+
+	enum class TileMode
+	{
+		none, // One output file
+		grid, // Square tiles of tileSize on the X and Z axes
+		quadtree // Quadtree tiles of at most tileCapacity triggers
+	} tileMode = TileMode::none;
+	float tileSize = 0.0f;
+	int tileCapacity = 0;
+	bool split = false; // One output per trigger category and generic region type
+
+	std::string selection; // TriggerSelection expression. Every trigger is converted if empty
+	std::string profileFileName;
+	bool writeBinary = false;
+	std::string inFileName;
+	std::string outFileName; // A directory for tiled or split output
+	std::string statsFileName; // Receives a JSON report of the run if set
+	std::string cacheDir; // Outputs are cached here if set
+	qint64 cacheSize = 1024LL * 1024 * 1024; // Bytes the cache is limited to
+
+	// Parses options, leaving those not given unchanged. Returns 0 on success
+	int parse(const QStringList& args, std::ostream& err);
+
+	// Sets the input and output files. Binary glTF is written if the output has its extension
+	void setFiles(const std::string& in, const std::string& out);
+
+	// Get the extension of glTF files written with these options
+	const char* getGltfExtension() const { return writeBinary ? ".glb" : ".gltf"; }
+
+	// Get whether the output is a directory of files
+	bool writesDirectory() const { return tileMode != TileMode::none || split; }
+};
+
+// Parses the header and the sections in a mask of TriggerData::Section values of a
+// triggers resource in the layout of a platform. Returns the stream status
+QDataStream::Status parseTriggerResource(const uchar* data, qint64 size, ConverterOptions::Platform platform,
+	TriggerData& triggerData, uint16_t sections = TriggerData::allSections);
+
+// Reads the IDs of the stunt elements collected in a savegame in the layout of a
+// platform, then finalizes the set. Returns the stream status, which is not Ok if the
+// savegame is truncated or its counts don't fit the layout
+QDataStream::Status parseSavegame(const uchar* data, qint64 size, ConverterOptions::Platform platform,
+	CollectedSet& collected);
+
+// Maps and parses a triggers resource file. Returns 0 on success
+int readTriggerResource(const QString& fileName, ConverterOptions::Platform platform, TriggerData& triggerData,
+	std::ostream& err);
+
 class Converter
 {
 public:
 	Converter(int argc, char* argv[]);
+	// Converts a file using the workers of an existing pool.
+	// Without convert, only reads and selects the triggers, for exportSavegame()
+	Converter(const ConverterOptions& options, std::ostream& err, ThreadPool* pool, bool convert = true);
 	~Converter();
 
+	// Converts the file again after its input or savegame changed.
+	// The parsed input and its index are kept unless the input changed
+	void reconvert(bool inputChanged);
+
+	// Writes the triggers not collected in a savegame to a file of their own. Returns
+	// false if writing failed. Only reads the converter, so savegames may be exported
+	// on several threads
+	bool exportSavegame(const CollectedSet& collected, const QString& fileName, int& nodeCount);
+
+	// Get whether a generic region is a collectible, of type 8, 9 or 13
+	static bool isCollectible(const GenericRegion& region);
+
+	// Get whether a generic region is a collectible gathered in a savegame
+	static bool isCollected(const GenericRegion& region, const CollectedSet& collected);
+
 	int result = 0;
 
 private:
-	enum class Platform
+	using Platform = ConverterOptions::Platform;
+	using ExportMode = ConverterOptions::ExportMode;
+	using TileMode = ConverterOptions::TileMode;
+
+	ConverterOptions options;
+	std::ostream& err; // Receives error messages
+	std::unique_ptr<ThreadPool> ownedPool;
+	ThreadPool* pool = nullptr; // Converts nodes in parallel
+	RunStats stats;
+	QStringList outputFiles; // Files written by the conversion
+
+	// A node of the scene and the trigger it is converted from
+	struct SceneNode
 	{
-		PS3,
-		X360,
-		PC,
-		PS4,
-		NX
-	} platform = Platform::PC;
+		enum class Type : uint8_t
+		{
+			landmark, // Children are starting grids
+			blackspot,
+			vfxBoxRegion,
+			signatureStunt, // Children are stunt elements
+			killzone, // Children are triggers
+			genericRegion,
+			triggerRegion,
+			roamingLocation,
+			spawnLocation
+		} type;
+		int index = 0; // Index of the trigger, or of the parent for children
+		int childIndex = -1; // Index in the parent's array, -1 for root nodes
+		int childCount = 0; // Number of children, which directly follow the node
+	};
+
+	// Instance attributes of a trigger category
+	struct InstanceBatch
+	{
+		InstanceBatch(const std::string& name) : name(name) {}
+
+		std::string name;
+		std::vector<float> translations;
+		std::vector<float> rotationsX; // Euler angles, converted to quaternions when written
+		std::vector<float> rotationsY;
+		std::vector<float> rotationsZ;
+		std::vector<float> scales;
+		std::vector<uint32_t> ids;
+	};
+
+	// Receives the attributes of a trigger as node extras.
+	// Has the same interface as StructuralMetadata, so triggers list their attributes once
+	struct ExtrasFields
+	{
+		void beginFeature(const char*, const char*) {}
+
+		template <typename T>
+		void add(const char*, const char* name, T value)
+		{
+			if constexpr (std::is_same_v<T, bool>)
+				extras[name] = Value(value);
+			else
+				extras[name] = Value((int)value);
+		}
+
+		template <typename T>
+		void addArray(const char*, const char* name, const T* values, int count)
+		{
+			Value::Array array;
+			for (int i = 0; i < count; ++i)
+				array.push_back(Value((int)values[i]));
+			extras[name] = Value(array);
+		}
+
+		Value::Object extras;
+	};
 
 	// For file reading
-	DataStream inStream;
-	std::string inFileName;
-	std::string outFileName;
-	int8_t typeFilter = -1;
-	std::string profileFileName;
+	MappedFile inFile;
 
 	TriggerData* triggerData = nullptr;
-	QList<uint64_t> hitTriggerIds;
+	TriggerIndex triggerIndex;
+	CollectedSet hitTriggerIds;
+
+	// Triggers chosen with a selection
+	TriggerSelection selection;
+	TriggerTable triggerTable;
+	std::vector<uint64_t> selectedRows; // Bitmap of triggerTable rows
 
 	const int minArgCount = 3;
 	int getArgs(int argc, char* argv[]);
 	int checkArgs(int argc, char* argv[]);
+	int checkFiles();
 	void showUsage();
+	void run();
+	int convert();
+	int convertTriggers();
+	int readTriggers();
+	QByteArray getCacheKey();
+	void writeStats();
 
-	void readTriggerData();
-	void readProfileTriggers();
-	void readStuntElements(DataStream& stream, int offset, int count);
-	void readIslandStuntElements(DataStream& stream, int offset, int count);
-	Buffer createGLTFBuffer();
+	int readTriggerData();
+	void selectTriggers();
+	int readProfileTriggers();
+	QByteArray createGLTFBuffer();
 	void writeBoxRegion(DataStream& stream);
-	Vector4 EulerToQuatRot(Vector3 euler);
-	void convertTriggersToGLTF();
+	int convertTriggersToGLTF();
+	int convertTriggersToTiles();
+	int convertTriggersToSplit();
+	std::vector<Tileset::Item> getTileItems(const std::vector<SceneNode>& scene, std::vector<size_t>& itemStarts);
+	bool writeScene(const QString& fileName, const std::vector<SceneNode>& scene, int& nodeCount);
+	void addBoxMesh(GltfStreamWriter& writer);
+	void writeNodes(GltfStreamWriter& writer, const std::vector<SceneNode>& scene);
+	std::vector<SceneNode> planScene(const CollectedSet& collected);
+	bool getSceneNodeRotation(const SceneNode& sceneNode, Vector3& euler);
+	bool getSceneNodeTransform(const SceneNode& sceneNode, Vector3& position, Vector3& dimensions);
+	void convertSceneNode(const SceneNode& sceneNode, int nodeIndex, const float* rotation, Node& node);
+	template <typename Fields>
+	bool addSceneNodeFields(const SceneNode& sceneNode, Fields& fields);
+	void writeInstancedNodes(GltfStreamWriter& writer, const std::vector<SceneNode>& scene);
+	void writeInstancedNode(GltfStreamWriter& writer, const InstanceBatch& batch);
 
 	bool triggerRegionExists(TriggerRegion region, bool checkGenericRegions = true);
-	void addTriggerRegionFields(TriggerRegion region, Value::Object& extras);
+	template <typename Fields>
+	void addTriggerRegionFields(TriggerRegion region, Fields& fields);
+
+	template <typename Fields>
+	void addLandmarkFields(Landmark landmark, Fields& fields);
+	template <typename Fields>
+	void addBlackspotFields(Blackspot blackspot, Fields& fields);
+	template <typename Fields>
+	void addSignatureStuntFields(SignatureStunt signatureStunt, Fields& fields);
+	template <typename Fields>
+	void addKillzoneFields(Killzone killzone, Fields& fields);
+	template <typename Fields>
+	void addGenericRegionFields(GenericRegion region, Fields& fields);
+	template <typename Fields>
+	void addRoamingLocationFields(RoamingLocation location, Fields& fields);
+	template <typename Fields>
+	void addSpawnLocationFields(SpawnLocation location, Fields& fields);
 
 	void convertLandmark(Landmark landmark, Node& node, int index);
 	void convertStartingGrid(StartingGrid grid, Node& node, int index);
@@ -76,17 +276,6 @@ private:
 			entry.boxRegion.positionY,
 			entry.boxRegion.positionZ
 		};
-		Vector4 rotation = EulerToQuatRot({
-			entry.boxRegion.rotationX,
-			entry.boxRegion.rotationY,
-			entry.boxRegion.rotationZ
-		});
-		node.rotation = {
-			rotation.x,
-			rotation.y,
-			rotation.z,
-			rotation.w
-		};
 		node.scale = {
 			entry.boxRegion.dimensionX,
 			entry.boxRegion.dimensionY,
@@ -94,26 +283,27 @@ private:
 		};
 	}
 
-	void addPointTransform(Vector3 pos, Vector3 rot, Node& node)
+	template <typename T>
+	void addBoxInstance(T entry, InstanceBatch& batch)
 	{
-		node.translation = {
-			pos.x,
-			pos.y,
-			pos.z
-		};
-		Vector4 rotation = EulerToQuatRot({
-			rot.x,
-			rot.y,
-			rot.z
+		batch.translations.insert(batch.translations.end(), {
+			entry.boxRegion.positionX,
+			entry.boxRegion.positionY,
+			entry.boxRegion.positionZ
 		});
-		node.rotation = {
-			rotation.x,
-			rotation.y,
-			rotation.z,
-			rotation.w
-		};
+		batch.rotationsX.push_back(entry.boxRegion.rotationX);
+		batch.rotationsY.push_back(entry.boxRegion.rotationY);
+		batch.rotationsZ.push_back(entry.boxRegion.rotationZ);
+		batch.scales.insert(batch.scales.end(), {
+			entry.boxRegion.dimensionX,
+			entry.boxRegion.dimensionY,
+			entry.boxRegion.dimensionZ
+		});
+		batch.ids.push_back((uint32_t)entry.id);
 	}
 
+	void addPointInstance(Vector3 pos, Vector3 rot, int32_t id, InstanceBatch& batch);
+
 	void addPointTransform(Vector3 pos, Node& node)
 	{
 		node.translation = {
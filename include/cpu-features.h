@@ -0,0 +1,32 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CPU_X86
+#include <immintrin.h>
+#endif
+
+// GCC and Clang need the instruction set enabled per function,
+// so kernels can be built without raising the baseline for the whole target
+#if defined(CPU_X86) && !defined(_MSC_VER)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX2_FMA __attribute__((target("avx2,fma")))
+#else
+#define TARGET_SSE2
+#define TARGET_SSSE3
+#define TARGET_AVX2
+#define TARGET_AVX2_FMA
+#endif
+
+// Instruction set extensions supported by the CPU
+struct CpuFeatures
+{
+	bool sse2 = false;
+	bool ssse3 = false;
+	bool avx2 = false;
+	bool fma = false;
+};
+
+// Get the features of the CPU. Detected on the first call
+const CpuFeatures& getCpuFeatures();
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <json-writer.h>
+
+#include <tiny_gltf.h>
+
+#include <QFile>
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Writes a glTF or GLB file without building a tinygltf Model.
+// Nodes are serialized as soon as they are written, so memory use does not grow
+// with the node count. Everything else is small and written by finish().
+class GltfStreamWriter
+{
+public:
+	GltfStreamWriter(bool binary = false);
+	~GltfStreamWriter();
+
+	// Opens the output file and starts the node array
+	bool open(const QString& fileName);
+
+	// Appends data to the buffer, aligned to a power of two of at least 4 bytes.
+	// Returns its offset in the buffer
+	size_t addBufferData(const void* data, size_t length, size_t alignment = 4);
+
+	// Adds a buffer view of the buffer. Returns its index
+	int addBufferView(const tinygltf::BufferView& view);
+
+	// Adds an accessor. Returns its index
+	int addAccessor(const tinygltf::Accessor& accessor);
+
+	// Adds a mesh. Returns its index
+	int addMesh(const tinygltf::Mesh& mesh);
+
+	// Serializes a node. Returns its index
+	int writeNode(const tinygltf::Node& node);
+
+	// Serializes a node to be written later with writeSerializedNode().
+	// Does not change the writer, so nodes may be serialized on several threads
+	std::string serializeNode(const tinygltf::Node& node) const;
+
+	// Writes a node returned by serializeNode(). Returns its index
+	int writeSerializedNode(std::string_view node);
+
+	// Get the number of nodes written, which is also the index of the next node
+	int getNodeCount() { return nodeCount; }
+
+	// Adds a node to the root of the scene
+	void addRootNode(int index) { rootNodes.push_back(index); }
+
+	// Lists an extension as used by the asset
+	void addExtensionUsed(const std::string& name);
+
+	// Adds an extension to the root of the asset, serialized by a function writing a single value
+	void addExtension(const std::string& name, const std::function<void(JsonWriter&)>& write);
+
+	// Writes the rest of the asset and closes the file. Returns false if writing failed
+	bool finish();
+
+private:
+	QFile file;
+	JsonWriter* json = nullptr;
+	bool binary = false;
+
+	std::vector<unsigned char> bufferData;
+	std::vector<tinygltf::BufferView> bufferViews;
+	std::vector<tinygltf::Accessor> accessors;
+	std::vector<tinygltf::Mesh> meshes;
+	std::vector<int> rootNodes;
+	std::vector<std::string> extensionsUsed;
+	std::vector<std::pair<std::string, std::string>> extensions; // Names and serialized values
+	int nodeCount = 0;
+};
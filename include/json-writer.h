@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QIODevice>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Writes JSON to a device as it is produced, without building a document in memory.
+// Commas and indentation are handled automatically.
+class JsonWriter
+{
+public:
+	JsonWriter(QIODevice* device, bool pretty = false);
+
+	// Writes JSON to memory as a single value nested depth levels deep in a document.
+	// The result can be inserted into that document with rawValue()
+	JsonWriter(int depth, bool pretty = false);
+	~JsonWriter();
+
+	void beginObject();
+	void endObject();
+	void beginArray();
+	void endArray();
+
+	// Writes an object key. Must be followed by a value, object, or array
+	void key(std::string_view name);
+
+	void value(bool value);
+	void value(int value) { this->value((int64_t)value); }
+	void value(int64_t value);
+	void value(uint64_t value);
+	void value(double value);
+	void value(std::string_view value);
+	void value(const char* value) { this->value(std::string_view(value)); }
+	void nullValue();
+
+	// Writes a value serialized by another writer
+	void rawValue(std::string_view json);
+
+	// Writes buffered output to the device. Returns false if the device failed to write
+	bool flush();
+
+	// Get the number of bytes produced so far, including any still buffered
+	qint64 size();
+
+	// Get the output of a writer without a device
+	std::string& getBuffer() { return buffer; }
+
+private:
+	void beginValue();
+	void newLine();
+	void writeString(std::string_view string);
+
+	QIODevice* device = nullptr;
+	std::string buffer;
+	qint64 flushedSize = 0;
+	bool pretty = false;
+	bool failed = false;
+	bool afterKey = false;
+	std::vector<int> counts; // Number of values in each open object or array
+};
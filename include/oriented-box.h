@@ -0,0 +1,28 @@
+#pragma once
+
+#include <trigger-data.h>
+#include <trigger-index.h>
+
+#include <cstdint>
+#include <vector>
+
+// The box of a TriggerRegion in world space
+struct OrientedBox
+{
+	float center[3];
+	float rotation[9]; // Row major, from the box's frame to the world
+	float half[3]; // Half dimensions
+	float min[3]; // Bounds, padded so rounding never leaves part of the box outside
+	float max[3];
+	int32_t id;
+	BrnTrigger::TriggerRegion::Type type;
+};
+
+// Gets the boxes of landmarks, blackspots, VFX box regions, generic regions, and the
+// regions only listed in the region table. Stunt elements and killzone triggers are
+// generic regions, so they are included once.
+// Rotations are converted like the exported nodes, so boxes match the glTF
+std::vector<OrientedBox> getOrientedBoxes(BrnTrigger::TriggerData& data, const TriggerIndex& index);
+
+// Get the name of a TriggerRegion type as used in reports
+const char* getTriggerRegionTypeName(BrnTrigger::TriggerRegion::Type type);
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <converter.h>
+#include <oriented-box.h>
+
+#include <QFile>
+#include <QString>
+
+#include <utility>
+#include <vector>
+
+// Finds every pair of overlapping box triggers.
+// A sweep and prune pass over the world space bounds finds candidate pairs in parallel,
+// which are then checked exactly with a separating axis test on the oriented boxes.
+class OverlapFinder
+{
+public:
+	OverlapFinder(int argc, char* argv[]);
+
+	int result = 0;
+
+private:
+	ConverterOptions options; // Only the platform is used
+	int threadCount = 0;
+	QString inFileName;
+	QString outFileName;
+	bool jsonOutput = false;
+
+	const int minArgCount = 4;
+	int getArgs(int argc, char* argv[]);
+	void showUsage();
+
+	int run();
+	std::vector<std::pair<int32_t, int32_t>> findOverlaps(const std::vector<OrientedBox>& boxes);
+	bool writeCsv(QFile& file, const std::vector<OrientedBox>& boxes,
+		const std::vector<std::pair<int32_t, int32_t>>& overlaps);
+	bool writeJson(QFile& file, const std::vector<OrientedBox>& boxes,
+		const std::vector<std::pair<int32_t, int32_t>>& overlaps);
+};
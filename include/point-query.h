@@ -0,0 +1,40 @@
+#pragma once
+
+#include <converter.h>
+#include <trigger-bvh.h>
+
+#include <QFile>
+#include <QString>
+
+#include <string>
+#include <vector>
+
+// Finds the triggers containing each point of a CSV or binary file.
+// Points are read and queried a chunk at a time, so files of any size can be checked.
+class PointQuery
+{
+public:
+	PointQuery(int argc, char* argv[]);
+
+	int result = 0;
+
+private:
+	ConverterOptions options; // Only the platform is used
+	int threadCount = 0;
+	QString inFileName;
+	QString pointsFileName;
+	QString outFileName;
+	bool binaryPoints = false;
+
+	MappedFile pointsFile;
+	qint64 pointsOffset = 0; // Offset of the next unread point
+	int64_t lineNumber = 0;
+
+	const int minArgCount = 5;
+	int getArgs(int argc, char* argv[]);
+	void showUsage();
+
+	int run();
+	int readPoints(std::vector<float>& points, size_t maxCount);
+	bool writeHits(QFile& file, const std::vector<TriggerBvh::Hit>& hits);
+};
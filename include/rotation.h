@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QtGlobal>
+
+// Converts count Euler rotations in radians, given as separate x, y and z arrays,
+// to quaternions written to quats as x, y, z, w.
+// Sine and cosine of the half angles use polynomials after reducing them to
+// [-pi/4, pi/4]. For half angles up to 8192 in magnitude each sine and cosine is
+// within 1e-7 of the exact value, which bounds each quaternion component's error
+// by 1e-6. Larger angles fall back to the standard library.
+// Uses AVX2 with FMA or SSE2 when the CPU supports them, with a scalar fallback.
+void eulerToQuats(const float* x, const float* y, const float* z, float* quats, qsizetype count);
+
+// Converts a unit quaternion given as x, y, z, w to a row major 3x3 rotation matrix
+void quatToMatrix(const float* quat, float* matrix);
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <json-writer.h>
+
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Measures where a conversion spends its time and memory, for the --stats report.
+// CPU time, allocations and peak RSS are those of the whole process, including the
+// worker threads, so they are only measured for a conversion that has the process to itself.
+class RunStats
+{
+public:
+	explicit RunStats(bool processWide = true);
+
+	// Starts timing a phase, ending the current one
+	void beginPhase(const char* name);
+
+	// Ends the current phase
+	void endPhase();
+
+	// Sets a record count reported under the name
+	void setCount(const char* name, int64_t count);
+
+	void addBytesRead(int64_t bytes) { bytesRead += bytes; }
+	void addBytesWritten(int64_t bytes) { bytesWritten += bytes; }
+
+	// Writes the report as keys of the current object. Ends the current phase
+	void write(JsonWriter& json);
+
+	// Starts counting heap allocations, for reports asking for them
+	static void enableAllocationCounting();
+
+	// Get the number of heap allocations made by the process since counting was enabled
+	static uint64_t getAllocationCount();
+
+	// Get the CPU time used by all threads of the process so far, in seconds
+	static double getProcessCpuTime();
+
+	// Get the largest resident set size of the process so far, in bytes
+	static int64_t getPeakResidentSize();
+
+private:
+	// A point in time of the process
+	struct Sample
+	{
+		std::chrono::steady_clock::time_point wallTime;
+		double cpuTime = 0.0;
+		uint64_t allocations = 0;
+
+		static Sample now(bool processWide);
+	};
+
+	struct Phase
+	{
+		const char* name = nullptr;
+		double wallTime = 0.0; // Seconds
+		double cpuTime = 0.0; // Seconds
+		uint64_t allocations = 0;
+	};
+
+	static Phase getPhase(const char* name, const Sample& start, const Sample& end);
+	void writePhase(JsonWriter& json, const Phase& phase) const;
+
+	bool processWide = true; // Measures CPU time, allocations and peak RSS
+	Sample start;
+	Sample phaseStart;
+	const char* phaseName = nullptr; // Null outside of phases
+	std::vector<Phase> phases;
+	std::vector<std::pair<const char*, int64_t>> counts;
+	int64_t bytesRead = 0;
+	int64_t bytesWritten = 0;
+};
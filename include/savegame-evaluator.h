@@ -0,0 +1,51 @@
+#pragma once
+
+#include <collected-set.h>
+#include <converter.h>
+#include <thread-pool.h>
+
+#include <QString>
+
+#include <string>
+#include <vector>
+
+// Evaluates many savegames against one parsed triggers resource.
+// Savegames are mapped and decoded in parallel, and each either gets an export of the
+// collectibles it has not gathered, or a row of a CSV completion matrix.
+class SavegameEvaluator
+{
+public:
+	SavegameEvaluator(int argc, char* argv[]);
+
+	int result = 0;
+
+private:
+	// A savegame and its result
+	struct Save
+	{
+		QString fileName;
+		QString name; // As listed, or the file name in the directory
+		QString exportFileName;
+		ConverterOptions::Platform platform = ConverterOptions::Platform::PC;
+		int result = 0;
+		std::string error;
+	};
+
+	ConverterOptions options; // Applied to the input and every export
+	int threadCount = 0;
+	QString source;
+	QString outFileName;
+	bool matrixOutput = false;
+	std::vector<Save> saves;
+
+	const int minArgCount = 5;
+	int getArgs(int argc, char* argv[]);
+	void showUsage();
+
+	int readSaveList();
+	int readSaveDirectory();
+	static int readSavegame(Save& save, CollectedSet& collected);
+	int writeExports(ThreadPool& pool);
+	int writeMatrix(ThreadPool& pool);
+	void report();
+};
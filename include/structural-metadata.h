@@ -0,0 +1,123 @@
+#pragma once
+
+#include <gltf-stream-writer.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Attributes of features stored as columnar binary property tables,
+// written with EXT_structural_metadata. Each class of feature gets its own table.
+// Properties are defined by the first feature of a class, so every feature
+// of a class must add the same properties in the same order.
+class StructuralMetadata
+{
+public:
+	// Starts a feature of a class, creating its property table on first use.
+	// Its properties are then set with add() and addArray()
+	void beginFeature(const char* classId, const char* name);
+
+	// Sets a scalar or boolean property of the current feature
+	template <typename T>
+	void add(const char* id, const char* name, T value)
+	{
+		Property& property = nextProperty(id, name, componentType<T>(), false);
+		if constexpr (std::is_same_v<T, bool>)
+		{
+			// Booleans are packed as bits, least significant first
+			int row = tables[currentTable].count - 1;
+			if (row % 8 == 0)
+				property.values.push_back(0);
+			if (value)
+				property.values.back() |= (uint8_t)(1 << (row % 8));
+		}
+		else
+			appendValues(property, &value, 1);
+	}
+
+	// Sets a variable-length array property of the current feature
+	template <typename T>
+	void addArray(const char* id, const char* name, const T* values, int count)
+	{
+		static_assert(!std::is_same_v<T, bool>, "Boolean arrays are not supported");
+		Property& property = nextProperty(id, name, componentType<T>(), true);
+		if (property.arrayOffsets.empty())
+			property.arrayOffsets.push_back(0);
+		appendValues(property, values, count);
+		property.arrayOffsets.push_back(property.arrayOffsets.back() + (uint32_t)count);
+	}
+
+	// Get the index of the property table of the current feature
+	int getTable() { return currentTable; }
+
+	// Get the index of the current feature in its property table
+	int getFeature() { return tables[currentTable].count - 1; }
+
+	bool empty() { return tables.empty(); }
+
+	// Appends the property tables to the buffer and adds the extension to the asset
+	void write(GltfStreamWriter& writer);
+
+private:
+	// A column of a property table
+	struct Property
+	{
+		std::string id;
+		std::string name;
+		const char* componentType = nullptr; // Null for booleans
+		bool isArray = false;
+		std::vector<uint8_t> values;
+		std::vector<uint32_t> arrayOffsets; // Element offsets of each array, and the end of the last
+	};
+
+	struct PropertyTable
+	{
+		std::string classId;
+		std::string name;
+		int count = 0;
+		std::vector<Property> properties;
+	};
+
+	template <typename T>
+	static constexpr const char* componentType()
+	{
+		if constexpr (std::is_same_v<T, bool>)
+			return nullptr;
+		else if constexpr (std::is_enum_v<T>)
+			return componentType<std::underlying_type_t<T>>();
+		else if constexpr (std::is_same_v<T, float>)
+			return "FLOAT32";
+		else if constexpr (std::is_same_v<T, double>)
+			return "FLOAT64";
+		else
+		{
+			static_assert(std::is_integral_v<T> && sizeof(T) <= 8, "Unsupported property type");
+			if constexpr (sizeof(T) == 1)
+				return std::is_signed_v<T> ? "INT8" : "UINT8";
+			else if constexpr (sizeof(T) == 2)
+				return std::is_signed_v<T> ? "INT16" : "UINT16";
+			else if constexpr (sizeof(T) == 4)
+				return std::is_signed_v<T> ? "INT32" : "UINT32";
+			else
+				return std::is_signed_v<T> ? "INT64" : "UINT64";
+		}
+	}
+
+	// Values are copied as is, like the rest of the buffer data
+	template <typename T>
+	static void appendValues(Property& property, const T* values, int count)
+	{
+		size_t offset = property.values.size();
+		property.values.resize(offset + sizeof(T) * count);
+		if (count > 0)
+			memcpy(property.values.data() + offset, values, sizeof(T) * count);
+	}
+
+	Property& nextProperty(const char* id, const char* name, const char* componentType, bool isArray);
+
+	std::vector<PropertyTable> tables;
+	int currentTable = -1;
+	size_t currentProperty = 0;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs tasks on a fixed set of worker threads.
+// Each worker has its own queue and takes its newest task first. Idle workers
+// steal the oldest task of another worker, so uneven tasks still keep every
+// thread busy.
+class ThreadPool
+{
+public:
+	// Starts the workers. A count of 0 uses one per hardware thread
+	ThreadPool(int threadCount = 0);
+	~ThreadPool();
+
+	// Queues a task. Tasks submitted from a worker go to that worker's queue
+	void submit(std::function<void()> task);
+
+	// Blocks until every submitted task has finished
+	void wait();
+
+	// Runs body(begin, end) over [0, count) in ranges of up to grain items and
+	// waits for them. The calling thread takes part, so this may also be called
+	// from a task without waiting on itself
+	void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+	int getThreadCount() { return (int)threads.size(); }
+
+private:
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	void work(int index);
+	bool pop(int index, std::function<void()>& task);
+
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> threads;
+
+	std::mutex mutex;
+	std::condition_variable taskQueued;
+	std::condition_variable tasksDone;
+	std::atomic<size_t> queued = 0; // Tasks waiting in a queue
+	size_t pending = 0; // Tasks queued or running
+	size_t nextQueue = 0;
+	bool stopping = false;
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <json-writer.h>
+
+#include <QString>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+// Splits items into tiles by their position on the X and Z axes, and writes an index
+// of the tiles as a 3D Tiles tileset, so viewers only load the tiles in view.
+// Items are kept whole, so the bounds of a tile cover every item it holds.
+class Tileset
+{
+public:
+	// Something placed in a single tile
+	struct Item
+	{
+		float position[3]; // Decides the tile
+		float min[3]; // Bounds
+		float max[3];
+		int count = 0; // Number of triggers
+	};
+
+	// Items stored in one file
+	struct Tile
+	{
+		std::string name; // File name without extension
+		std::vector<int> items;
+		int count = 0; // Number of triggers
+	};
+
+	// Splits items into square tiles of a size
+	void buildGrid(const std::vector<Item>& items, float size);
+
+	// Splits items into quadtree tiles of at most capacity triggers.
+	// Tiles may hold more when a single item or position does
+	void buildQuadtree(const std::vector<Item>& items, int capacity);
+
+	const std::vector<Tile>& getTiles() const { return tiles; }
+
+	// Writes the index, where each tile is stored in its name plus extension.
+	// Returns false if writing failed
+	bool write(const QString& fileName, const std::string& extension) const;
+
+private:
+	// A node of the index. Leaves hold a tile
+	struct Node
+	{
+		float min[3] = { INFINITY, INFINITY, INFINITY }; // Bounds of the items below
+		float max[3] = { -INFINITY, -INFINITY, -INFINITY };
+		int count = 0;
+		int tile = -1;
+		std::vector<int> children;
+	};
+
+	// A square of the quadtree on the X and Z axes
+	struct Square
+	{
+		float x;
+		float z;
+		float size;
+	};
+
+	int addTile(const std::vector<Item>& items, const std::string& name, const std::vector<int>& indices);
+	int addQuadtreeNode(const std::vector<Item>& items, std::vector<int>& indices, Square square,
+		const std::string& path, int capacity);
+	void addChild(int node, int child);
+	static double getSize(const Node& node);
+	void writeNode(JsonWriter& json, int node, const std::string& extension) const;
+
+	std::vector<Tile> tiles;
+	std::vector<Node> nodes; // The first is the root
+};
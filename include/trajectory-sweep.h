@@ -0,0 +1,67 @@
+#pragma once
+
+#include <converter.h>
+#include <trigger-bvh.h>
+
+#include <QString>
+
+#include <string>
+#include <vector>
+
+// Finds where vehicle trajectories enter and exit box triggers.
+// Each segment between two samples is clipped against the boxes near it, so triggers
+// crossed between samples are found too, with interpolated times.
+// Trajectories are swept in parallel.
+class TrajectorySweep
+{
+public:
+	TrajectorySweep(int argc, char* argv[]);
+
+	int result = 0;
+
+private:
+	// Lines of one trajectory in the mapped input
+	struct Trajectory
+	{
+		qint64 begin = 0;
+		qint64 end = 0;
+		int64_t firstLine = 0;
+		std::string events; // Output CSV lines
+		std::string error;
+	};
+
+	// Boxes near a trajectory, kept until it leaves the region they were gathered for
+	struct Candidates
+	{
+		float min[3] = { 0.0f, 0.0f, 0.0f };
+		float max[3] = { 0.0f, 0.0f, 0.0f };
+		std::vector<int32_t> boxes;
+	};
+
+	// An event within a segment
+	struct Event
+	{
+		float fraction; // Position along the segment
+		bool enter;
+		int32_t box;
+	};
+
+	ConverterOptions options; // Only the platform is used
+	int threadCount = 0;
+	QString inFileName;
+	QString trajectoriesFileName;
+	QString outFileName;
+
+	TriggerBvh bvh;
+	MappedFile trajectoriesFile;
+
+	const int minArgCount = 5;
+	int getArgs(int argc, char* argv[]);
+	void showUsage();
+
+	int run();
+	std::vector<Trajectory> splitTrajectories();
+	void sweep(Trajectory& trajectory);
+	void gatherCandidates(const float* start, const float* end, Candidates& candidates);
+	void addEvent(Trajectory& trajectory, std::string_view id, double time, bool enter, int32_t box);
+};
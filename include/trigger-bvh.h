@@ -0,0 +1,85 @@
+#pragma once
+
+#include <oriented-box.h>
+#include <thread-pool.h>
+#include <trigger-data.h>
+#include <trigger-index.h>
+
+#include <cstdint>
+#include <vector>
+
+// Bounding volume hierarchy over the oriented boxes of every TriggerRegion.
+// Leaves are packets of up to eight boxes stored as columns, so a point is tested
+// against a whole packet at once with AVX2 or SSE2 when the CPU supports them.
+class TriggerBvh
+{
+public:
+	// A trigger containing a point
+	struct Hit
+	{
+		uint64_t point = 0; // Index of the point
+		int32_t id = 0; // TriggerRegion ID
+		BrnTrigger::TriggerRegion::Type type = (BrnTrigger::TriggerRegion::Type)0;
+	};
+
+	// Number of boxes in a leaf packet
+	static constexpr int packetSize = 8;
+
+	// Builds the hierarchy from the boxes of getOrientedBoxes()
+	void build(BrnTrigger::TriggerData& data, const TriggerIndex& index);
+
+	// Appends the triggers containing a point
+	void query(const float* point, uint64_t pointIndex, std::vector<Hit>& hits) const;
+
+	// Appends the triggers containing each of count points, given as x, y, z.
+	// Hits are ordered by point, and by position in the hierarchy for each point.
+	// Ranges of points are queried in parallel if a pool is given
+	void query(const float* points, uint64_t firstIndex, size_t count, ThreadPool* pool, std::vector<Hit>& hits) const;
+
+	// Appends the boxes of every leaf whose bounds overlap an axis aligned box.
+	// Boxes are given as indices for clipSegment(), getId() and getType()
+	void findCandidates(const float* min, const float* max, std::vector<int32_t>& boxes) const;
+
+	// Gets the part of the segment from start to end inside a box, as fractions of
+	// its length. Returns false if the segment misses the box
+	bool clipSegment(int32_t box, const float* start, const float* end, float& enter, float& exit) const;
+
+	int32_t getId(int32_t box) const { return packets[box / packetSize].ids[box % packetSize]; }
+	BrnTrigger::TriggerRegion::Type getType(int32_t box) const { return packets[box / packetSize].types[box % packetSize]; }
+
+	// Get the number of boxes in the hierarchy
+	int32_t size() const { return boxCount; }
+
+private:
+	// Bounds of a subtree. Inner nodes have two children, the first directly following it
+	struct Node
+	{
+		float min[3];
+		float max[3];
+		int32_t secondChild = 0; // Index of the second child for inner nodes
+		int32_t packet = -1; // Index of the packet for leaves, -1 for inner nodes
+	};
+
+	// Columns of packetSize boxes.
+	// Points are moved into each box's frame by the inverse of its rotation and
+	// compared against its half dimensions. Unused slots have negative half dimensions
+	struct alignas(32) Packet
+	{
+		float centerX[packetSize];
+		float centerY[packetSize];
+		float centerZ[packetSize];
+		float inverseRotation[9][packetSize]; // Row major
+		float halfX[packetSize];
+		float halfY[packetSize];
+		float halfZ[packetSize];
+		int32_t ids[packetSize];
+		BrnTrigger::TriggerRegion::Type types[packetSize];
+	};
+
+	int32_t buildNode(std::vector<OrientedBox>& boxes, size_t begin, size_t end);
+	void addPacket(const OrientedBox* boxes, size_t count);
+
+	std::vector<Node> nodes;
+	std::vector<Packet> packets;
+	int32_t boxCount = 0;
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <arena.h>
 #include <types.h>
 
 namespace BrnTrigger
@@ -8,7 +9,14 @@ namespace BrnTrigger
 	// Sphere and line types are not supported.
 	struct BoxRegion
 	{
-		void read(DataStream& in);
+		// Size of the record in the resource
+		template <typename Traits>
+		static constexpr qint64 recordSize = 0x24;
+
+		template <typename Traits>
+		void read(MappedStream<Traits>& in);
+		template <typename Traits>
+		void read(const uchar* data);
 		void write(DataStream& out);
 
 		float32_t positionX = 0;
@@ -25,6 +33,10 @@ namespace BrnTrigger
 	// General container for box triggers.
 	struct TriggerRegion
 	{
+		// Size of the record in the resource
+		template <typename Traits>
+		static constexpr qint64 recordSize = 0x2C;
+
 		enum class Type : uint8_t
 		{
 			landmark,
@@ -33,7 +45,8 @@ namespace BrnTrigger
 			vfxBoxRegion
 		};
 
-		void read(DataStream& file);
+		template <typename Traits>
+		void read(MappedStream<Traits>& file);
 		void write(DataStream& file);
 
 		BoxRegion boxRegion;
@@ -47,9 +60,14 @@ namespace BrnTrigger
 	struct StartingGrid
 	{
 	public:
+		// Size of the record in the resource
+		template <typename Traits>
+		static constexpr qint64 recordSize = 0x100;
+
 		StartingGrid();
 
-		void read(DataStream& file);
+		template <typename Traits>
+		void read(MappedStream<Traits>& file);
 		void write(DataStream& file);
 
 		Vector3 startingPositions[8];
@@ -60,12 +78,17 @@ namespace BrnTrigger
 	// Big Surf Island has an overabundance of Landmarks.
 	struct Landmark : public TriggerRegion
 	{
+		// Size of the record in the resource
+		template <typename Traits>
+		static constexpr qint64 recordSize = TriggerRegion::recordSize<Traits> + Traits::pointerSize + 0x4 + Traits::padIf64(0x8);
+
 		enum class Flags : uint8_t
 		{
 			isOnline = 1 << 0
 		};
 
-		void read(DataStream& file);
+		template <typename Traits>
+		void read(MappedStream<Traits>& file);
 		void write(DataStream& file);
 
 		StartingGrid* startingGrids;
@@ -78,6 +101,10 @@ namespace BrnTrigger
 	// Generic box trigger. This is the main trigger type used by the game.
 	struct GenericRegion : public TriggerRegion
 	{
+		// Size of the record in the resource
+		template <typename Traits>
+		static constexpr qint64 recordSize = 0x38;
+
 		enum class StuntCameraType : int8_t
 		{
 			noCuts,
@@ -121,7 +148,8 @@ namespace BrnTrigger
 			ramp
 		};
 
-		void read(DataStream& file);
+		template <typename Traits>
+		void read(MappedStream<Traits>& file);
 		void write(DataStream& file);
 
 		int32_t groupId = 0; // GameDB ID
@@ -136,13 +164,18 @@ namespace BrnTrigger
 	// Accident blackspot (crash mode). Unused in retail.
 	struct Blackspot : public TriggerRegion
 	{
+		// Size of the record in the resource
+		template <typename Traits>
+		static constexpr qint64 recordSize = 0x34;
+
 		enum class ScoreType : uint8_t
 		{
 			distance,
 			carCount
 		};
 
-		void read(DataStream& file);
+		template <typename Traits>
+		void read(MappedStream<Traits>& file);
 		void write(DataStream& file);
 
 		ScoreType scoreType = (ScoreType)0;
@@ -152,35 +185,50 @@ namespace BrnTrigger
 	// VFX region. Unused in retail.
 	struct VFXBoxRegion : public TriggerRegion
 	{
-		void read(DataStream& file);
+		// Size of the record in the resource
+		template <typename Traits>
+		static constexpr qint64 recordSize = 0x2C;
+
+		template <typename Traits>
+		void read(MappedStream<Traits>& file);
 		void write(DataStream& file);
 	};
 
 	// TODO: Description
 	struct SignatureStunt
 	{
-		void read(DataStream& file);
+		// Size of the record in the resource
+		template <typename Traits>
+		static constexpr qint64 recordSize = 0x14 + Traits::pointerSize + Traits::padIf64(0x4);
+
+		template <typename Traits>
+		void read(MappedStream<Traits>& file);
 		void write(DataStream& file);
 
-		GenericRegion getStuntElement(int index) { return stuntElements[index][0]; }
-		void setStuntElement(GenericRegion region, int index) { stuntElements[index][0] = region; }
+		GenericRegion getStuntElement(int index) { return stuntElements[index]; }
+		void setStuntElement(GenericRegion region, int index) { stuntElements[index] = region; }
 
 		CgsID id = 0;
 		int64_t camera = 0;
-		GenericRegion** stuntElements = nullptr;
+		GenericRegion* stuntElements = nullptr; // Flattened from the resource's pointer table
 		int32_t stuntElementCount = 0;
 	};
 
 	// TODO: Description
 	struct Killzone
 	{
-		void read(DataStream& file);
+		// Size of the record in the resource
+		template <typename Traits>
+		static constexpr qint64 recordSize = (Traits::pointerSize + 0x4 + Traits::padIf64(0x4)) * 2;
+
+		template <typename Traits>
+		void read(MappedStream<Traits>& file);
 		void write(DataStream& file);
 
-		GenericRegion getTrigger(int index) { return triggers[index][0]; }
-		void setTrigger(GenericRegion region, int index) { triggers[index][0] = region; }
+		GenericRegion getTrigger(int index) { return triggers[index]; }
+		void setTrigger(GenericRegion region, int index) { triggers[index] = region; }
 
-		GenericRegion** triggers = nullptr;
+		GenericRegion* triggers = nullptr; // Flattened from the resource's pointer table
 		int32_t triggerCount = 0;
 		CgsID* regionIds = nullptr; // GameDB IDs
 		int32_t regionIdCount = 0;
@@ -189,7 +237,12 @@ namespace BrnTrigger
 	// Spawn locations for roaming rivals (shutdown cars)
 	struct RoamingLocation
 	{
-		void read(DataStream& file);
+		// Size of the record in the resource
+		template <typename Traits>
+		static constexpr qint64 recordSize = 0x20;
+
+		template <typename Traits>
+		void read(MappedStream<Traits>& file);
 		void write(DataStream& file);
 
 		Vector3 position = Vector3(true);
@@ -199,6 +252,10 @@ namespace BrnTrigger
 	// Vehicle spawn locations in and outside each Junkyard
 	struct SpawnLocation
 	{
+		// Size of the record in the resource
+		template <typename Traits>
+		static constexpr qint64 recordSize = 0x30;
+
 		enum class Type : uint8_t
 		{
 			playerSpawn,
@@ -207,7 +264,8 @@ namespace BrnTrigger
 			carUnlock
 		};
 
-		void read(DataStream& file);
+		template <typename Traits>
+		void read(MappedStream<Traits>& file);
 		void write(DataStream& file);
 
 		Vector3 position = Vector3(true);
@@ -218,13 +276,39 @@ namespace BrnTrigger
 
 	// The header for the TriggerData resource.
 	// Lists all relevant offsets and counts.
+	// Everything read from the resource is stored in a single arena owned by the header.
 	struct TriggerData
 	{
-		void read(DataStream& file);
+		// Size of the record in the resource
+		template <typename Traits>
+		static constexpr qint64 recordSize = 0x30 + Traits::pointerSize * 9 + 0x2C + Traits::padIf64(0x1C);
+
+		// Arrays of the resource, which can be read separately
+		enum class Section : uint16_t
+		{
+			landmarks = 1 << 0, // With their starting grids
+			signatureStunts = 1 << 1, // With their stunt elements
+			genericRegions = 1 << 2,
+			killzones = 1 << 3, // With their triggers and region IDs
+			blackspots = 1 << 4,
+			vfxBoxRegions = 1 << 5,
+			roamingLocations = 1 << 6,
+			spawnLocations = 1 << 7,
+			regions = 1 << 8
+		};
+		static constexpr uint16_t allSections = (1 << 9) - 1;
+
+		// Reads the header, and the arrays of the sections in a mask of Section values.
+		// Every count is read, but the arrays of other sections are left null
+		template <typename Traits>
+		void read(MappedStream<Traits>& file, uint16_t sections = allSections);
 		void write(DataStream& file);
 
-		TriggerRegion getRegion(int index) { return regions[index][0]; }
-		void setRegion(TriggerRegion region, int index) { regions[index][0] = region; }
+		// Get whether the array of a section was read
+		bool hasSection(Section section) const { return (readSections & (uint16_t)section) != 0; }
+
+		TriggerRegion getRegion(int index) { return regions[index]; }
+		void setRegion(TriggerRegion region, int index) { regions[index] = region; }
 
 		int32_t versionNumber = 0;
 		uint32_t size = 0;
@@ -247,7 +331,14 @@ namespace BrnTrigger
 		int32_t roamingLocationCount = 0;
 		SpawnLocation* spawnLocations = nullptr;
 		int32_t spawnLocationCount = 0;
-		TriggerRegion** regions = nullptr;
+		TriggerRegion* regions = nullptr; // Flattened from the resource's pointer table
 		int32_t regionCount = 0;
+
+	private:
+		template <typename Traits>
+		qint64 arenaSize(MappedStream<Traits>& file);
+
+		Arena arena;
+		uint16_t readSections = 0; // Mask of Section values
 	};
 };
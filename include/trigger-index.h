@@ -0,0 +1,48 @@
+#pragma once
+
+#include <trigger-data.h>
+
+#include <cstdint>
+#include <vector>
+
+// Index from TriggerRegion ID to the categories the ID appears in.
+// Stored as a flat open-addressing hash table with linear probing.
+class TriggerIndex
+{
+public:
+	enum class Category : uint8_t
+	{
+		landmark = 1 << 0,
+		blackspot = 1 << 1,
+		vfxBoxRegion = 1 << 2,
+		genericRegion = 1 << 3,
+		stuntElement = 1 << 4,
+		killzoneTrigger = 1 << 5
+	};
+
+	// Builds the index from every TriggerRegion in the data
+	void build(BrnTrigger::TriggerData& data);
+
+	// Get the categories an ID appears in as a mask of Category values, or 0 if not present
+	uint8_t find(int32_t id) const;
+
+	// Get whether an ID appears in any of the categories in a mask of Category values
+	bool contains(int32_t id, uint8_t categories) const { return (find(id) & categories) != 0; }
+
+	// Get the number of distinct IDs in the index
+	int32_t size() const { return count; }
+
+private:
+	struct Slot
+	{
+		int32_t id = 0;
+		uint8_t categories = 0; // 0 marks an empty slot
+	};
+
+	void insert(int32_t id, Category category);
+	uint32_t slotIndex(int32_t id) const;
+
+	std::vector<Slot> slots;
+	uint32_t mask = 0;
+	int32_t count = 0;
+};
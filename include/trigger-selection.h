@@ -0,0 +1,86 @@
+#pragma once
+
+#include <trigger-table.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Selects rows of a TriggerTable with an expression such as
+// "type=jump,smash and not oneWay=1 or kind=landmark district=2".
+// Conditions are field=values, combined with and, or, not and parentheses.
+// Conditions next to each other must both hold.
+// Each condition is evaluated as a scan of its columns, giving a bitmap of rows,
+// and the bitmaps are combined a word at a time.
+class TriggerSelection
+{
+public:
+	// Parses an expression. Returns false and sets error if it is invalid
+	bool parse(const std::string& expression, std::string& error);
+
+	// Get the mask of TriggerData::Section values holding the triggers the
+	// expression can select
+	uint16_t getSections() const;
+
+	// Get a bitmap of the selected rows. Row i is bit i % 64 of word i / 64
+	std::vector<uint64_t> evaluate(const TriggerTable& table) const;
+
+	// Get whether a row is set in a bitmap
+	static bool isSelected(const std::vector<uint64_t>& bitmap, int64_t row)
+	{
+		return (bitmap[row >> 6] >> (row & 63)) & 1;
+	}
+
+private:
+	enum class Field : uint8_t
+	{
+		kind,
+		type,
+		district,
+		oneWay,
+		groupId,
+		flags,
+		id,
+		box
+	};
+
+	// An inclusive range of values
+	struct Range
+	{
+		int64_t min;
+		int64_t max;
+	};
+
+	// A node of the expression tree
+	struct Node
+	{
+		enum class Op : uint8_t
+		{
+			condition,
+			conjunction,
+			disjunction,
+			negation // Of the left node
+		} op = Op::condition;
+		int left = -1;
+		int right = -1;
+
+		Field field = Field::kind;
+		std::vector<Range> ranges; // Values the field may have
+		float box[6] = {}; // Minimum then maximum corner for Field::box
+	};
+
+	int parseDisjunction(std::string& error);
+	int parseConjunction(std::string& error);
+	int parseNegation(std::string& error);
+	int parseCondition(const std::string& token, std::string& error);
+	int addNode(Node node);
+	uint8_t getKinds(int node) const;
+	std::vector<uint64_t> evaluateNode(const TriggerTable& table, int node) const;
+
+	std::vector<Node> nodes;
+	int root = -1;
+
+	// Parser state
+	std::vector<std::string> tokens;
+	size_t nextToken = 0;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <trigger-data.h>
+
+#include <cstdint>
+#include <vector>
+
+// Triggers of every TriggerRegion subtype and location type, stored as columns,
+// so selections scan one attribute of every trigger at a time.
+// Rows are landmarks, blackspots, VFX box regions, generic regions, roaming
+// locations, then spawn locations, each in the order of their array.
+// Attributes a kind of trigger does not have are 0.
+class TriggerTable
+{
+public:
+	enum class Kind : uint8_t
+	{
+		landmark,
+		blackspot,
+		vfxBoxRegion,
+		genericRegion,
+		roamingLocation,
+		spawnLocation
+	};
+	static constexpr int kindCount = 6;
+
+	// Number of GenericRegion::Type values
+	static constexpr int typeCount = 32;
+
+	// Adds a row for every trigger in the sections that were read
+	void build(BrnTrigger::TriggerData& data);
+
+	// Get the number of rows
+	int64_t size() const { return (int64_t)kind.size(); }
+
+	// Get the TriggerData section holding a kind of trigger
+	static BrnTrigger::TriggerData::Section getSection(Kind kind);
+
+	// Get the name of a kind of trigger, as used in selections
+	static const char* getKindName(Kind kind);
+
+	// Get the name of a GenericRegion::Type, as used in selections, or nullptr if unknown
+	static const char* getTypeName(uint8_t type);
+
+	std::vector<Kind> kind;
+	std::vector<int32_t> index; // Index in the array of its kind
+	std::vector<int32_t> id;
+	std::vector<uint8_t> type; // GenericRegion::Type
+	std::vector<uint8_t> district; // Landmark district, or roaming location district index
+	std::vector<uint8_t> oneWay;
+	std::vector<int32_t> groupId;
+	std::vector<uint8_t> flags; // TriggerRegion::unk0
+	std::vector<float> positionX;
+	std::vector<float> positionY;
+	std::vector<float> positionZ;
+
+private:
+	void addRow(Kind kind, int32_t index, const BrnTrigger::TriggerRegion* region, const Vector3& position);
+};
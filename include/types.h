@@ -1,6 +1,7 @@
 #pragma once
 
 #include <binary-io/data-stream.h>
+#include <binary-io/mapped-stream.h>
 
 #include <QIODevice>
 
@@ -14,7 +15,8 @@ struct Vector3
 	Vector3(bool isVpu = false);
 	Vector3(float x, float y, float z, bool vpu = false);
 
-	void read(DataStream& stream);
+	template <typename Traits>
+	void read(MappedStream<Traits>& stream);
 	void write(DataStream& stream);
 
 	bool getIsVpu() { return isVpu; }
@@ -35,7 +37,8 @@ public:
 	Vector4();
 	Vector4(float x, float y, float z, float w);
 
-	void read(DataStream& stream);
+	template <typename Traits>
+	void read(MappedStream<Traits>& stream);
 	void write(DataStream& stream);
 
 	float x = 0;
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <batch-converter.h>
+#include <converter.h>
+#include <thread-pool.h>
+
+#include <QDateTime>
+#include <QString>
+#include <QStringList>
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+// Converts the files of a manifest or directory, then stays resident and converts
+// each file again whenever its input or savegame is saved.
+// Converters are kept between changes with their parsed input and index, so a
+// savegame change only rereads the savegame, and an input change only reparses
+// that input.
+class WatchConverter
+{
+public:
+	WatchConverter(int argc, char* argv[]);
+
+	int result = 0;
+
+private:
+	// A converted file and the converter kept for it
+	struct Job
+	{
+		ConverterOptions options;
+		std::unique_ptr<std::ostringstream> err; // The converter writes its errors here
+		std::unique_ptr<Converter> converter;
+		bool inputChanged = false;
+		bool savegameChanged = false;
+	};
+
+	// A watched file and the jobs reading it
+	struct WatchedFile
+	{
+		QDateTime lastModified;
+		qint64 size = -1; // -1 while the file is missing
+		std::vector<size_t> inputOf;
+		std::vector<size_t> savegameOf;
+	};
+
+	ConverterOptions defaults; // Options given on the command line
+	int threadCount = 0;
+	QString source;
+	QString outDir;
+	std::vector<Job> jobs;
+	std::map<QString, WatchedFile> files; // By absolute path
+	std::unique_ptr<ThreadPool> pool;
+
+	// Time the first change not yet converted was seen
+	std::chrono::steady_clock::time_point firstChange;
+	bool changePending = false;
+
+	const int minArgCount = 4;
+	int getArgs(int argc, char* argv[]);
+	void showUsage();
+
+	int readJobs();
+	void addWatchedFile(const QString& path, size_t job, bool savegame);
+	bool updateFile(const QString& path, WatchedFile& file);
+	int watch(int argc, char* argv[]);
+	void convertChanged();
+	void report(const Job& job, std::chrono::steady_clock::time_point start);
+};
@@ -0,0 +1,47 @@
+#include <arena.h>
+
+#include <cstdlib>
+
+Arena::Arena()
+{
+
+}
+
+Arena::~Arena()
+{
+	reset();
+}
+
+// Frees the current block and allocates a new one of the specified size
+void Arena::reserve(qint64 size)
+{
+	reset();
+	if (size <= 0)
+		return;
+
+	// malloc aligns to max_align_t, which covers every type allocated from the arena
+	block = (std::byte*)malloc(size);
+	assert(block != nullptr);
+	this->size = size;
+}
+
+// Frees the current block
+void Arena::reset()
+{
+	free(block);
+	block = nullptr;
+	size = 0;
+	offset = 0;
+}
+
+// Get the size of the current block
+qint64 Arena::capacity()
+{
+	return size;
+}
+
+// Get the number of bytes allocated from the current block
+qint64 Arena::used()
+{
+	return offset;
+}
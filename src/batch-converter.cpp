@@ -0,0 +1,276 @@
+#include <batch-converter.h>
+#include <thread-pool.h>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QTextStream>
+
+#include <iostream>
+#include <map>
+#include <sstream>
+
+namespace
+{
+	// An output path as the file system compares it. Windows and macOS ignore case by default
+	QString getPathKey(const QString& path)
+	{
+#if defined(_WIN32) || defined(__APPLE__)
+		return path.toLower();
+#else
+		return path;
+#endif
+	}
+}
+
+BatchConverter::BatchConverter(int argc, char* argv[])
+{
+	result = getArgs(argc, argv);
+	if (result != 0)
+		return;
+
+	result = readJobs(source, outDir, defaults, jobs);
+	if (result != 0)
+		return;
+
+	convert();
+}
+
+int BatchConverter::getArgs(int argc, char* argv[])
+{
+	// Ensure minimum argument count is reached
+	if (argc < minArgCount)
+	{
+		showUsage();
+		return 1;
+	}
+
+	// Options apply to every file unless a manifest line overrides them
+	QStringList args;
+	for (int i = 2; i < argc - 2; ++i)
+	{
+		// Set worker thread count
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc - 2)
+		{
+			threadCount = atoi(argv[i + 1]);
+			i++;
+		}
+		else
+			args.append(QString::fromLocal8Bit(argv[i]));
+	}
+	int parseResult = defaults.parse(args, std::cerr);
+	if (parseResult != 0)
+		return parseResult;
+
+	source = QString::fromLocal8Bit(argv[argc - 2]);
+	outDir = QString::fromLocal8Bit(argv[argc - 1]);
+
+	// Check input exists
+	if (!QFileInfo::exists(source))
+	{
+		std::cerr << "Invalid manifest or input directory";
+		return 2;
+	}
+
+	// Check output is or can be made a directory
+	QFileInfo outputInfo(outDir);
+	if ((outputInfo.exists() && !outputInfo.isDir()) || !QDir().mkpath(outDir))
+	{
+		std::cerr << "Output location is not a directory and cannot be created";
+		return 3;
+	}
+
+	return 0;
+}
+
+void BatchConverter::showUsage()
+{
+	std::cout << "Usage: TriggersToGLTF --batch [options] <manifest or input directory> <output directory>\n\n"
+		<< "Converts every file of the input directory, or every file listed in the manifest.\n"
+		<< "Each manifest line is [options] <input file> <output file>, with the output\n"
+		<< "relative to the output directory. Lines starting with # are ignored.\n\n"
+		<< "Options:\n"
+		<< " -j   Number of files converted at once. Default: one per hardware thread\n"
+		<< " --stats  Directory receiving a report per file, named after its output.\n"
+		<< " Any single file option, applied to every file. Manifest lines may override them.";
+}
+
+// Reads the files of a manifest or input directory, with outputs in an output directory.
+// Manifest line options are parsed over the defaults. Returns 0 on success
+int BatchConverter::readJobs(const QString& source, const QString& outDir, const ConverterOptions& defaults,
+	std::vector<Job>& jobs)
+{
+	int readResult = QFileInfo(source).isDir() ? readDirectory(source, outDir, defaults, jobs)
+		: readManifest(source, outDir, defaults, jobs);
+	if (readResult != 0)
+		return readResult;
+
+	// Files writing the same output would overwrite each other at the same time, so
+	// only the first is converted. Case is ignored for case-insensitive file systems
+	std::map<QString, const Job*> outputs;
+	for (Job& job : jobs)
+	{
+		if (job.result != 0)
+			continue;
+
+		QString output = getPathKey(QFileInfo(QString::fromStdString(job.options.outFileName)).absoluteFilePath());
+		auto [first, inserted] = outputs.emplace(output, &job);
+		if (!inserted)
+		{
+			job.result = 4;
+			job.error = "Output " + job.options.outFileName + " is also written by " + first->second->options.inFileName;
+		}
+	}
+
+	// Only files that will be converted get their output directories
+	for (const Job& job : jobs)
+	{
+		if (job.result != 0)
+			continue;
+
+		QDir().mkpath(QFileInfo(QString::fromStdString(job.options.outFileName)).absolutePath());
+		if (!job.options.statsFileName.empty())
+			QDir().mkpath(QFileInfo(QString::fromStdString(job.options.statsFileName)).absolutePath());
+	}
+
+	return 0;
+}
+
+int BatchConverter::readManifest(const QString& source, const QString& outDir, const ConverterOptions& defaults,
+	std::vector<Job>& jobs)
+{
+	QFile manifest(source);
+	if (!manifest.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		std::cerr << "Failed to open manifest";
+		return 2;
+	}
+
+	// Inputs are relative to the manifest
+	QDir manifestDir = QFileInfo(source).absoluteDir();
+
+	QTextStream stream(&manifest);
+	int lineNumber = 0;
+	while (!stream.atEnd())
+	{
+		QString line = stream.readLine().trimmed();
+		lineNumber++;
+		if (line.isEmpty() || line.startsWith('#'))
+			continue;
+
+		Job job;
+		job.options = defaults;
+		QStringList args = QProcess::splitCommand(line);
+		if (args.size() < 2)
+		{
+			job.options.inFileName = "Manifest line " + std::to_string(lineNumber);
+			job.result = 4;
+			job.error = "Expected an input and output file";
+			jobs.push_back(job);
+			continue;
+		}
+
+		std::ostringstream err;
+		job.result = job.options.parse(args.mid(0, args.size() - 2), err);
+		job.error = err.str();
+		QString outputPath = QDir::cleanPath(args.back());
+		job.options.setFiles(manifestDir.filePath(args[args.size() - 2]).toStdString(),
+			getOutputPath(outDir, outputPath).toStdString());
+		setStatsPath(job, defaults, outputPath);
+		if (job.result == 0 && !isInsideOutputDir(outputPath))
+		{
+			job.result = 4;
+			job.error = "Output " + outputPath.toStdString() + " would be outside the output directory";
+		}
+		jobs.push_back(job);
+	}
+
+	return 0;
+}
+
+int BatchConverter::readDirectory(const QString& source, const QString& outDir, const ConverterOptions& defaults,
+	std::vector<Job>& jobs)
+{
+	// Outputs keep the input name with the glTF extension, or without one for tiled or split output
+	QFileInfoList inputs = QDir(source).entryInfoList(QDir::Files, QDir::Name);
+	for (const QFileInfo& input : inputs)
+	{
+		Job job;
+		job.options = defaults;
+		QString extension = defaults.writesDirectory() ? "" : defaults.getGltfExtension();
+		job.options.setFiles(input.filePath().toStdString(),
+			getOutputPath(outDir, input.completeBaseName() + extension).toStdString());
+		setStatsPath(job, defaults, input.completeBaseName() + extension);
+		jobs.push_back(job);
+	}
+
+	return 0;
+}
+
+// Gives a file its own report in the --stats directory of the defaults, named after
+// its output, unless its manifest line names a report of its own
+void BatchConverter::setStatsPath(Job& job, const ConverterOptions& defaults, const QString& outputPath)
+{
+	if (defaults.statsFileName.empty() || job.options.statsFileName != defaults.statsFileName)
+		return;
+
+	QString statsDir = QString::fromStdString(defaults.statsFileName);
+	job.options.statsFileName = getOutputPath(statsDir, outputPath + ".stats.json").toStdString();
+}
+
+// Resolves an output path against the output directory
+QString BatchConverter::getOutputPath(const QString& outDir, const QString& path)
+{
+	return QDir(outDir).filePath(path);
+}
+
+// Checks a cleaned output path is relative and does not climb out of the output directory
+bool BatchConverter::isInsideOutputDir(const QString& path)
+{
+	return !QDir::isAbsolutePath(path) && path != ".." && !path.startsWith("../");
+}
+
+void BatchConverter::convert()
+{
+	// Each file gets its own converter, so files share no state.
+	// Converters also split their nodes across the pool, which keeps workers
+	// busy when few large files are left.
+	// Errors are collected per file and reported once all are done
+	ThreadPool pool(threadCount);
+	for (Job& job : jobs)
+	{
+		if (job.result != 0)
+			continue;
+
+		pool.submit([&job, &pool]()
+		{
+			std::ostringstream err;
+			try
+			{
+				Converter converter(job.options, err, &pool);
+				job.result = converter.result;
+			}
+			catch (const std::exception& e)
+			{
+				err << e.what();
+				job.result = 7;
+			}
+			job.error = err.str();
+		});
+	}
+	pool.wait();
+
+	size_t failed = 0;
+	for (const Job& job : jobs)
+	{
+		if (job.result == 0)
+			continue;
+		std::cerr << job.options.inFileName << ": " << job.error << "\n";
+		failed++;
+	}
+	std::cout << "Converted " << jobs.size() - failed << " of " << jobs.size() << " files";
+
+	if (failed > 0)
+		result = 7;
+}
@@ -0,0 +1,86 @@
+#include <binary-io/byte-swap.h>
+#include <cpu-features.h>
+
+#include <QtEndian>
+
+#include <cstring>
+
+namespace
+{
+	void byteSwap32Scalar(const uchar* src, uchar* dst, qsizetype count)
+	{
+		for (qsizetype i = 0; i < count; ++i)
+		{
+			quint32 word = qFromBigEndian<quint32>(src + i * 4);
+			memcpy(dst + i * 4, &word, 4);
+		}
+	}
+
+#ifdef CPU_X86
+	TARGET_SSSE3 void byteSwap32Ssse3(const uchar* src, uchar* dst, qsizetype count)
+	{
+		const __m128i mask = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+		qsizetype i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i words = _mm_loadu_si128((const __m128i*)(src + i * 4));
+			_mm_storeu_si128((__m128i*)(dst + i * 4), _mm_shuffle_epi8(words, mask));
+		}
+		byteSwap32Scalar(src + i * 4, dst + i * 4, count - i);
+	}
+
+	TARGET_AVX2 void byteSwap32Avx2(const uchar* src, uchar* dst, qsizetype count)
+	{
+		// vpshufb shuffles within each 128 bit lane, so the mask is repeated per lane
+		const __m256i mask = _mm256_set_epi8(
+			12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+			12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+		qsizetype i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256i words = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+			_mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_shuffle_epi8(words, mask));
+		}
+		byteSwap32Ssse3(src + i * 4, dst + i * 4, count - i);
+	}
+
+	enum class Kernel
+	{
+		scalar,
+		ssse3,
+		avx2
+	};
+
+	Kernel detectKernel()
+	{
+		const CpuFeatures& features = getCpuFeatures();
+		if (features.avx2)
+			return Kernel::avx2;
+		if (features.ssse3)
+			return Kernel::ssse3;
+		return Kernel::scalar;
+	}
+#endif
+}
+
+// Copies count 32 bit words from src to dst, reversing the byte order of each.
+// Uses AVX2 or SSSE3 shuffles when the CPU supports them, with a scalar fallback.
+// src and dst do not need to be aligned.
+void byteSwap32(const uchar* src, void* dst, qsizetype count)
+{
+#ifdef CPU_X86
+	static const Kernel kernel = detectKernel();
+	switch (kernel)
+	{
+	case Kernel::avx2:
+		byteSwap32Avx2(src, (uchar*)dst, count);
+		return;
+	case Kernel::ssse3:
+		byteSwap32Ssse3(src, (uchar*)dst, count);
+		return;
+	case Kernel::scalar:
+		break;
+	}
+#endif
+	byteSwap32Scalar(src, (uchar*)dst, count);
+}
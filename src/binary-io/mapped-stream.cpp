@@ -0,0 +1,58 @@
+#include <binary-io/mapped-stream.h>
+
+MappedFile::MappedFile()
+{
+
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+// Maps the specified file
+// Returns false if the file could not be opened or mapped
+bool MappedFile::open(const QString& fileName)
+{
+	close();
+
+	file.setFileName(fileName);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	length = file.size();
+	if (length > 0)
+	{
+		bytes = file.map(0, length);
+		if (bytes == nullptr)
+		{
+			close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Unmaps and closes the file
+void MappedFile::close()
+{
+	if (bytes != nullptr)
+		file.unmap((uchar*)bytes);
+	if (file.isOpen())
+		file.close();
+	bytes = nullptr;
+	length = 0;
+}
+
+// Get the mapped bytes
+const uchar* MappedFile::data()
+{
+	return bytes;
+}
+
+// Get the size of the mapped bytes
+qint64 MappedFile::size()
+{
+	return length;
+}
@@ -0,0 +1,30 @@
+#include <collected-set.h>
+
+#include <algorithm>
+
+// Sorts and deduplicates the IDs
+void CollectedSet::finalize()
+{
+	std::sort(ids.begin(), ids.end());
+	ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
+
+// Get whether an ID has been collected
+bool CollectedSet::contains(uint64_t id) const
+{
+	if (ids.empty())
+		return false;
+
+	// Narrow to the last ID not greater than the one searched for.
+	// The comparison compiles to a conditional move, so the loop runs
+	// the same log2(n) iterations regardless of the IDs
+	const uint64_t* base = ids.data();
+	size_t count = ids.size();
+	while (count > 1)
+	{
+		size_t half = count / 2;
+		base = base[half] <= id ? base + half : base;
+		count -= half;
+	}
+	return *base == id;
+}
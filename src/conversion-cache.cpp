@@ -0,0 +1,212 @@
+#include <conversion-cache.h>
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLockFile>
+#include <QTemporaryDir>
+#include <QTemporaryFile>
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+	// Lists the files of an entry. Its modification time is when the entry was last used
+	const char* manifestName = "manifest";
+
+	// Holds the files of an entry
+	const char* filesName = "files";
+
+	// Files of an entry marking it as being copied out, so it is not evicted
+	const char* pinPrefix = "pin-";
+
+	// Holds the total size of the entries, kept by stores and rebuilt by evictions
+	const char* sizeName = "size";
+
+	// Temporary entries and pins older than this were left by a process that stopped while using them
+	const qint64 staleTemporaryAge = 24 * 60 * 60 * 1000;
+
+	// Get the total size of the entries, or -1 if it is not known
+	qint64 readTotalSize(const QDir& cacheDir)
+	{
+		QFile file(cacheDir.filePath(sizeName));
+		if (!file.open(QIODevice::ReadOnly))
+			return -1;
+		bool valid = false;
+		qint64 size = file.readAll().trimmed().toLongLong(&valid);
+		return valid ? size : -1;
+	}
+
+	void writeTotalSize(const QDir& cacheDir, qint64 size)
+	{
+		QFile file(cacheDir.filePath(sizeName));
+		if (file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+			file.write(QByteArray::number(size));
+	}
+
+	// Replaces a file with a copy of another. Returns false if copying failed
+	bool copyFile(const QString& source, const QString& destination)
+	{
+		if (QFileInfo::exists(destination) && !QFile::remove(destination))
+			return false;
+		return QFile::copy(source, destination);
+	}
+}
+
+ConversionCache::ConversionCache(const QString& dir, qint64 maxSize)
+	: dir(dir), maxSize(maxSize)
+{
+}
+
+// Copies the files of an entry to an output file, or into an output directory if
+// tiled. outputFiles receives the paths written. Returns false on a miss
+bool ConversionCache::restore(const QByteArray& key, const QString& output, bool tiled, QStringList& outputFiles)
+{
+	QDir cacheDir(dir);
+	if (!cacheDir.exists())
+		return false;
+
+	// The entry is only read and pinned under the lock
+	QLockFile lock(cacheDir.filePath("lock"));
+	lock.setStaleLockTime(0);
+	if (!lock.lock())
+		return false;
+
+	QDir entry(cacheDir.filePath(QString::fromLatin1(key)));
+	QFile manifest(entry.filePath(manifestName));
+	if (!manifest.open(QIODevice::ReadOnly))
+		return false;
+	QStringList files = QString::fromUtf8(manifest.readAll()).split('\n', Qt::SkipEmptyParts);
+	if (files.isEmpty() || (!tiled && files.size() != 1))
+		return false;
+
+	// The pin keeps the entry from being evicted until it is removed on return
+	QTemporaryFile pin(entry.filePath(QString(pinPrefix) + "XXXXXX"));
+	if (!pin.open())
+		return false;
+	manifest.setFileTime(QDateTime::currentDateTimeUtc(), QFileDevice::FileModificationTime);
+	lock.unlock();
+
+	QDir entryFiles(entry.filePath(filesName));
+	for (const QString& file : files)
+	{
+		QString destination = tiled ? QDir(output).filePath(file) : output;
+		if (!copyFile(entryFiles.filePath(file), destination))
+			return false;
+		outputFiles.append(destination);
+	}
+
+	return true;
+}
+
+// Adds the files of an output as an entry. Returns false if it could not be added
+bool ConversionCache::store(const QByteArray& key, const QStringList& outputFiles)
+{
+	QDir cacheDir(dir);
+	if (!cacheDir.mkpath("."))
+		return false;
+
+	// Files are copied without holding the lock, into a temporary entry
+	QTemporaryDir temporary(cacheDir.filePath(QString::fromLatin1(key) + "-XXXXXX.tmp"));
+	if (!temporary.isValid() || !QDir(temporary.path()).mkpath(filesName))
+		return false;
+
+	QStringList files;
+	qint64 entrySize = 0;
+	for (const QString& outputFile : outputFiles)
+	{
+		QString file = QFileInfo(outputFile).fileName();
+		if (!QFile::copy(outputFile, QDir(temporary.filePath(filesName)).filePath(file)))
+			return false;
+		files.append(file);
+		entrySize += QFileInfo(outputFile).size();
+	}
+
+	QFile manifest(temporary.filePath(manifestName));
+	QByteArray manifestData = files.join('\n').toUtf8();
+	if (!manifest.open(QIODevice::WriteOnly) || manifest.write(manifestData) != manifestData.size())
+		return false;
+	manifest.close();
+
+	QLockFile lock(cacheDir.filePath("lock"));
+	lock.setStaleLockTime(0);
+	if (!lock.lock())
+		return false;
+
+	// Another worker may have added the same entry first
+	QString entryPath = cacheDir.filePath(QString::fromLatin1(key));
+	if (QFileInfo::exists(entryPath))
+		return true;
+	if (!QDir().rename(temporary.path(), entryPath))
+		return false;
+	temporary.setAutoRemove(false);
+
+	// Entries are only listed when the total is unknown or over the limit
+	qint64 totalSize = readTotalSize(cacheDir);
+	if (totalSize < 0 || totalSize + entrySize > maxSize)
+		evict();
+	else
+		writeTotalSize(cacheDir, totalSize + entrySize);
+	return true;
+}
+
+// Removes the least recently used entries that are not pinned until the cache fits
+// its size limit, and records the size left. Must be called with the cache locked
+void ConversionCache::evict()
+{
+	struct Entry
+	{
+		QString path;
+		qint64 lastUsed = 0;
+		qint64 size = 0;
+		bool pinned = false;
+	};
+
+	std::vector<Entry> entries;
+	qint64 totalSize = 0;
+	qint64 now = QDateTime::currentMSecsSinceEpoch();
+	QFileInfoList entryInfos = QDir(dir).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+	for (const QFileInfo& entryInfo : entryInfos)
+	{
+		QDir entryDir(entryInfo.filePath());
+		if (entryInfo.suffix() == "tmp")
+		{
+			if (now - entryInfo.lastModified().toMSecsSinceEpoch() > staleTemporaryAge)
+				entryDir.removeRecursively();
+			continue;
+		}
+
+		// Entries without a manifest are incomplete, and evicted first
+		Entry entry;
+		entry.path = entryInfo.filePath();
+		QFileInfo manifest(entryDir.filePath(manifestName));
+		if (manifest.exists())
+			entry.lastUsed = manifest.lastModified().toMSecsSinceEpoch();
+		QFileInfoList files = QDir(entryDir.filePath(filesName)).entryInfoList(QDir::Files);
+		for (const QFileInfo& file : files)
+			entry.size += file.size();
+		QFileInfoList pins = entryDir.entryInfoList(QStringList(QString(pinPrefix) + "*"), QDir::Files);
+		for (const QFileInfo& pin : pins)
+		{
+			if (now - pin.lastModified().toMSecsSinceEpoch() > staleTemporaryAge)
+				QFile::remove(pin.filePath());
+			else
+				entry.pinned = true;
+		}
+		totalSize += entry.size;
+		entries.push_back(entry);
+	}
+
+	std::sort(entries.begin(), entries.end(),
+		[](const Entry& a, const Entry& b) { return a.lastUsed < b.lastUsed; });
+	for (const Entry& entry : entries)
+	{
+		if (totalSize <= maxSize)
+			break;
+		if (!entry.pinned && QDir(entry.path).removeRecursively())
+			totalSize -= entry.size;
+	}
+	writeTotalSize(QDir(dir), totalSize);
+}
@@ -2,149 +2,466 @@
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 
+#include <conversion-cache.h>
 #include <converter.h>
+#include <rotation.h>
 
 #include <QBuffer>
+#include <QCryptographicHash>
+#include <QDir>
 #include <QFile>
 #include <QFileInfo>
-#include <QScopedPointer>
 
+#include <algorithm>
+#include <bit>
+#include <cmath>
 #include <iostream>
 
 using namespace BrnTrigger;
 using namespace tinygltf;
 
 Converter::Converter(int argc, char* argv[])
-	: triggerData(new TriggerData)
+	: err(std::cerr), ownedPool(new ThreadPool), pool(ownedPool.get())
 {
+	stats.beginPhase("checkArgs");
 	result = getArgs(argc, argv);
 	if (result != 0)
 		return;
 
-	readTriggerData();
-	if (!profileFileName.empty())
-		readProfileTriggers();
-	convertTriggersToGLTF();
+	if (!options.statsFileName.empty())
+		RunStats::enableAllocationCounting();
+	run();
+}
+
+// Conversions sharing the process, as in batch and watch mode, only report wall time
+Converter::Converter(const ConverterOptions& options, std::ostream& err, ThreadPool* pool, bool convert)
+	: options(options), err(err), pool(pool), stats(false)
+{
+	if (convert)
+		run();
+	else
+		result = readTriggers();
 }
 
 Converter::~Converter()
 {
-	if (inStream.device() != nullptr)
-		delete inStream.device();
 	if (triggerData != nullptr)
 		delete triggerData;
 }
 
-int Converter::getArgs(int argc, char* argv[])
+// Converts the file again after its input or savegame changed.
+// The parsed input and its index are kept unless the input changed
+void Converter::reconvert(bool inputChanged)
 {
-	int checkResult = checkArgs(argc, argv);
+	if (inputChanged && triggerData != nullptr)
+	{
+		delete triggerData;
+		triggerData = nullptr;
+	}
+
+	stats = RunStats(false);
+	outputFiles.clear();
+	run();
+}
+
+void Converter::run()
+{
+	result = convert();
+	if (!options.statsFileName.empty())
+		writeStats();
+}
+
+int Converter::convert()
+{
+	stats.beginPhase("checkFiles");
+	int checkResult = checkFiles();
 	if (checkResult != 0)
 		return checkResult;
 
-	for (int i = 1; i < argc - 2; ++i)
+	if (options.cacheDir.empty())
+		return convertTriggers();
+
+	// Outputs of earlier conversions with the same inputs and options are copied instead
+	stats.beginPhase("checkCache");
+	ConversionCache cache(QString::fromStdString(options.cacheDir), options.cacheSize);
+	QByteArray cacheKey = getCacheKey();
+	if (!cacheKey.isEmpty() && cache.restore(cacheKey, QString::fromStdString(options.outFileName),
+		options.writesDirectory(), outputFiles))
 	{
-		// Set big endian and 64 bit based on provided platform
-		if (strcmp(argv[i], "-p") == 0)
-		{
-			QString platform = argv[i + 1];
-			if (platform == "PC")
-				this->platform = Platform::PC;
-			else if (platform == "PS3")
-				this->platform = Platform::PS3;
-			else if (platform == "PS4")
-				this->platform = Platform::PS4;
-			else if (platform == "X360")
-				this->platform = Platform::X360;
-			else if (platform == "NX")
-				this->platform = Platform::NX;
-
-			if (this->platform == Platform::PC)
-				return 0;
-			else if (this->platform == Platform::PS3 || this->platform == Platform::X360)
-				inStream.setByteOrder(QDataStream::BigEndian);
-			else if (this->platform == Platform::PS4 || this->platform == Platform::NX)
-				inStream.setIs64Bit(true);
-
-			i++;
-		}
-		else if (strcmp(argv[i], "-f") == 0)
-		{
-			uint8_t filter = atoi(argv[i + 1]);
-			if (filter >= 0)
-				typeFilter = filter;
-			i++;
-		}
-		else if (strcmp(argv[i], "-s") == 0)
-		{
-			profileFileName = argv[i + 1];
-			i++;
-		}
-		else
-		{
-			std::cerr << "Invalid option specified: " << argv[i];
-			return 4;
-		}
+		stats.setCount("cacheHits", 1);
+		for (const QString& file : outputFiles)
+			stats.addBytesWritten(QFileInfo(file).size());
+		return 0;
+	}
+	stats.setCount("cacheHits", 0);
+	outputFiles.clear();
+
+	int convertResult = convertTriggers();
+	if (convertResult == 0 && !cacheKey.isEmpty())
+	{
+		// A cache that can't be written only costs later runs a conversion
+		stats.beginPhase("storeCache");
+		cache.store(cacheKey, outputFiles);
+	}
+	return convertResult;
+}
+
+// Reads the input and writes the output
+int Converter::convertTriggers()
+{
+	// Input parsed by an earlier conversion is reused
+	if (triggerData == nullptr)
+	{
+		int readResult = readTriggers();
+		if (readResult != 0)
+			return readResult;
+	}
+
+	if (!options.profileFileName.empty())
+	{
+		stats.beginPhase("readProfileTriggers");
+		int profileResult = readProfileTriggers();
+		if (profileResult != 0)
+			return profileResult;
+		stats.setCount("collectedTriggers", hitTriggerIds.size());
+	}
+
+	if (options.tileMode != TileMode::none)
+		return convertTriggersToTiles();
+	if (options.split)
+		return convertTriggersToSplit();
+	return convertTriggersToGLTF();
+}
+
+// Reads the input and selects the triggers to convert. Returns 0 on success
+int Converter::readTriggers()
+{
+	std::string error;
+	if (!options.selection.empty() && !selection.parse(options.selection, error))
+	{
+		err << "Invalid selection: " << error;
+		return 4;
 	}
 
-	inStream.setDevice(new QFile(argv[argc - 2]));
-	inFileName = argv[argc - 2];
-	outFileName = argv[argc - 1];
+	stats.beginPhase("readTriggerData");
+	triggerData = new TriggerData;
+	int readResult = readTriggerData();
+	if (readResult != 0)
+	{
+		delete triggerData;
+		triggerData = nullptr;
+		return readResult;
+	}
+
+	if (!options.selection.empty())
+	{
+		stats.beginPhase("selectTriggers");
+		selectTriggers();
+	}
 
 	return 0;
 }
 
-int Converter::checkArgs(int argc, char* argv[])
+// Hashes the input, the savegame, and every option the output depends on.
+// Returns an empty key if they can't be read
+QByteArray Converter::getCacheKey()
 {
-	// Ensure minimum argument count is reached
-	if (argc < minArgCount)
+	// The version changes whenever the output for the same inputs does
+	const int64_t version = 3;
+	int64_t settings[] = {
+		version,
+		(int64_t)options.platform,
+		(int64_t)options.exportMode,
+		(int64_t)options.selection.size(),
+		options.writeBinary,
+		(int64_t)options.tileMode,
+		std::bit_cast<int32_t>(options.tileSize),
+		options.tileCapacity,
+		options.split,
+		!options.profileFileName.empty()
+	};
+
+	QCryptographicHash hash(QCryptographicHash::Sha256);
+	hash.addData(QByteArray::fromRawData((const char*)settings, sizeof(settings)));
+	hash.addData(QByteArray::fromStdString(options.selection));
+
+	QFile input(QString::fromStdString(options.inFileName));
+	if (!input.open(QIODevice::ReadOnly) || !hash.addData(&input))
+		return QByteArray();
+	stats.addBytesRead(input.size());
+	if (!options.profileFileName.empty())
 	{
-		showUsage();
-		return 1;
+		QFile profile(QString::fromStdString(options.profileFileName));
+		if (!profile.open(QIODevice::ReadOnly) || !hash.addData(&profile))
+			return QByteArray();
+		stats.addBytesRead(profile.size());
 	}
 
-	// Check input file exists
-	QFile in(argv[argc - 2]);
-	QFileInfo inputInfo(in);
-	if (!inputInfo.exists() || !inputInfo.isFile())
+	return hash.result().toHex();
+}
+
+// Writes the report requested with --stats
+void Converter::writeStats()
+{
+	static const char* platforms[] = { "PS3", "X360", "PC", "PS4", "NX" };
+	static const char* exportModes[] = { "nodes", "instanced", "metadata" };
+
+	QFile file(QString::fromStdString(options.statsFileName));
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
 	{
-		std::cout << "Invalid input file";
-		return 2;
+		err << "Failed to open stats file";
+		if (result == 0)
+			result = 6;
+		return;
 	}
 
-	// Check output does not exist as a non-file
-	QFile out(argv[argc - 1]);
-	QFileInfo outputInfo(out);
-	if (outputInfo.exists() && !outputInfo.isFile())
+	JsonWriter json(&file, true);
+	json.beginObject();
+	json.key("input");
+	json.value(options.inFileName);
+	json.key("output");
+	json.value(options.outFileName);
+	json.key("platform");
+	json.value(platforms[(int)options.platform]);
+	json.key("exportMode");
+	json.value(exportModes[(int)options.exportMode]);
+	json.key("result");
+	json.value(result);
+	stats.write(json);
+	json.endObject();
+	if (!json.flush())
 	{
-		std::cerr << "Output location exists and is not a file, cannot overwrite";
-		return 3;
+		err << "Failed to write stats file";
+		if (result == 0)
+			result = 6;
+	}
+}
+
+int ConverterOptions::parse(const QStringList& args, std::ostream& err)
+{
+	for (int i = 0; i < args.size(); ++i)
+	{
+		// Options with a value
+		if (i + 1 < args.size())
+		{
+			// Set platform. Selects the byte order and pointer width the input is parsed with
+			if (args[i] == "-p")
+			{
+				QString platform = args[i + 1];
+				if (platform == "PC")
+					this->platform = Platform::PC;
+				else if (platform == "PS3")
+					this->platform = Platform::PS3;
+				else if (platform == "PS4")
+					this->platform = Platform::PS4;
+				else if (platform == "X360")
+					this->platform = Platform::X360;
+				else if (platform == "NX")
+					this->platform = Platform::NX;
+
+				i++;
+				continue;
+			}
+			// Shorthand for a selection of one generic region type
+			else if (args[i] == "-f")
+			{
+				bool valid = false;
+				int filter = args[i + 1].toInt(&valid);
+				if (!valid || filter < 0 || filter > 255)
+				{
+					err << "Invalid type filter: " << args[i + 1].toStdString();
+					return 4;
+				}
+				selection = "type=" + std::to_string(filter);
+				i++;
+				continue;
+			}
+			else if (args[i] == "--select")
+			{
+				// Checked here so batch jobs fail before converting
+				std::string error;
+				TriggerSelection check;
+				if (!check.parse(args[i + 1].toStdString(), error))
+				{
+					err << "Invalid selection: " << error;
+					return 4;
+				}
+				selection = args[i + 1].toStdString();
+				i++;
+				continue;
+			}
+			else if (args[i] == "-s")
+			{
+				profileFileName = args[i + 1].toStdString();
+				i++;
+				continue;
+			}
+			else if (args[i] == "--stats")
+			{
+				statsFileName = args[i + 1].toStdString();
+				i++;
+				continue;
+			}
+			else if (args[i] == "--cache")
+			{
+				cacheDir = args[i + 1].toStdString();
+				i++;
+				continue;
+			}
+			else if (args[i] == "--cache-size")
+			{
+				qint64 megabytes = args[i + 1].toLongLong();
+				if (megabytes <= 0)
+				{
+					err << "Invalid cache size: " << args[i + 1].toStdString();
+					return 4;
+				}
+				cacheSize = megabytes * 1024 * 1024;
+				i++;
+				continue;
+			}
+			else if (args[i] == "--grid")
+			{
+				tileMode = TileMode::grid;
+				tileSize = args[i + 1].toFloat();
+				if (!(tileSize > 0.0f))
+				{
+					err << "Invalid tile size: " << args[i + 1].toStdString();
+					return 4;
+				}
+				i++;
+				continue;
+			}
+			else if (args[i] == "--quadtree")
+			{
+				tileMode = TileMode::quadtree;
+				tileCapacity = args[i + 1].toInt();
+				if (tileCapacity <= 0)
+				{
+					err << "Invalid tile trigger count: " << args[i + 1].toStdString();
+					return 4;
+				}
+				i++;
+				continue;
+			}
+			else if (args[i] == "-m")
+			{
+				QString mode = args[i + 1];
+				if (mode == "nodes")
+					exportMode = ExportMode::nodes;
+				else if (mode == "instanced")
+					exportMode = ExportMode::instanced;
+				else if (mode == "metadata")
+					exportMode = ExportMode::metadata;
+				else
+				{
+					err << "Invalid export mode: " << mode.toStdString();
+					return 4;
+				}
+				i++;
+				continue;
+			}
+		}
+
+		if (args[i] == "-b")
+			writeBinary = true;
+		else if (args[i] == "--split")
+			split = true;
+		else
+		{
+			err << "Invalid option specified: " << args[i].toStdString();
+			return 4;
+		}
+	}
+
+	if (split && tileMode != TileMode::none)
+	{
+		err << "--split cannot be combined with --grid or --quadtree";
+		return 4;
 	}
 
 	return 0;
 }
 
-void Converter::showUsage()
+void ConverterOptions::setFiles(const std::string& in, const std::string& out)
 {
-	std::cout << "Usage: TriggersToGLTF [options] <input file> <output file>\n\n"
-		<< "Options:\n"
-		<< " -p   File platform. PS3, X360, PC, PS4, or NX. Default: PC\n"
-		<< " -f   GenericRegion type filter (an integer number). By default, all are converted.\n"
-		<< " -s   Export only triggers not present in the provided savegame.\n"
-		<< "      Ignored if not used with filters 8, 9, or 13 (collectibles).";
+	inFileName = in;
+	outFileName = out;
+
+	// Write binary glTF when the output has its extension
+	if (QFileInfo(QString::fromStdString(outFileName)).suffix().toLower() == "glb")
+		writeBinary = true;
+}
+
+namespace
+{
+	template <typename Traits>
+	QDataStream::Status parseWithTraits(const uchar* data, qint64 size, TriggerData& triggerData, uint16_t sections)
+	{
+		MappedStream<Traits> stream(data, size);
+		triggerData.read(stream, sections);
+		return stream.status();
+	}
 }
 
-void Converter::readTriggerData()
+// Parses the header and the sections in a mask of TriggerData::Section values of a
+// triggers resource in the layout of a platform. Returns the stream status
+QDataStream::Status parseTriggerResource(const uchar* data, qint64 size, ConverterOptions::Platform platform,
+	TriggerData& triggerData, uint16_t sections)
 {
-	inStream.open(QIODevice::ReadOnly);
-	triggerData->read(inStream);
-	inStream.close();
+	using Platform = ConverterOptions::Platform;
+	switch (platform)
+	{
+	case Platform::PS3:
+	case Platform::X360:
+		return parseWithTraits<BigEndian32Traits>(data, size, triggerData, sections);
+	case Platform::PS4:
+	case Platform::NX:
+		return parseWithTraits<LittleEndian64Traits>(data, size, triggerData, sections);
+	case Platform::PC:
+		break;
+	}
+	return parseWithTraits<PCTraits>(data, size, triggerData, sections);
 }
 
-void Converter::readProfileTriggers()
+namespace
 {
-	DataStream profile;
-	profile.setDevice(new QFile(QString::fromStdString(profileFileName)));
-	profile.open(QIODevice::ReadOnly);
+	// Reads count stunt element IDs from an offset
+	void readStuntElements(MappedStream<PCTraits>& stream, int offset, int count, CollectedSet& collected)
+	{
+		uint64_t id = 0;
+		stream.seek(offset);
+		for (int i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+		{
+			stream >> id;
+			collected.insert(id);
+		}
+	}
+
+	// Reads count island stunt element IDs, each followed by 4 bytes, from an offset
+	void readIslandStuntElements(MappedStream<PCTraits>& stream, int offset, int count, CollectedSet& collected)
+	{
+		uint32_t id = 0;
+		stream.seek(offset);
+		for (int i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+		{
+			stream >> id;
+			stream.skip(4);
+			collected.insert((uint64_t)id);
+		}
+	}
+}
+
+// Reads the IDs of the stunt elements collected in a savegame in the layout of a
+// platform, then finalizes the set. Returns the stream status, which is not Ok if the
+// savegame is truncated or its counts don't fit the layout
+QDataStream::Status parseSavegame(const uchar* data, qint64 size, ConverterOptions::Platform platform,
+	CollectedSet& collected)
+{
+	using Platform = ConverterOptions::Platform;
+
+	// Savegames are little endian on every platform
+	MappedStream<PCTraits> profile(data, size);
 
 	// Set offsets based on platform
 	int base = 0; // Profile start offset
@@ -165,22 +482,24 @@ void Converter::readProfileTriggers()
 	profile >> smashCount;
 	profile.seek(stunts + alloc * 8 * 3 + 8 * 2);
 	profile >> billboardCount;
+	if (profile.status() == QDataStream::Ok && (jumpCount < 0 || jumpCount > alloc || smashCount < 0
+		|| smashCount > alloc || billboardCount < 0 || billboardCount > alloc))
+	{
+		collected.finalize();
+		return QDataStream::ReadCorruptData;
+	}
 
 	// Read triggers
-	readStuntElements(profile, stunts, jumpCount); // Jumps
-	readStuntElements(profile, stunts + alloc * 8 + 8, smashCount); // Smashes
-	readStuntElements(profile, stunts + alloc * 8 * 2 + 8 * 2, smashCount); // Billboards
+	readStuntElements(profile, stunts, jumpCount, collected); // Jumps
+	readStuntElements(profile, stunts + alloc * 8 + 8, smashCount, collected); // Smashes
+	readStuntElements(profile, stunts + alloc * 8 * 2 + 8 * 2, billboardCount, collected); // Billboards
 
 	// Make sure this is not the original PC game,
 	// because that version does not have the island
-	if (platform == Platform::PC)
+	if (platform == Platform::PC && size == 0x5D246)
 	{
-		QFileInfo info(QString::fromStdString(profileFileName));
-		if (info.size() == 0x5D246)
-		{
-			profile.close();
-			return;
-		}
+		collected.finalize();
+		return profile.status();
 	}
 
 	// Island offsets
@@ -216,45 +535,220 @@ void Converter::readProfileTriggers()
 	int bsiJumpCount = 0;
 	profile.seek(bsiBillboards + bsiBillboardAlloc * 8);
 	profile >> bsiBillboardCount;
-	profile.seek(bsiSmashes + bsiSmashAlloc + 8);
+	profile.seek(bsiSmashes + bsiSmashAlloc * 8);
 	profile >> bsiSmashCount;
 	profile.seek(bsiJumps + bsiJumpAlloc * 8);
 	profile >> bsiJumpCount;
+	if (profile.status() == QDataStream::Ok && (bsiBillboardCount < 0 || bsiBillboardCount > bsiBillboardAlloc
+		|| bsiSmashCount < 0 || bsiSmashCount > bsiSmashAlloc || bsiJumpCount < 0 || bsiJumpCount > bsiJumpAlloc))
+	{
+		collected.finalize();
+		return QDataStream::ReadCorruptData;
+	}
 
 	// Read island triggers
-	readIslandStuntElements(profile, bsiBillboards, bsiBillboardCount); // Island billboards
-	readIslandStuntElements(profile, bsiSmashes, bsiSmashCount); // Island smashes
-	readIslandStuntElements(profile, bsiJumps, bsiJumpCount); // Island jumps
+	readIslandStuntElements(profile, bsiBillboards, bsiBillboardCount, collected); // Island billboards
+	readIslandStuntElements(profile, bsiSmashes, bsiSmashCount, collected); // Island smashes
+	readIslandStuntElements(profile, bsiJumps, bsiJumpCount, collected); // Island jumps
+
+	collected.finalize();
+	return profile.status();
+}
+
+// Maps and parses a triggers resource file. Returns 0 on success
+int readTriggerResource(const QString& fileName, ConverterOptions::Platform platform, TriggerData& triggerData,
+	std::ostream& err)
+{
+	MappedFile file;
+	if (!file.open(fileName))
+	{
+		err << "Failed to map input file";
+		return 5;
+	}
+
+	if (parseTriggerResource(file.data(), file.size(), platform, triggerData) != QDataStream::Ok)
+	{
+		err << "Input file is truncated or not a valid triggers resource";
+		return 5;
+	}
+
+	return 0;
+}
+
+int Converter::getArgs(int argc, char* argv[])
+{
+	int checkResult = checkArgs(argc, argv);
+	if (checkResult != 0)
+		return checkResult;
+
+	QStringList args;
+	for (int i = 1; i < argc - 2; ++i)
+		args.append(QString::fromLocal8Bit(argv[i]));
+	int parseResult = options.parse(args, err);
+	if (parseResult != 0)
+		return parseResult;
+
+	options.setFiles(argv[argc - 2], argv[argc - 1]);
+
+	return 0;
+}
+
+int Converter::checkArgs(int argc, char* argv[])
+{
+	// Ensure minimum argument count is reached
+	if (argc < minArgCount)
+	{
+		showUsage();
+		return 1;
+	}
+
+	return 0;
+}
+
+int Converter::checkFiles()
+{
+	// Check input file exists
+	QFile in(QString::fromStdString(options.inFileName));
+	QFileInfo inputInfo(in);
+	if (!inputInfo.exists() || !inputInfo.isFile())
+	{
+		err << "Invalid input file";
+		return 2;
+	}
+
+	// Tiled and split output is a directory, created if needed
+	if (options.writesDirectory())
+	{
+		QString outDir = QString::fromStdString(options.outFileName);
+		QFileInfo outputInfo(outDir);
+		if ((outputInfo.exists() && !outputInfo.isDir()) || !QDir().mkpath(outDir))
+		{
+			err << "Output location is not a directory and cannot be created";
+			return 3;
+		}
+		return 0;
+	}
 
-	profile.close();
+	// Check output does not exist as a non-file
+	QFile out(QString::fromStdString(options.outFileName));
+	QFileInfo outputInfo(out);
+	if (outputInfo.exists() && !outputInfo.isFile())
+	{
+		err << "Output location exists and is not a file, cannot overwrite";
+		return 3;
+	}
+
+	return 0;
+}
+
+void Converter::showUsage()
+{
+	std::cout << "Usage: TriggersToGLTF [options] <input file> <output file>\n\n"
+		<< "Options:\n"
+		<< " -p   File platform. PS3, X360, PC, PS4, or NX. Default: PC\n"
+		<< " -f   GenericRegion type filter (an integer number). Shorthand for --select type=N.\n"
+		<< " --select  Convert only the triggers matching an expression, described in the readme.\n"
+		<< "           For example: \"type=jump,smash and oneWay=0 or kind=landmark\"\n"
+		<< " -s   Export only triggers not present in the provided savegame.\n"
+		<< "      Only applies to generic regions of types 8, 9, or 13 (collectibles) in a selection.\n"
+		<< " -b   Write binary glTF (GLB). Default if the output file ends in .glb.\n"
+		<< " -m   Export mode. nodes (one node per trigger), instanced (one\n"
+		<< "      EXT_mesh_gpu_instancing node per trigger category), or metadata (one\n"
+		<< "      node per trigger, with attributes in EXT_structural_metadata property\n"
+		<< "      tables). Default: nodes\n"
+		<< " --grid      Write square tiles of this size on the X and Z axes to the output\n"
+		<< "             directory, one glTF per tile, with a 3D Tiles tileset.json index.\n"
+		<< " --quadtree  Like --grid, with quadtree tiles of at most this many triggers.\n"
+		<< " --split  Write one glTF per trigger category and one per generic region type\n"
+		<< "          to the output directory, from a single read of the input.\n"
+		<< " --cache       Directory to keep finished outputs in. Converting the same input,\n"
+		<< "               savegame and options again copies the cached output.\n"
+		<< " --cache-size  Size the cache is kept within, in megabytes. Default: 1024\n"
+		<< " --stats  Write a JSON report of the time, CPU time, and allocations of each\n"
+		<< "          phase, record counts, bytes read and written, and peak memory use.";
 }
 
-void Converter::readStuntElements(DataStream& stream, int offset, int count)
+int Converter::readTriggerData()
 {
-	uint64_t tmpId = 0;
-	stream.seek(offset);
-	for (int i = 0; i < count; ++i)
+	if (!inFile.open(QString::fromStdString(options.inFileName)))
 	{
-		stream >> tmpId;
-		hitTriggerIds.append(tmpId);
+		err << "Failed to map input file";
+		return 5;
 	}
+
+	// Selections only read the sections holding triggers they can select
+	uint16_t sections = TriggerData::allSections;
+	if (!options.selection.empty())
+		sections = selection.getSections();
+
+	QDataStream::Status status = parseTriggerResource(inFile.data(), inFile.size(), options.platform, *triggerData,
+		sections);
+	stats.addBytesRead(inFile.size());
+	inFile.close();
+
+	if (status != QDataStream::Ok)
+	{
+		err << "Input file is truncated or not a valid triggers resource";
+		return 5;
+	}
+
+	stats.setCount("landmarks", triggerData->landmarkCount);
+	stats.setCount("signatureStunts", triggerData->signatureStuntCount);
+	stats.setCount("genericRegions", triggerData->genericRegionCount);
+	stats.setCount("killzones", triggerData->killzoneCount);
+	stats.setCount("blackspots", triggerData->blackspotCount);
+	stats.setCount("vfxBoxRegions", triggerData->vfxBoxRegionCount);
+	stats.setCount("roamingLocations", triggerData->roamingLocationCount);
+	stats.setCount("spawnLocations", triggerData->spawnLocationCount);
+	stats.setCount("regions", triggerData->regionCount);
+
+	// Only exports without a selection check for triggers listed in several sections
+	if (options.selection.empty())
+	{
+		stats.beginPhase("buildTriggerIndex");
+		triggerIndex.build(*triggerData);
+	}
+
+	return 0;
+}
+
+// Evaluates the selection over the triggers that were read
+void Converter::selectTriggers()
+{
+	triggerTable.build(*triggerData);
+	selectedRows = selection.evaluate(triggerTable);
+
+	int64_t selectedCount = 0;
+	for (uint64_t word : selectedRows)
+		selectedCount += std::popcount(word);
+	stats.setCount("selectedTriggers", selectedCount);
 }
 
-void Converter::readIslandStuntElements(DataStream& stream, int offset, int count)
+// Reads the IDs collected in the savegame given with -s
+int Converter::readProfileTriggers()
 {
-	uint32_t tmpId = 0;
-	stream.seek(offset);
-	for (int i = 0; i < count; ++i)
+	MappedFile profile;
+	if (!profile.open(QString::fromStdString(options.profileFileName)))
 	{
-		stream >> tmpId;
-		stream.skip(4);
-		hitTriggerIds.append((uint64_t)tmpId);
+		err << "Failed to map savegame file";
+		return 5;
 	}
+
+	hitTriggerIds.clear();
+	QDataStream::Status status = parseSavegame(profile.data(), profile.size(), options.platform, hitTriggerIds);
+	stats.addBytesRead(profile.size());
+	if (status != QDataStream::Ok)
+	{
+		err << "Savegame file is truncated or not a valid savegame";
+		return 5;
+	}
+
+	return 0;
 }
 
-// Creates a file with the box regions converted to triangles
+// Creates the buffer data with the box region converted to triangles
 // Saved as Matrix 3x3 (MAT3)
-Buffer Converter::createGLTFBuffer()
+QByteArray Converter::createGLTFBuffer()
 {
 	QByteArray binData;
 	QBuffer buffer(&binData);
@@ -273,16 +767,7 @@ Buffer Converter::createGLTFBuffer()
 
 	dataStream.close();
 
-	// Write to buffer
-	Buffer gltfBuffer;
-	int64_t size = binData.length();
-	gltfBuffer.data.resize(size);
-	dataStream.open(QIODevice::ReadOnly);
-	for (int i = 0; i < size; ++i)
-		dataStream >> gltfBuffer.data[i];
-	dataStream.close();
-	gltfBuffer.name = "Buffer";
-	return gltfBuffer;
+	return binData;
 }
 
 // Writes a 1x1x1 cube to the stream as a triangle strip (14 verts)
@@ -305,321 +790,979 @@ void Converter::writeBoxRegion(DataStream& stream)
 		<< -0.5f << 0.5f << 0.5f; // Front-top-left
 }
 
-// Modified from https://stackoverflow.com/a/70462919
-Vector4 Converter::EulerToQuatRot(Vector3 euler)
+int Converter::convertTriggersToGLTF()
 {
-	float cy = (float)qCos(euler.z * 0.5);
-	float sy = (float)qSin(euler.z * 0.5);
-	float cp = (float)qCos(euler.y * 0.5);
-	float sp = (float)qSin(euler.y * 0.5);
-	float cr = (float)qCos(euler.x * 0.5);
-	float sr = (float)qSin(euler.x * 0.5);
+	// Nodes are written to the file as they are converted
+	stats.beginPhase("writeNodes");
+	GltfStreamWriter writer(options.writeBinary);
+	if (!writer.open(QString::fromStdString(options.outFileName)))
+	{
+		err << "Failed to open output file";
+		return 6;
+	}
 
-	return Vector4(
-		sr * cp * cy + cr * sp * sy,
-		cr * sp * cy - sr * cp * sy,
-		cr * cp * sy + sr * sp * cy,
-		cr * cp * cy - sr * sp * sy
-	);
+	addBoxMesh(writer);
+	std::vector<SceneNode> scene = planScene(hitTriggerIds);
+	if (options.exportMode == ExportMode::instanced)
+		writeInstancedNodes(writer, scene);
+	else
+		writeNodes(writer, scene);
+	stats.setCount("nodes", writer.getNodeCount());
+
+	// Write the remaining glTF objects and close the file
+	stats.beginPhase("finishGltf");
+	if (!writer.finish())
+	{
+		err << "Failed to write output file";
+		return 6;
+	}
+	stats.addBytesWritten(QFileInfo(QString::fromStdString(options.outFileName)).size());
+	outputFiles.append(QString::fromStdString(options.outFileName));
+
+	return 0;
 }
 
-void Converter::convertTriggersToGLTF()
+// Writes each tile of the scene to its own file in the output directory,
+// then the tileset indexing them
+int Converter::convertTriggersToTiles()
 {
-	// GLTF object
-	QScopedPointer<Model> model(new Model());
-
-	// Create a default scene
-	model->scenes.push_back(Scene());
-	model->scenes[0].name = "Scene";
-	model->defaultScene = 0;
+	stats.beginPhase("planTiles");
+	std::vector<SceneNode> scene = planScene(hitTriggerIds);
+	std::vector<size_t> itemStarts;
+	std::vector<Tileset::Item> items = getTileItems(scene, itemStarts);
+	itemStarts.push_back(scene.size());
+
+	Tileset tileset;
+	if (options.tileMode == TileMode::grid)
+		tileset.buildGrid(items, options.tileSize);
+	else
+		tileset.buildQuadtree(items, options.tileCapacity);
+	const std::vector<Tileset::Tile>& tiles = tileset.getTiles();
+	stats.setCount("tiles", tiles.size());
+
+	// Tiles are written in parallel, and each converts its nodes on the same pool
+	stats.beginPhase("writeTiles");
+	QDir outDir(QString::fromStdString(options.outFileName));
+	std::string extension = options.getGltfExtension();
+	std::vector<int> nodeCounts(tiles.size());
+	std::vector<uint8_t> written(tiles.size());
+	pool->parallelFor(tiles.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			std::vector<SceneNode> tileScene;
+			for (int item : tiles[i].items)
+				tileScene.insert(tileScene.end(), scene.begin() + itemStarts[item], scene.begin() + itemStarts[item + 1]);
+			QString fileName = outDir.filePath(QString::fromStdString(tiles[i].name + extension));
+			written[i] = writeScene(fileName, tileScene, nodeCounts[i]);
+		}
+	});
 
-	// Create a buffer from the trigger data
-	model->buffers.push_back(createGLTFBuffer());
+	int nodeCount = 0;
+	for (size_t i = 0; i < tiles.size(); ++i)
+	{
+		if (!written[i])
+		{
+			err << "Failed to write tile " << tiles[i].name;
+			return 6;
+		}
+		nodeCount += nodeCounts[i];
+		outputFiles.append(outDir.filePath(QString::fromStdString(tiles[i].name + extension)));
+		stats.addBytesWritten(QFileInfo(outputFiles.back()).size());
+	}
+	stats.setCount("nodes", nodeCount);
 
-	// Create buffer views
-	// 0 = indices, 1 = vertices
-	for (int i = 0; i < 2; ++i)
+	stats.beginPhase("writeTileset");
+	QString tilesetFileName = outDir.filePath("tileset.json");
+	if (!tileset.write(tilesetFileName, extension))
 	{
-		model->bufferViews.push_back(BufferView());
-		model->bufferViews[i].buffer = 0;
+		err << "Failed to write tileset";
+		return 6;
 	}
-	model->bufferViews[0].byteLength = 14 * sizeof(ushort);
-	model->bufferViews[1].byteLength = 14 * (sizeof(float) * 3);
-	model->bufferViews[0].byteOffset = 0;
-	model->bufferViews[1].byteOffset = model->bufferViews[0].byteLength;
-	model->bufferViews[1].byteStride = sizeof(float) * 3;
-	model->bufferViews[0].target = TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER;
-	model->bufferViews[1].target = TINYGLTF_TARGET_ARRAY_BUFFER;
-	model->bufferViews[0].name = "Indices buffer view";
-	model->bufferViews[1].name = "Vertices buffer view";
+	stats.addBytesWritten(QFileInfo(tilesetFileName).size());
+	outputFiles.append(tilesetFileName);
 
-	// Create accessors
-	// 0 = indices, 1 = vertices
-	for (int i = 0; i < 2; ++i)
-	{
-		model->accessors.push_back(Accessor());
-		model->accessors[i].bufferView = i;
-		model->accessors[i].byteOffset = 0;
-		model->accessors[i].count = 14;
-	}
-	model->accessors[0].componentType = TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
-	model->accessors[1].componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
-	model->accessors[0].type = TINYGLTF_TYPE_SCALAR;
-	model->accessors[1].type = TINYGLTF_TYPE_VEC3;
-	model->accessors[1].minValues = { -0.5, -0.5, -0.5 };
-	model->accessors[1].maxValues = { 0.5, 0.5, 0.5 };
-	model->accessors[0].name = "Indices accessor";
-	model->accessors[1].name = "Vertices accessor";
+	return 0;
+}
 
-	// Create mesh
-	model->meshes.push_back(Mesh());
-	model->meshes[0].primitives.push_back(Primitive());
-	model->meshes[0].primitives[0].mode = TINYGLTF_MODE_TRIANGLE_STRIP;
-	model->meshes[0].primitives[0].indices = 0;
-	model->meshes[0].primitives[0].attributes["POSITION"] = 1;
-	model->meshes[0].name = "Mesh";
-
-	// Create nodes
-	// TriggerRegion derived nodes
-	int currentNodeCount = 0;
-	if (typeFilter == -1)
+// Writes one file per trigger category and one per generic region type to the
+// output directory. The input is read once and the files are written in parallel
+int Converter::convertTriggersToSplit()
+{
+	// In SceneNode::Type order
+	static const char* categoryNames[] = {
+		"landmark", "blackspot", "vfxBoxRegion", "signatureStunt", "killzone", "genericRegion", "triggerRegion",
+		"roamingLocation", "spawnLocation"
+	};
+
+	stats.beginPhase("planSplit");
+	std::vector<SceneNode> scene = planScene(hitTriggerIds);
+
+	// Categories hold the root nodes of their type with their children
+	std::vector<std::vector<SceneNode>> categoryScenes(std::size(categoryNames));
+	for (const SceneNode& node : scene)
+		categoryScenes[(int)node.type].push_back(node);
+
+	// Types hold every generic region of their type, including those in signature
+	// stunts and killzones, like a selection of the type
+	std::vector<std::vector<SceneNode>> typeScenes(256);
+	if (options.selection.empty())
 	{
-		int landmarkNodeIndex = currentNodeCount;
-		int landmarkChildCount = 0;
-		for (int i = 0; i < triggerData->landmarkCount; ++i)
+		for (int i = 0; i < triggerData->genericRegionCount; ++i)
 		{
-			model->nodes.push_back(Node());
-			model->nodes.back().mesh = 0;
-			for (int j = 0; j < triggerData->landmarks[i].startingGridCount; ++j)
-			{
-				model->nodes.push_back(Node());
-				model->nodes.back().mesh = 0;
-				model->nodes[landmarkNodeIndex + i + landmarkChildCount].children.push_back(landmarkNodeIndex + i + landmarkChildCount + j + 1);
-				convertStartingGrid(triggerData->landmarks[i].startingGrids[j], model->nodes[landmarkNodeIndex + i + landmarkChildCount + j + 1], j);
-				currentNodeCount++;
-			}
-			convertLandmark(triggerData->landmarks[i], model->nodes[i + landmarkNodeIndex], i);
-			currentNodeCount++;
-			landmarkChildCount += triggerData->landmarks[i].startingGridCount;
-			model->scenes[0].nodes.push_back(landmarkNodeIndex + i + landmarkChildCount - triggerData->landmarks[i].startingGridCount);
+			const GenericRegion& region = triggerData->genericRegions[i];
+			if (!isCollected(region, hitTriggerIds))
+				typeScenes[(uint8_t)region.type].push_back({ SceneNode::Type::genericRegion, i, -1, 0 });
 		}
-		int blackspotNodeIndex = currentNodeCount;
-		for (int i = 0; i < triggerData->blackspotCount; ++i)
+	}
+	else
+	{
+		for (const SceneNode& node : scene)
 		{
-			model->nodes.push_back(Node());
-			model->nodes.back().mesh = 0;
-			convertBlackspot(triggerData->blackspots[i], model->nodes[blackspotNodeIndex + i], i);
-			currentNodeCount++;
-			model->scenes[0].nodes.push_back(blackspotNodeIndex + i);
+			if (node.type == SceneNode::Type::genericRegion)
+				typeScenes[(uint8_t)triggerData->genericRegions[node.index].type].push_back(node);
 		}
-		int vfxBoxRegionNodeIndex = currentNodeCount;
-		for (int i = 0; i < triggerData->vfxBoxRegionCount; ++i)
+	}
+
+	// Empty outputs are skipped
+	std::vector<std::string> names;
+	std::vector<const std::vector<SceneNode>*> scenes;
+	for (size_t i = 0; i < categoryScenes.size(); ++i)
+	{
+		if (categoryScenes[i].empty())
+			continue;
+		names.push_back(categoryNames[i]);
+		scenes.push_back(&categoryScenes[i]);
+	}
+	for (int type = 0; type < (int)typeScenes.size(); ++type)
+	{
+		if (typeScenes[type].empty())
+			continue;
+		const char* typeName = TriggerTable::getTypeName((uint8_t)type);
+		names.push_back("type_" + (typeName != nullptr ? std::string(typeName) : std::to_string(type)));
+		scenes.push_back(&typeScenes[type]);
+	}
+	stats.setCount("outputs", names.size());
+
+	// Outputs only read the shared trigger data, and each converts its nodes on the same pool
+	stats.beginPhase("writeSplit");
+	QDir outDir(QString::fromStdString(options.outFileName));
+	std::string extension = options.getGltfExtension();
+	std::vector<int> nodeCounts(names.size());
+	std::vector<uint8_t> written(names.size());
+	pool->parallelFor(names.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
 		{
-			model->nodes.push_back(Node());
-			model->nodes.back().mesh = 0;
-			convertVfxBoxRegion(triggerData->vfxBoxRegions[i], model->nodes[vfxBoxRegionNodeIndex + i], i);
-			currentNodeCount++;
-			model->scenes[0].nodes.push_back(vfxBoxRegionNodeIndex + i);
+			QString fileName = outDir.filePath(QString::fromStdString(names[i] + extension));
+			written[i] = writeScene(fileName, *scenes[i], nodeCounts[i]);
 		}
+	});
 
-		// Nodes with GenericRegion arrays
-		int signatureStuntNodeIndex = currentNodeCount;
-		int signatureStuntChildCount = 0;
-		for (int i = 0; i < triggerData->signatureStuntCount; ++i)
+	int nodeCount = 0;
+	for (size_t i = 0; i < names.size(); ++i)
+	{
+		if (!written[i])
 		{
-			model->nodes.push_back(Node());
-			for (int j = 0; j < triggerData->signatureStunts[i].stuntElementCount; ++j)
-			{
-				model->nodes.push_back(Node());
-				model->nodes.back().mesh = 0;
-				model->nodes[signatureStuntNodeIndex + i + signatureStuntChildCount].children.push_back(signatureStuntNodeIndex + i + signatureStuntChildCount + j + 1);
-				convertGenericRegion(triggerData->signatureStunts[i].getStuntElement(j), model->nodes[signatureStuntNodeIndex + i + signatureStuntChildCount + j + 1], j);
-				currentNodeCount++;
-			}
-			convertSignatureStunt(triggerData->signatureStunts[i], model->nodes[signatureStuntNodeIndex + i + signatureStuntChildCount], i);
-			currentNodeCount++;
-			signatureStuntChildCount += triggerData->signatureStunts[i].stuntElementCount;
-			model->scenes[0].nodes.push_back(signatureStuntNodeIndex + i + signatureStuntChildCount - triggerData->signatureStunts[i].stuntElementCount);
+			err << "Failed to write output " << names[i];
+			return 6;
+		}
+		nodeCount += nodeCounts[i];
+		outputFiles.append(outDir.filePath(QString::fromStdString(names[i] + extension)));
+		stats.addBytesWritten(QFileInfo(outputFiles.back()).size());
+	}
+	stats.setCount("nodes", nodeCount);
+
+	return 0;
+}
+
+// Gets the items a scene is tiled by. Each root node is an item with its children.
+// Items are placed by the position of their root node, or by the middle of their
+// bounds if it has none. itemStarts receives the index of each root node
+std::vector<Tileset::Item> Converter::getTileItems(const std::vector<SceneNode>& scene, std::vector<size_t>& itemStarts)
+{
+	// Rotations are converted in one batch, for the bounds of rotated boxes
+	std::vector<float> rotationsX(scene.size()), rotationsY(scene.size()), rotationsZ(scene.size());
+	std::vector<float> quats(scene.size() * 4);
+	for (size_t i = 0; i < scene.size(); ++i)
+	{
+		Vector3 euler;
+		getSceneNodeRotation(scene[i], euler);
+		rotationsX[i] = euler.x;
+		rotationsY[i] = euler.y;
+		rotationsZ[i] = euler.z;
+	}
+	eulerToQuats(rotationsX.data(), rotationsY.data(), rotationsZ.data(), quats.data(), (qsizetype)scene.size());
+
+	std::vector<Tileset::Item> items;
+	std::vector<bool> placed;
+	for (size_t i = 0; i < scene.size(); ++i)
+	{
+		if (scene[i].childIndex < 0)
+		{
+			items.push_back({ { 0.0f, 0.0f, 0.0f }, { INFINITY, INFINITY, INFINITY }, { -INFINITY, -INFINITY, -INFINITY }, 0 });
+			placed.push_back(false);
+			itemStarts.push_back(i);
 		}
-		int killzoneNodeIndex = currentNodeCount;
-		int killzoneChildCount = 0;
-		for (int i = 0; i < triggerData->killzoneCount; ++i)
+		Tileset::Item& item = items.back();
+		item.count++;
+
+		Vector3 position, dimensions;
+		if (!getSceneNodeTransform(scene[i], position, dimensions))
+			continue;
+
+		float rotation[9];
+		quatToMatrix(&quats[i * 4], rotation);
+		float center[3] = { position.x, position.y, position.z };
+		float half[3] = { std::fabs(dimensions.x) * 0.5f, std::fabs(dimensions.y) * 0.5f, std::fabs(dimensions.z) * 0.5f };
+		for (int axis = 0; axis < 3; ++axis)
 		{
-			model->nodes.push_back(Node());
-			for (int j = 0; j < triggerData->killzones[i].triggerCount; ++j)
-			{
-				model->nodes.push_back(Node());
-				model->nodes.back().mesh = 0;
-				model->nodes[killzoneNodeIndex + i + killzoneChildCount].children.push_back(killzoneNodeIndex + i + killzoneChildCount + j + 1);
-				convertGenericRegion(triggerData->killzones[i].getTrigger(j), model->nodes[killzoneNodeIndex + i + killzoneChildCount + j + 1], j);
-				currentNodeCount++;
-			}
-			convertKillzone(triggerData->killzones[i], model->nodes[killzoneNodeIndex + i + killzoneChildCount], i);
-			currentNodeCount++;
-			killzoneChildCount += triggerData->killzones[i].triggerCount;
-			model->scenes[0].nodes.push_back(killzoneNodeIndex + i + killzoneChildCount - triggerData->killzones[i].triggerCount);
+			float extent = std::fabs(rotation[axis * 3]) * half[0] + std::fabs(rotation[axis * 3 + 1]) * half[1]
+				+ std::fabs(rotation[axis * 3 + 2]) * half[2];
+			item.min[axis] = std::min(item.min[axis], center[axis] - extent);
+			item.max[axis] = std::max(item.max[axis], center[axis] + extent);
+		}
+		if (scene[i].childIndex < 0)
+		{
+			std::copy(center, center + 3, item.position);
+			placed.back() = true;
 		}
 	}
-	
-	// Remaining GenericRegion nodes
-	int genericRegionNodeIndex = currentNodeCount;
-	int currentGenericRegionNode = 0;
-	for (int i = 0; i < triggerData->genericRegionCount; ++i)
+
+	for (size_t i = 0; i < items.size(); ++i)
 	{
-		if ((typeFilter == -1 && !triggerRegionExists(triggerData->genericRegions[i], false))
-			|| (int8_t)triggerData->genericRegions[i].type == typeFilter)
+		Tileset::Item& item = items[i];
+		if (item.min[0] > item.max[0])
 		{
-			// Skip gathered collectibles
-			if ((typeFilter == 8 || typeFilter == 9 || typeFilter == 13)
-				&& (hitTriggerIds.contains((uint64_t)triggerData->genericRegions[i].id)
-				|| hitTriggerIds.contains((uint64_t)triggerData->genericRegions[i].groupId)))
-				continue;
+			// Nothing to place, such as a killzone without triggers
+			std::copy(item.position, item.position + 3, item.min);
+			std::copy(item.position, item.position + 3, item.max);
+		}
+		else if (!placed[i])
+		{
+			for (int axis = 0; axis < 3; ++axis)
+				item.position[axis] = (item.min[axis] + item.max[axis]) * 0.5f;
+		}
+	}
+
+	return items;
+}
+
+// Writes the triggers not collected in a savegame to a file of their own. Returns
+// false if writing failed. Only reads the converter, so savegames may be exported
+// on several threads
+bool Converter::exportSavegame(const CollectedSet& collected, const QString& fileName, int& nodeCount)
+{
+	return writeScene(fileName, planScene(collected), nodeCount);
+}
+
+// Writes a scene to a file of its own. Returns false if writing failed.
+// Only reads the converter, so scenes may be written on several threads
+bool Converter::writeScene(const QString& fileName, const std::vector<SceneNode>& scene, int& nodeCount)
+{
+	GltfStreamWriter writer(options.writeBinary);
+	if (!writer.open(fileName))
+		return false;
+
+	addBoxMesh(writer);
+	if (options.exportMode == ExportMode::instanced)
+		writeInstancedNodes(writer, scene);
+	else
+		writeNodes(writer, scene);
+	nodeCount = writer.getNodeCount();
+
+	return writer.finish();
+}
+
+// Adds the unit box mesh all triggers are drawn with as mesh 0
+void Converter::addBoxMesh(GltfStreamWriter& writer)
+{
+	// Create a buffer from the trigger data
+	QByteArray binData = createGLTFBuffer();
+	writer.addBufferData(binData.constData(), binData.size());
+
+	// Create buffer views
+	// 0 = indices, 1 = vertices
+	BufferView indicesView;
+	indicesView.buffer = 0;
+	indicesView.byteOffset = 0;
+	indicesView.byteLength = 14 * sizeof(ushort);
+	indicesView.target = TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER;
+	indicesView.name = "Indices buffer view";
+	writer.addBufferView(indicesView);
+	BufferView verticesView;
+	verticesView.buffer = 0;
+	verticesView.byteOffset = indicesView.byteLength;
+	verticesView.byteLength = 14 * (sizeof(float) * 3);
+	verticesView.byteStride = sizeof(float) * 3;
+	verticesView.target = TINYGLTF_TARGET_ARRAY_BUFFER;
+	verticesView.name = "Vertices buffer view";
+	writer.addBufferView(verticesView);
+
+	// Create accessors
+	// 0 = indices, 1 = vertices
+	Accessor indicesAccessor;
+	indicesAccessor.bufferView = 0;
+	indicesAccessor.byteOffset = 0;
+	indicesAccessor.count = 14;
+	indicesAccessor.componentType = TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+	indicesAccessor.type = TINYGLTF_TYPE_SCALAR;
+	indicesAccessor.name = "Indices accessor";
+	writer.addAccessor(indicesAccessor);
+	Accessor verticesAccessor;
+	verticesAccessor.bufferView = 1;
+	verticesAccessor.byteOffset = 0;
+	verticesAccessor.count = 14;
+	verticesAccessor.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
+	verticesAccessor.type = TINYGLTF_TYPE_VEC3;
+	verticesAccessor.minValues = { -0.5, -0.5, -0.5 };
+	verticesAccessor.maxValues = { 0.5, 0.5, 0.5 };
+	verticesAccessor.name = "Vertices accessor";
+	writer.addAccessor(verticesAccessor);
+
+	// Create mesh
+	Mesh mesh;
+	mesh.primitives.push_back(Primitive());
+	mesh.primitives[0].mode = TINYGLTF_MODE_TRIANGLE_STRIP;
+	mesh.primitives[0].indices = 0;
+	mesh.primitives[0].attributes["POSITION"] = 1;
+	mesh.name = "Mesh";
+	writer.addMesh(mesh);
+}
 
-			model->nodes.push_back(Node());
-			model->nodes.back().mesh = 0;
-			convertGenericRegion(triggerData->genericRegions[i], model->nodes[genericRegionNodeIndex + currentGenericRegionNode], i);
-			model->scenes[0].nodes.push_back(genericRegionNodeIndex + currentGenericRegionNode);
-			currentGenericRegionNode++;
-			currentNodeCount++;
+// Writes one node per node of a scene listed by planScene()
+void Converter::writeNodes(GltfStreamWriter& writer, const std::vector<SceneNode>& scene)
+{
+	// Attributes are gathered into property tables up front, so each node knows its feature.
+	// Nodes then only reference their table and feature
+	StructuralMetadata metadata;
+	std::vector<std::pair<int, int>> features;
+	if (options.exportMode == ExportMode::metadata)
+	{
+		features.resize(scene.size(), { -1, -1 });
+		for (size_t i = 0; i < scene.size(); ++i)
+		{
+			if (addSceneNodeFields(scene[i], metadata))
+				features[i] = { metadata.getTable(), metadata.getFeature() };
 		}
 	}
 
-	if (typeFilter == -1)
+	// Nodes are converted and serialized in parallel a chunk at a time,
+	// then written in order. The output is the same as converting them one by one
+	const size_t chunkSize = 8192;
+	const size_t grain = 64;
+	std::vector<std::string> serialized(std::min(chunkSize, scene.size()));
+	for (size_t chunk = 0; chunk < scene.size(); chunk += chunkSize)
 	{
-		// Remaining TriggerRegion nodes
-		int triggerRegionNodeIndex = currentNodeCount;
-		int currentTriggerRegionNode = 0;
-		for (int i = 0; i < triggerData->regionCount; ++i)
+		size_t count = std::min(chunkSize, scene.size() - chunk);
+		pool->parallelFor(count, grain, [&](size_t begin, size_t end)
 		{
-			if (!triggerRegionExists(triggerData->getRegion(i)))
+			// Rotations of the range are converted to quaternions in one batch
+			size_t rangeSize = end - begin;
+			std::vector<float> rotationsX(rangeSize), rotationsY(rangeSize), rotationsZ(rangeSize);
+			std::vector<float> quats(rangeSize * 4);
+			std::vector<bool> hasRotation(rangeSize);
+			for (size_t i = 0; i < rangeSize; ++i)
 			{
-				model->nodes.push_back(Node());
-				model->nodes.back().mesh = 0;
-				convertTriggerRegion(triggerData->getRegion(i), model->nodes[triggerRegionNodeIndex + currentTriggerRegionNode], i);
-				model->scenes[0].nodes.push_back(triggerRegionNodeIndex + currentTriggerRegionNode);
-				currentTriggerRegionNode++;
-				currentNodeCount++;
+				Vector3 euler;
+				hasRotation[i] = getSceneNodeRotation(scene[chunk + begin + i], euler);
+				rotationsX[i] = euler.x;
+				rotationsY[i] = euler.y;
+				rotationsZ[i] = euler.z;
 			}
-		}
+			eulerToQuats(rotationsX.data(), rotationsY.data(), rotationsZ.data(), quats.data(), (qsizetype)rangeSize);
 
-		// Point triggers
-		int roamingLocationNodeIndex = currentNodeCount;
-		for (int i = 0; i < triggerData->roamingLocationCount; ++i)
-		{
-			model->nodes.push_back(Node());
-			model->nodes.back().mesh = 0;
-			convertRoamingLocation(triggerData->roamingLocations[i], model->nodes[roamingLocationNodeIndex + i], i);
-			currentNodeCount++;
-			model->scenes[0].nodes.push_back(roamingLocationNodeIndex + i);
-		}
-		int spawnLocationNodeIndex = currentNodeCount;
-		for (int i = 0; i < triggerData->spawnLocationCount; ++i)
+			for (size_t i = 0; i < rangeSize; ++i)
+			{
+				Node node;
+				convertSceneNode(scene[chunk + begin + i], (int)(chunk + begin + i),
+					hasRotation[i] ? &quats[i * 4] : nullptr, node);
+				if (!features.empty() && features[chunk + begin + i].first >= 0)
+				{
+					Value::Object extras;
+					extras["Property table"] = Value(features[chunk + begin + i].first);
+					extras["Feature"] = Value(features[chunk + begin + i].second);
+					node.extras = Value(extras);
+				}
+				serialized[begin + i] = writer.serializeNode(node);
+			}
+		});
+
+		for (size_t i = 0; i < count; ++i)
 		{
-			model->nodes.push_back(Node());
-			model->nodes.back().mesh = 0;
-			convertSpawnLocation(triggerData->spawnLocations[i], model->nodes[spawnLocationNodeIndex + i], i);
-			currentNodeCount++;
-			model->scenes[0].nodes.push_back(spawnLocationNodeIndex + i);
+			int nodeIndex = writer.writeSerializedNode(serialized[i]);
+			if (scene[chunk + i].childIndex < 0)
+				writer.addRootNode(nodeIndex);
 		}
 	}
 
-	// Set up asset
-	model->asset.version = "2.0";
-	model->asset.generator = "tinygltf";
-	
-	// Save it to a file
-	TinyGLTF gltf;
-	gltf.WriteGltfSceneToFile(model.data(), outFileName,
-		true, // embedImages
-		true, // embedBuffers
-		true, // pretty print
-		false); // write binary
+	metadata.write(writer);
 }
 
-bool Converter::triggerRegionExists(TriggerRegion region, bool checkGenericRegions)
+// Lists the nodes of the scene in output order.
+// Children directly follow their parent, so every node index is known up front.
+// Selections skip the collectibles gathered in collected
+std::vector<Converter::SceneNode> Converter::planScene(const CollectedSet& collected)
 {
-	int32_t id = region.id;
-	for (int i = 0; i < triggerData->landmarkCount; ++i)
+	std::vector<SceneNode> scene;
+	auto addNode = [&scene](SceneNode::Type type, int index, int childCount = 0)
 	{
-		if (id == triggerData->landmarks[i].id)
-			return true;
+		scene.push_back({ type, index, -1, childCount });
+		for (int j = 0; j < childCount; ++j)
+			scene.push_back({ type, index, j, 0 });
+	};
+
+	// Selected triggers, in table order. Generic regions are listed on their own,
+	// without the signature stunts and killzones holding them
+	if (!options.selection.empty())
+	{
+		for (int64_t row = 0; row < triggerTable.size(); ++row)
+		{
+			if (!TriggerSelection::isSelected(selectedRows, row))
+				continue;
+
+			int i = triggerTable.index[row];
+			switch (triggerTable.kind[row])
+			{
+			case TriggerTable::Kind::landmark:
+				addNode(SceneNode::Type::landmark, i, triggerData->landmarks[i].startingGridCount);
+				break;
+			case TriggerTable::Kind::blackspot:
+				addNode(SceneNode::Type::blackspot, i);
+				break;
+			case TriggerTable::Kind::vfxBoxRegion:
+				addNode(SceneNode::Type::vfxBoxRegion, i);
+				break;
+			case TriggerTable::Kind::genericRegion:
+				// Skip gathered collectibles
+				if (!isCollected(triggerData->genericRegions[i], collected))
+					addNode(SceneNode::Type::genericRegion, i);
+				break;
+			case TriggerTable::Kind::roamingLocation:
+				addNode(SceneNode::Type::roamingLocation, i);
+				break;
+			case TriggerTable::Kind::spawnLocation:
+				addNode(SceneNode::Type::spawnLocation, i);
+				break;
+			}
+		}
+		return scene;
 	}
+
+	// TriggerRegion derived nodes
+	for (int i = 0; i < triggerData->landmarkCount; ++i)
+		addNode(SceneNode::Type::landmark, i, triggerData->landmarks[i].startingGridCount);
 	for (int i = 0; i < triggerData->blackspotCount; ++i)
+		addNode(SceneNode::Type::blackspot, i);
+	for (int i = 0; i < triggerData->vfxBoxRegionCount; ++i)
+		addNode(SceneNode::Type::vfxBoxRegion, i);
+
+	// Nodes with GenericRegion arrays
+	for (int i = 0; i < triggerData->signatureStuntCount; ++i)
+		addNode(SceneNode::Type::signatureStunt, i, triggerData->signatureStunts[i].stuntElementCount);
+	for (int i = 0; i < triggerData->killzoneCount; ++i)
+		addNode(SceneNode::Type::killzone, i, triggerData->killzones[i].triggerCount);
+
+	// Remaining GenericRegion nodes
+	for (int i = 0; i < triggerData->genericRegionCount; ++i)
 	{
-		if (id == triggerData->blackspots[i].id)
-			return true;
+		if (!triggerRegionExists(triggerData->genericRegions[i], false))
+			addNode(SceneNode::Type::genericRegion, i);
 	}
-	for (int i = 0; i < triggerData->vfxBoxRegionCount; ++i)
+
+	// Remaining TriggerRegion nodes
+	for (int i = 0; i < triggerData->regionCount; ++i)
 	{
-		if (id == triggerData->vfxBoxRegions[i].id)
-			return true;
+		if (!triggerRegionExists(triggerData->getRegion(i)))
+			addNode(SceneNode::Type::triggerRegion, i);
 	}
-	if (checkGenericRegions)
+
+	// Point triggers
+	for (int i = 0; i < triggerData->roamingLocationCount; ++i)
+		addNode(SceneNode::Type::roamingLocation, i);
+	for (int i = 0; i < triggerData->spawnLocationCount; ++i)
+		addNode(SceneNode::Type::spawnLocation, i);
+
+	return scene;
+}
+
+// Get whether a generic region is a collectible, of type 8, 9 or 13
+bool Converter::isCollectible(const GenericRegion& region)
+{
+	int type = (int)region.type;
+	return type == 8 || type == 9 || type == 13;
+}
+
+// Get whether a generic region is a collectible gathered in a savegame
+bool Converter::isCollected(const GenericRegion& region, const CollectedSet& collected)
+{
+	return isCollectible(region)
+		&& (collected.contains((uint64_t)region.id) || collected.contains((uint64_t)region.groupId));
+}
+
+// Gets the Euler rotation of a node listed by planScene(). Returns false if it has none
+bool Converter::getSceneNodeRotation(const SceneNode& sceneNode, Vector3& euler)
+{
+	int i = sceneNode.index;
+	int j = sceneNode.childIndex;
+
+	BoxRegion boxRegion;
+	switch (sceneNode.type)
 	{
-		for (int i = 0; i < triggerData->genericRegionCount; ++i)
+	case SceneNode::Type::landmark:
+		if (j < 0)
+			boxRegion = triggerData->landmarks[i].boxRegion;
+		else
 		{
-			if (id == triggerData->genericRegions[i].id)
-				return true;
+			// Starting grid nodes are placed at their last starting position
+			euler = triggerData->landmarks[i].startingGrids[j].startingDirections[7];
+			return true;
 		}
+		break;
+	case SceneNode::Type::blackspot:
+		boxRegion = triggerData->blackspots[i].boxRegion;
+		break;
+	case SceneNode::Type::vfxBoxRegion:
+		boxRegion = triggerData->vfxBoxRegions[i].boxRegion;
+		break;
+	case SceneNode::Type::signatureStunt:
+		if (j < 0)
+			return false;
+		boxRegion = triggerData->signatureStunts[i].getStuntElement(j).boxRegion;
+		break;
+	case SceneNode::Type::killzone:
+		if (j < 0)
+			return false;
+		boxRegion = triggerData->killzones[i].getTrigger(j).boxRegion;
+		break;
+	case SceneNode::Type::genericRegion:
+		boxRegion = triggerData->genericRegions[i].boxRegion;
+		break;
+	case SceneNode::Type::triggerRegion:
+		boxRegion = triggerData->getRegion(i).boxRegion;
+		break;
+	case SceneNode::Type::roamingLocation:
 		return false;
+	case SceneNode::Type::spawnLocation:
+		euler = triggerData->spawnLocations[i].direction;
+		return true;
 	}
-	for (int i = 0; i < triggerData->signatureStuntCount; ++i)
+
+	euler = { boxRegion.rotationX, boxRegion.rotationY, boxRegion.rotationZ };
+	return true;
+}
+
+// Gets the position and box dimensions of a node listed by planScene().
+// Points have no dimensions. Returns false if the node has no position
+bool Converter::getSceneNodeTransform(const SceneNode& sceneNode, Vector3& position, Vector3& dimensions)
+{
+	int i = sceneNode.index;
+	int j = sceneNode.childIndex;
+
+	BoxRegion boxRegion;
+	switch (sceneNode.type)
 	{
-		for (int j = 0; j < triggerData->signatureStunts[i].stuntElementCount; ++j)
+	case SceneNode::Type::landmark:
+		if (j < 0)
+			boxRegion = triggerData->landmarks[i].boxRegion;
+		else
 		{
-			if (id == triggerData->signatureStunts[i].getStuntElement(j).id)
-				return true;
+			position = triggerData->landmarks[i].startingGrids[j].startingPositions[7];
+			dimensions = Vector3();
+			return true;
 		}
+		break;
+	case SceneNode::Type::blackspot:
+		boxRegion = triggerData->blackspots[i].boxRegion;
+		break;
+	case SceneNode::Type::vfxBoxRegion:
+		boxRegion = triggerData->vfxBoxRegions[i].boxRegion;
+		break;
+	case SceneNode::Type::signatureStunt:
+		if (j < 0)
+			return false;
+		boxRegion = triggerData->signatureStunts[i].getStuntElement(j).boxRegion;
+		break;
+	case SceneNode::Type::killzone:
+		if (j < 0)
+			return false;
+		boxRegion = triggerData->killzones[i].getTrigger(j).boxRegion;
+		break;
+	case SceneNode::Type::genericRegion:
+		boxRegion = triggerData->genericRegions[i].boxRegion;
+		break;
+	case SceneNode::Type::triggerRegion:
+		boxRegion = triggerData->getRegion(i).boxRegion;
+		break;
+	case SceneNode::Type::roamingLocation:
+		position = triggerData->roamingLocations[i].position;
+		dimensions = Vector3();
+		return true;
+	case SceneNode::Type::spawnLocation:
+		position = triggerData->spawnLocations[i].position;
+		dimensions = Vector3();
+		return true;
 	}
-	for (int i = 0; i < triggerData->killzoneCount; ++i)
+
+	position = { boxRegion.positionX, boxRegion.positionY, boxRegion.positionZ };
+	dimensions = { boxRegion.dimensionX, boxRegion.dimensionY, boxRegion.dimensionZ };
+	return true;
+}
+
+// Converts a node listed by planScene(), with its rotation already converted to
+// a quaternion if it has one. Only reads the trigger data, so nodes may be
+// converted on several threads
+void Converter::convertSceneNode(const SceneNode& sceneNode, int nodeIndex, const float* rotation, Node& node)
+{
+	int i = sceneNode.index;
+	int j = sceneNode.childIndex;
+
+	// Children directly follow their parent
+	for (int k = 0; k < sceneNode.childCount; ++k)
+		node.children.push_back(nodeIndex + k + 1);
+
+	// Parents of GenericRegion arrays have no box of their own
+	node.mesh = 0;
+	switch (sceneNode.type)
+	{
+	case SceneNode::Type::landmark:
+		if (j < 0)
+			convertLandmark(triggerData->landmarks[i], node, i);
+		else
+			convertStartingGrid(triggerData->landmarks[i].startingGrids[j], node, j);
+		break;
+	case SceneNode::Type::blackspot:
+		convertBlackspot(triggerData->blackspots[i], node, i);
+		break;
+	case SceneNode::Type::vfxBoxRegion:
+		convertVfxBoxRegion(triggerData->vfxBoxRegions[i], node, i);
+		break;
+	case SceneNode::Type::signatureStunt:
+		if (j < 0)
+		{
+			node.mesh = -1;
+			convertSignatureStunt(triggerData->signatureStunts[i], node, i);
+		}
+		else
+			convertGenericRegion(triggerData->signatureStunts[i].getStuntElement(j), node, j);
+		break;
+	case SceneNode::Type::killzone:
+		if (j < 0)
+		{
+			node.mesh = -1;
+			convertKillzone(triggerData->killzones[i], node, i);
+		}
+		else
+			convertGenericRegion(triggerData->killzones[i].getTrigger(j), node, j);
+		break;
+	case SceneNode::Type::genericRegion:
+		convertGenericRegion(triggerData->genericRegions[i], node, i);
+		break;
+	case SceneNode::Type::triggerRegion:
+		convertTriggerRegion(triggerData->getRegion(i), node, i);
+		break;
+	case SceneNode::Type::roamingLocation:
+		convertRoamingLocation(triggerData->roamingLocations[i], node, i);
+		break;
+	case SceneNode::Type::spawnLocation:
+		convertSpawnLocation(triggerData->spawnLocations[i], node, i);
+		break;
+	}
+
+	if (rotation != nullptr)
+		node.rotation = { rotation[0], rotation[1], rotation[2], rotation[3] };
+
+	// Metadata export references property tables instead
+	if (options.exportMode != ExportMode::metadata)
+	{
+		ExtrasFields fields;
+		if (addSceneNodeFields(sceneNode, fields))
+			node.extras = Value(fields.extras);
+	}
+}
+
+// Adds the attributes of a node listed by planScene() to extras or property tables.
+// Returns false if it has none
+template <typename Fields>
+bool Converter::addSceneNodeFields(const SceneNode& sceneNode, Fields& fields)
+{
+	int i = sceneNode.index;
+	int j = sceneNode.childIndex;
+
+	switch (sceneNode.type)
+	{
+	case SceneNode::Type::landmark:
+		if (j >= 0)
+			return false;
+		addLandmarkFields(triggerData->landmarks[i], fields);
+		break;
+	case SceneNode::Type::blackspot:
+		addBlackspotFields(triggerData->blackspots[i], fields);
+		break;
+	case SceneNode::Type::signatureStunt:
+		if (j < 0)
+			addSignatureStuntFields(triggerData->signatureStunts[i], fields);
+		else
+			addGenericRegionFields(triggerData->signatureStunts[i].getStuntElement(j), fields);
+		break;
+	case SceneNode::Type::killzone:
+		if (j < 0)
+			addKillzoneFields(triggerData->killzones[i], fields);
+		else
+			addGenericRegionFields(triggerData->killzones[i].getTrigger(j), fields);
+		break;
+	case SceneNode::Type::genericRegion:
+		addGenericRegionFields(triggerData->genericRegions[i], fields);
+		break;
+	case SceneNode::Type::roamingLocation:
+		addRoamingLocationFields(triggerData->roamingLocations[i], fields);
+		break;
+	case SceneNode::Type::spawnLocation:
+		addSpawnLocationFields(triggerData->spawnLocations[i], fields);
+		break;
+	default:
+		return false;
+	}
+	return true;
+}
+
+// Writes one node per trigger category of a scene listed by planScene(), drawing
+// every trigger of the category as an instance of the box mesh with EXT_mesh_gpu_instancing
+void Converter::writeInstancedNodes(GltfStreamWriter& writer, const std::vector<SceneNode>& scene)
+{
+	InstanceBatch landmarks("Landmarks");
+	InstanceBatch startingGrids("StartingGrids");
+	InstanceBatch blackspots("Blackspots");
+	InstanceBatch vfxBoxRegions("VFXBoxRegions");
+	InstanceBatch stuntElements("SignatureStunt elements");
+	InstanceBatch killzoneTriggers("Killzone triggers");
+	InstanceBatch genericRegions("GenericRegions");
+	InstanceBatch triggerRegions("TriggerRegions");
+	InstanceBatch roamingLocations("RoamingLocations");
+	InstanceBatch spawnLocations("SpawnLocations");
+
+	for (const SceneNode& sceneNode : scene)
 	{
-		for (int j = 0; j < triggerData->killzones[i].triggerCount; ++j)
+		int i = sceneNode.index;
+		int j = sceneNode.childIndex;
+		switch (sceneNode.type)
 		{
-			if (id == triggerData->killzones[i].getTrigger(j).id)
-				return true;
+		case SceneNode::Type::landmark:
+			if (j < 0)
+				addBoxInstance(triggerData->landmarks[i], landmarks);
+			else
+			{
+				// Starting grids use the ID of their landmark
+				const StartingGrid& grid = triggerData->landmarks[i].startingGrids[j];
+				for (int k = 0; k < 8; ++k)
+					addPointInstance(grid.startingPositions[k], grid.startingDirections[k], triggerData->landmarks[i].id, startingGrids);
+			}
+			break;
+		case SceneNode::Type::blackspot:
+			addBoxInstance(triggerData->blackspots[i], blackspots);
+			break;
+		case SceneNode::Type::vfxBoxRegion:
+			addBoxInstance(triggerData->vfxBoxRegions[i], vfxBoxRegions);
+			break;
+		case SceneNode::Type::signatureStunt:
+			// GenericRegion arrays
+			if (j >= 0)
+				addBoxInstance(triggerData->signatureStunts[i].getStuntElement(j), stuntElements);
+			break;
+		case SceneNode::Type::killzone:
+			if (j >= 0)
+				addBoxInstance(triggerData->killzones[i].getTrigger(j), killzoneTriggers);
+			break;
+		case SceneNode::Type::genericRegion:
+			addBoxInstance(triggerData->genericRegions[i], genericRegions);
+			break;
+		case SceneNode::Type::triggerRegion:
+			addBoxInstance(triggerData->getRegion(i), triggerRegions);
+			break;
+		case SceneNode::Type::roamingLocation:
+			// Point triggers. These have no ID, so their index is used
+			addPointInstance(triggerData->roamingLocations[i].position, {}, i, roamingLocations);
+			break;
+		case SceneNode::Type::spawnLocation:
+			addPointInstance(triggerData->spawnLocations[i].position, triggerData->spawnLocations[i].direction, i, spawnLocations);
+			break;
 		}
 	}
-	return false;
+
+	for (const InstanceBatch* batch : { &landmarks, &startingGrids, &blackspots, &vfxBoxRegions, &stuntElements,
+		&killzoneTriggers, &genericRegions, &triggerRegions, &roamingLocations, &spawnLocations })
+		writeInstancedNode(writer, *batch);
+}
+
+void Converter::addPointInstance(Vector3 pos, Vector3 rot, int32_t id, InstanceBatch& batch)
+{
+	batch.translations.insert(batch.translations.end(), { pos.x, pos.y, pos.z });
+	batch.rotationsX.push_back(rot.x);
+	batch.rotationsY.push_back(rot.y);
+	batch.rotationsZ.push_back(rot.z);
+	batch.scales.insert(batch.scales.end(), { 1.0f, 1.0f, 1.0f });
+	batch.ids.push_back((uint32_t)id);
+}
+
+// Writes the instance attributes of a category and the node drawing them.
+// Empty categories are left out
+void Converter::writeInstancedNode(GltfStreamWriter& writer, const InstanceBatch& batch)
+{
+	if (batch.ids.empty())
+		return;
+
+	std::vector<float> rotations(batch.ids.size() * 4);
+	eulerToQuats(batch.rotationsX.data(), batch.rotationsY.data(), batch.rotationsZ.data(),
+		rotations.data(), (qsizetype)batch.ids.size());
+
+	struct Attribute
+	{
+		const char* name;
+		const void* data;
+		size_t elementSize;
+		int componentType;
+		int type;
+	} attributes[] = {
+		{ "TRANSLATION", batch.translations.data(), sizeof(float) * 3, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3 },
+		{ "ROTATION", rotations.data(), sizeof(float) * 4, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC4 },
+		{ "SCALE", batch.scales.data(), sizeof(float) * 3, TINYGLTF_COMPONENT_TYPE_FLOAT, TINYGLTF_TYPE_VEC3 },
+		{ "_ID", batch.ids.data(), sizeof(uint32_t), TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT, TINYGLTF_TYPE_SCALAR }
+	};
+
+	Value::Object attributeIndices;
+	for (const Attribute& attribute : attributes)
+	{
+		size_t length = batch.ids.size() * attribute.elementSize;
+
+		BufferView view;
+		view.buffer = 0;
+		view.byteOffset = writer.addBufferData(attribute.data, length);
+		view.byteLength = length;
+
+		Accessor accessor;
+		accessor.bufferView = writer.addBufferView(view);
+		accessor.byteOffset = 0;
+		accessor.count = batch.ids.size();
+		accessor.componentType = attribute.componentType;
+		accessor.type = attribute.type;
+		attributeIndices[attribute.name] = Value(writer.addAccessor(accessor));
+	}
+
+	Value::Object instancing;
+	instancing["attributes"] = Value(attributeIndices);
+
+	Node node;
+	node.mesh = 0;
+	node.name = batch.name + " (" + std::to_string(batch.ids.size()) + ")";
+	node.extensions["EXT_mesh_gpu_instancing"] = Value(instancing);
+	writer.addRootNode(writer.writeNode(node));
+	writer.addExtensionUsed("EXT_mesh_gpu_instancing");
+}
+
+bool Converter::triggerRegionExists(TriggerRegion region, bool checkGenericRegions)
+{
+	uint8_t categories = (uint8_t)TriggerIndex::Category::landmark
+		| (uint8_t)TriggerIndex::Category::blackspot
+		| (uint8_t)TriggerIndex::Category::vfxBoxRegion;
+	if (checkGenericRegions)
+		categories |= (uint8_t)TriggerIndex::Category::genericRegion;
+	else
+	{
+		categories |= (uint8_t)TriggerIndex::Category::stuntElement
+			| (uint8_t)TriggerIndex::Category::killzoneTrigger;
+	}
+	return triggerIndex.contains(region.id, categories);
+}
+
+template <typename Fields>
+void Converter::addTriggerRegionFields(TriggerRegion region, Fields& fields)
+{
+	fields.add("triggerRegionId", "TriggerRegion ID", region.id);
+	fields.add("triggerRegionRegionIndex", "TriggerRegion region index", region.regionIndex);
+	fields.add("triggerRegionType", "TriggerRegion type", (uint8_t)region.type);
+	fields.add("triggerRegionUnknown0", "TriggerRegion unknown 0", region.unk0);
+}
+
+template <typename Fields>
+void Converter::addLandmarkFields(Landmark landmark, Fields& fields)
+{
+	fields.beginFeature("landmark", "Landmarks");
+	addTriggerRegionFields(landmark, fields);
+	fields.add("designIndex", "Design index", landmark.designIndex);
+	fields.add("district", "District", landmark.district);
+	fields.add("isOnline", "Is online", (bool)(((uint8_t)landmark.flags & (uint8_t)Landmark::Flags::isOnline) != 0));
+}
+
+template <typename Fields>
+void Converter::addBlackspotFields(Blackspot blackspot, Fields& fields)
+{
+	fields.beginFeature("blackspot", "Blackspots");
+	addTriggerRegionFields(blackspot, fields);
+	fields.add("scoreType", "Score type", (uint8_t)blackspot.scoreType);
+	fields.add("scoreAmount", "Score amount", blackspot.scoreAmount);
+}
+
+template <typename Fields>
+void Converter::addSignatureStuntFields(SignatureStunt signatureStunt, Fields& fields)
+{
+	fields.beginFeature("signatureStunt", "SignatureStunts");
+	fields.add("id", "ID", signatureStunt.id);
+	fields.add("camera", "Camera", signatureStunt.camera);
+}
+
+template <typename Fields>
+void Converter::addKillzoneFields(Killzone killzone, Fields& fields)
+{
+	fields.beginFeature("killzone", "Killzones");
+	fields.addArray("regionIds", "Region IDs", killzone.regionIds, killzone.regionIdCount);
 }
 
-void Converter::addTriggerRegionFields(TriggerRegion region, Value::Object& extras)
+template <typename Fields>
+void Converter::addGenericRegionFields(GenericRegion region, Fields& fields)
 {
-	extras["TriggerRegion ID"] = Value(region.id);
-	extras["TriggerRegion region index"] = Value(region.regionIndex);
-	extras["TriggerRegion type"] = Value((uint8_t)region.type);
-	extras["TriggerRegion unknown 0"] = Value(region.unk0);
+	fields.beginFeature("genericRegion", "GenericRegions");
+	addTriggerRegionFields(region, fields);
+	fields.add("groupId", "Group ID", region.groupId);
+	fields.add("cameraCut1", "Camera cut 1", region.cameraCut1);
+	fields.add("cameraCut2", "Camera cut 2", region.cameraCut2);
+	fields.add("cameraType1", "Camera type 1", (int8_t)region.cameraType1);
+	fields.add("cameraType2", "Camera type 2", (int8_t)region.cameraType2);
+	fields.add("type", "Type", (uint8_t)region.type);
+	fields.add("isOneWay", "Is one way", (bool)region.isOneWay);
+}
+
+template <typename Fields>
+void Converter::addRoamingLocationFields(RoamingLocation location, Fields& fields)
+{
+	fields.beginFeature("roamingLocation", "RoamingLocations");
+	fields.add("districtIndex", "District index", location.districtIndex);
+}
+
+template <typename Fields>
+void Converter::addSpawnLocationFields(SpawnLocation location, Fields& fields)
+{
+	fields.beginFeature("spawnLocation", "SpawnLocations");
+	fields.add("junkyardId", "Junkyard ID", location.junkyardId);
+	fields.add("type", "Type", (uint8_t)location.type);
 }
 
 void Converter::convertLandmark(Landmark landmark, Node& node, int index)
 {
 	addBoxRegionTransform(landmark, node);
 
-	Value::Object extras;
-	addTriggerRegionFields(landmark, extras);
-	extras["Design index"] = Value(landmark.designIndex);
-	extras["District"] = Value(landmark.district);
-	extras["Is online"] = Value((bool)(((uint8_t)landmark.flags & (uint8_t)Landmark::Flags::isOnline) != 0));
-	node.extras = Value(extras);
-
 	node.name = "Landmark " + std::to_string(index) + " (" + std::to_string(landmark.id) + ")";
 }
 
 void Converter::convertStartingGrid(StartingGrid grid, Node& node, int index)
 {
 	for (int i = 0; i < 8; ++i)
-		addPointTransform(grid.startingPositions[i], grid.startingDirections[i], node);
+		addPointTransform(grid.startingPositions[i], node);
 }
 
 void Converter::convertBlackspot(Blackspot blackspot, Node& node, int index)
 {
 	addBoxRegionTransform(blackspot, node);
 
-	Value::Object extras;
-	addTriggerRegionFields(blackspot, extras);
-	extras["Score type"] = Value((uint8_t)blackspot.scoreType);
-	extras["Score amount"] = Value(blackspot.scoreAmount);
-	node.extras = Value(extras);
-
 	node.name = "Blackspot " + std::to_string(index) + " (" + std::to_string(blackspot.id) + ")";
 }
 
@@ -632,24 +1775,11 @@ void Converter::convertVfxBoxRegion(VFXBoxRegion vfxBoxRegion, Node& node, int i
 
 void Converter::convertSignatureStunt(SignatureStunt signatureStunt, Node& node, int index)
 {
-	Value::Object extras;
-	extras["ID"] = Value((int)signatureStunt.id);
-	extras["Camera"] = Value((int)signatureStunt.camera);
-	node.extras = Value(extras);
-
 	node.name = "SignatureStunt " + std::to_string(index) + " (" + std::to_string(signatureStunt.id) + ")";
 }
 
 void Converter::convertKillzone(Killzone killzone, Node& node, int index)
 {
-	Value::Array regionIds;
-	for (int i = 0; i < killzone.regionIdCount; ++i)
-		regionIds.push_back(Value((int)killzone.regionIds[i]));
-
-	Value::Object extras;
-	extras["Region IDs"] = Value(regionIds);
-	node.extras = Value(extras);
-
 	node.name = "Killzone " + std::to_string(index);
 }
 
@@ -657,17 +1787,6 @@ void Converter::convertGenericRegion(GenericRegion region, Node& node, int index
 {
 	addBoxRegionTransform(region, node);
 
-	Value::Object extras;
-	addTriggerRegionFields(region, extras);
-	extras["Group ID"] = Value(region.groupId);
-	extras["Camera cut 1"] = Value(region.cameraCut1);
-	extras["Camera cut 2"] = Value(region.cameraCut2);
-	extras["Camera type 1"] = Value((int16_t)region.cameraType1);
-	extras["Camera type 2"] = Value((int16_t)region.cameraType2);
-	extras["Type"] = Value((uint8_t)region.type);
-	extras["Is one way"] = Value((bool)region.isOneWay);
-	node.extras = Value(extras);
-
 	uint64_t id = region.groupId;
 	if (id == 0)
 		id = region.id;
@@ -685,21 +1804,12 @@ void Converter::convertRoamingLocation(RoamingLocation location, Node& node, int
 {
 	addPointTransform(location.position, node);
 
-	Value::Object extras;
-	extras["District index"] = Value(location.districtIndex);
-	node.extras = Value(extras);
-
 	node.name = "RoamingLocation " + std::to_string(index);
 }
 
 void Converter::convertSpawnLocation(SpawnLocation location, Node& node, int index)
 {
-	addPointTransform(location.position, location.direction, node);
-
-	Value::Object extras;
-	extras["Junkyard ID"] = Value((int)location.junkyardId);
-	extras["Type"] = Value((uint8_t)location.type);
-	node.extras = Value(extras);
+	addPointTransform(location.position, node);
 
 	node.name = "SpawnLocation " + std::to_string(index);
 }
@@ -0,0 +1,49 @@
+#include <cpu-features.h>
+
+#if defined(_MSC_VER) && defined(CPU_X86)
+#include <intrin.h>
+#endif
+
+namespace
+{
+	CpuFeatures detectFeatures()
+	{
+		CpuFeatures features;
+#if defined(CPU_X86) && defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		int maxLeaf = info[0];
+		__cpuid(info, 1);
+		features.sse2 = (info[3] & (1 << 26)) != 0;
+		features.ssse3 = (info[2] & (1 << 9)) != 0;
+		bool fma = (info[2] & (1 << 12)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+
+		// AVX registers also need to be saved by the OS
+		if (osxsave && avx && (_xgetbv(0) & 0x6) == 0x6)
+		{
+			features.fma = fma;
+			if (maxLeaf >= 7)
+			{
+				__cpuidex(info, 7, 0);
+				features.avx2 = (info[1] & (1 << 5)) != 0;
+			}
+		}
+#elif defined(CPU_X86)
+		__builtin_cpu_init();
+		features.sse2 = __builtin_cpu_supports("sse2");
+		features.ssse3 = __builtin_cpu_supports("ssse3");
+		features.avx2 = __builtin_cpu_supports("avx2");
+		features.fma = __builtin_cpu_supports("fma");
+#endif
+		return features;
+	}
+}
+
+// Get the features of the CPU. Detected on the first call
+const CpuFeatures& getCpuFeatures()
+{
+	static const CpuFeatures features = detectFeatures();
+	return features;
+}
@@ -0,0 +1,421 @@
+#include <gltf-stream-writer.h>
+
+#include <QByteArray>
+#include <QtEndian>
+
+#include <algorithm>
+
+using namespace tinygltf;
+
+namespace
+{
+	const quint32 glbMagic = 0x46546C67; // "glTF"
+	const quint32 glbVersion = 2;
+	const quint32 glbChunkJson = 0x4E4F534A; // "JSON"
+	const quint32 glbChunkBin = 0x004E4942; // "BIN\0"
+	const qint64 glbHeaderSize = 12;
+	const qint64 glbChunkHeaderSize = 8;
+
+	// Writes a little endian 32 bit value
+	bool writeUInt32(QFile& file, quint32 value)
+	{
+		uchar bytes[4];
+		qToLittleEndian(value, bytes);
+		return file.write((const char*)bytes, 4) == 4;
+	}
+
+	void writeValue(JsonWriter& json, const Value& value)
+	{
+		if (value.IsBool())
+			json.value(value.Get<bool>());
+		else if (value.IsInt())
+			json.value(value.Get<int>());
+		else if (value.IsReal())
+			json.value(value.Get<double>());
+		else if (value.IsString())
+			json.value(value.Get<std::string>());
+		else if (value.IsArray())
+		{
+			json.beginArray();
+			for (size_t i = 0; i < value.ArrayLen(); ++i)
+				writeValue(json, value.Get((int)i));
+			json.endArray();
+		}
+		else if (value.IsObject())
+		{
+			json.beginObject();
+			for (const std::string& key : value.Keys())
+			{
+				json.key(key);
+				writeValue(json, value.Get(key));
+			}
+			json.endObject();
+		}
+		else
+			json.nullValue();
+	}
+
+	void writeNumbers(JsonWriter& json, const char* name, const std::vector<double>& values)
+	{
+		if (values.empty())
+			return;
+
+		json.key(name);
+		json.beginArray();
+		for (double value : values)
+			json.value(value);
+		json.endArray();
+	}
+
+	void writeExtensions(JsonWriter& json, const ExtensionMap& extensions)
+	{
+		if (extensions.empty())
+			return;
+
+		json.key("extensions");
+		json.beginObject();
+		for (const auto& [name, extension] : extensions)
+		{
+			json.key(name);
+			writeValue(json, extension);
+		}
+		json.endObject();
+	}
+
+	void writeNodeJson(JsonWriter& json, const Node& node)
+	{
+		json.beginObject();
+		if (!node.name.empty())
+		{
+			json.key("name");
+			json.value(node.name);
+		}
+		if (node.mesh >= 0)
+		{
+			json.key("mesh");
+			json.value(node.mesh);
+		}
+		if (!node.children.empty())
+		{
+			json.key("children");
+			json.beginArray();
+			for (int child : node.children)
+				json.value(child);
+			json.endArray();
+		}
+		writeNumbers(json, "translation", node.translation);
+		writeNumbers(json, "rotation", node.rotation);
+		writeNumbers(json, "scale", node.scale);
+		writeExtensions(json, node.extensions);
+		if (node.extras.Type() != NULL_TYPE)
+		{
+			json.key("extras");
+			writeValue(json, node.extras);
+		}
+		json.endObject();
+	}
+}
+
+GltfStreamWriter::GltfStreamWriter(bool binary)
+	: binary(binary)
+{
+
+}
+
+GltfStreamWriter::~GltfStreamWriter()
+{
+	delete json;
+}
+
+// Opens the output file and starts the node array
+bool GltfStreamWriter::open(const QString& fileName)
+{
+	file.setFileName(fileName);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+
+	// GLB header and JSON chunk header are filled in once the lengths are known
+	if (binary && file.write(QByteArray(glbHeaderSize + glbChunkHeaderSize, 0)) != glbHeaderSize + glbChunkHeaderSize)
+		return false;
+
+	json = new JsonWriter(&file, !binary);
+	json->beginObject();
+	json->key("nodes");
+	json->beginArray();
+	return true;
+}
+
+// Appends data to the buffer, aligned to a power of two of at least 4 bytes.
+// Returns its offset in the buffer
+size_t GltfStreamWriter::addBufferData(const void* data, size_t length, size_t alignment)
+{
+	size_t offset = (bufferData.size() + alignment - 1) & ~(alignment - 1);
+	bufferData.resize(offset + length);
+	memcpy(bufferData.data() + offset, data, length);
+	return offset;
+}
+
+// Adds a buffer view of the buffer. Returns its index
+int GltfStreamWriter::addBufferView(const BufferView& view)
+{
+	bufferViews.push_back(view);
+	return (int)bufferViews.size() - 1;
+}
+
+// Adds an accessor. Returns its index
+int GltfStreamWriter::addAccessor(const Accessor& accessor)
+{
+	accessors.push_back(accessor);
+	return (int)accessors.size() - 1;
+}
+
+// Adds a mesh. Returns its index
+int GltfStreamWriter::addMesh(const Mesh& mesh)
+{
+	meshes.push_back(mesh);
+	return (int)meshes.size() - 1;
+}
+
+// Serializes a node. Returns its index
+int GltfStreamWriter::writeNode(const Node& node)
+{
+	writeNodeJson(*json, node);
+	return nodeCount++;
+}
+
+// Serializes a node to be written later with writeSerializedNode().
+// Does not change the writer, so nodes may be serialized on several threads
+std::string GltfStreamWriter::serializeNode(const Node& node) const
+{
+	// Nodes are two levels deep, in the node array of the root object
+	JsonWriter nodeJson(2, !binary);
+	writeNodeJson(nodeJson, node);
+	return std::move(nodeJson.getBuffer());
+}
+
+// Writes a node returned by serializeNode(). Returns its index
+int GltfStreamWriter::writeSerializedNode(std::string_view node)
+{
+	json->rawValue(node);
+	return nodeCount++;
+}
+
+// Lists an extension as used by the asset
+void GltfStreamWriter::addExtensionUsed(const std::string& name)
+{
+	if (std::find(extensionsUsed.begin(), extensionsUsed.end(), name) == extensionsUsed.end())
+		extensionsUsed.push_back(name);
+}
+
+// Adds an extension to the root of the asset, serialized by a function writing a single value
+void GltfStreamWriter::addExtension(const std::string& name, const std::function<void(JsonWriter&)>& write)
+{
+	// Extensions are two levels deep, in the extension object of the root object
+	JsonWriter extensionJson(2, !binary);
+	write(extensionJson);
+	extensions.push_back({ name, std::move(extensionJson.getBuffer()) });
+}
+
+// Writes the rest of the asset and closes the file. Returns false if writing failed
+bool GltfStreamWriter::finish()
+{
+	json->endArray(); // nodes
+
+	json->key("asset");
+	json->beginObject();
+	json->key("generator");
+	json->value("TriggersToGLTF");
+	json->key("version");
+	json->value("2.0");
+	json->endObject();
+
+	if (!extensionsUsed.empty())
+	{
+		json->key("extensionsUsed");
+		json->beginArray();
+		for (const std::string& extension : extensionsUsed)
+			json->value(extension);
+		json->endArray();
+	}
+
+	if (!extensions.empty())
+	{
+		json->key("extensions");
+		json->beginObject();
+		for (const auto& [name, extension] : extensions)
+		{
+			json->key(name);
+			json->rawValue(extension);
+		}
+		json->endObject();
+	}
+
+	json->key("scene");
+	json->value(0);
+	json->key("scenes");
+	json->beginArray();
+	json->beginObject();
+	json->key("name");
+	json->value("Scene");
+	json->key("nodes");
+	json->beginArray();
+	for (int node : rootNodes)
+		json->value(node);
+	json->endArray();
+	json->endObject();
+	json->endArray();
+
+	json->key("meshes");
+	json->beginArray();
+	for (const Mesh& mesh : meshes)
+	{
+		json->beginObject();
+		json->key("name");
+		json->value(mesh.name);
+		json->key("primitives");
+		json->beginArray();
+		for (const Primitive& primitive : mesh.primitives)
+		{
+			json->beginObject();
+			json->key("attributes");
+			json->beginObject();
+			for (const auto& [name, accessor] : primitive.attributes)
+			{
+				json->key(name);
+				json->value(accessor);
+			}
+			json->endObject();
+			if (primitive.indices >= 0)
+			{
+				json->key("indices");
+				json->value(primitive.indices);
+			}
+			if (primitive.mode >= 0)
+			{
+				json->key("mode");
+				json->value(primitive.mode);
+			}
+			json->endObject();
+		}
+		json->endArray();
+		json->endObject();
+	}
+	json->endArray();
+
+	json->key("accessors");
+	json->beginArray();
+	for (const Accessor& accessor : accessors)
+	{
+		static const char* types[] = { "SCALAR", "VEC2", "VEC3", "VEC4", "MAT2", "MAT3", "MAT4" };
+		static const int typeIds[] = { TINYGLTF_TYPE_SCALAR, TINYGLTF_TYPE_VEC2, TINYGLTF_TYPE_VEC3,
+			TINYGLTF_TYPE_VEC4, TINYGLTF_TYPE_MAT2, TINYGLTF_TYPE_MAT3, TINYGLTF_TYPE_MAT4 };
+
+		json->beginObject();
+		if (!accessor.name.empty())
+		{
+			json->key("name");
+			json->value(accessor.name);
+		}
+		json->key("bufferView");
+		json->value(accessor.bufferView);
+		json->key("byteOffset");
+		json->value((uint64_t)accessor.byteOffset);
+		json->key("componentType");
+		json->value(accessor.componentType);
+		if (accessor.normalized)
+		{
+			json->key("normalized");
+			json->value(true);
+		}
+		json->key("count");
+		json->value((uint64_t)accessor.count);
+		for (int i = 0; i < 7; ++i)
+		{
+			if (accessor.type == typeIds[i])
+			{
+				json->key("type");
+				json->value(types[i]);
+			}
+		}
+		writeNumbers(*json, "min", accessor.minValues);
+		writeNumbers(*json, "max", accessor.maxValues);
+		json->endObject();
+	}
+	json->endArray();
+
+	json->key("bufferViews");
+	json->beginArray();
+	for (const BufferView& view : bufferViews)
+	{
+		json->beginObject();
+		if (!view.name.empty())
+		{
+			json->key("name");
+			json->value(view.name);
+		}
+		json->key("buffer");
+		json->value(view.buffer);
+		json->key("byteOffset");
+		json->value((uint64_t)view.byteOffset);
+		json->key("byteLength");
+		json->value((uint64_t)view.byteLength);
+		if (view.byteStride > 0)
+		{
+			json->key("byteStride");
+			json->value((uint64_t)view.byteStride);
+		}
+		if (view.target > 0)
+		{
+			json->key("target");
+			json->value(view.target);
+		}
+		json->endObject();
+	}
+	json->endArray();
+
+	// GLB keeps the buffer in its binary chunk, glTF embeds it as a data URI
+	json->key("buffers");
+	json->beginArray();
+	json->beginObject();
+	json->key("name");
+	json->value("Buffer");
+	json->key("byteLength");
+	json->value((uint64_t)bufferData.size());
+	if (!binary)
+	{
+		QByteArray base64 = QByteArray::fromRawData((const char*)bufferData.data(), bufferData.size()).toBase64();
+		json->key("uri");
+		json->value("data:application/octet-stream;base64," + base64.toStdString());
+	}
+	json->endObject();
+	json->endArray();
+
+	json->endObject();
+	bool ok = json->flush();
+
+	if (binary && ok)
+	{
+		// Pad the JSON chunk with spaces and the binary chunk with zeros
+		qint64 jsonLength = json->size();
+		qint64 jsonPadding = (4 - jsonLength % 4) % 4;
+		qint64 binLength = bufferData.size();
+		qint64 binPadding = (4 - binLength % 4) % 4;
+		ok = file.write(QByteArray(jsonPadding, ' ')) == jsonPadding
+			&& writeUInt32(file, binLength + binPadding)
+			&& writeUInt32(file, glbChunkBin)
+			&& file.write((const char*)bufferData.data(), binLength) == binLength
+			&& file.write(QByteArray(binPadding, 0)) == binPadding;
+
+		// Fill in the header
+		qint64 totalLength = file.pos();
+		ok = ok && file.seek(0)
+			&& writeUInt32(file, glbMagic)
+			&& writeUInt32(file, glbVersion)
+			&& writeUInt32(file, totalLength)
+			&& writeUInt32(file, jsonLength + jsonPadding)
+			&& writeUInt32(file, glbChunkJson);
+	}
+
+	file.close();
+	return ok;
+}
@@ -0,0 +1,212 @@
+#include <json-writer.h>
+
+#include <charconv>
+#include <cmath>
+
+namespace
+{
+	// Buffered output is handed to the device in chunks of at least this size
+	const size_t flushThreshold = 1 << 16;
+}
+
+JsonWriter::JsonWriter(QIODevice* device, bool pretty)
+	: device(device), pretty(pretty)
+{
+
+}
+
+// Writes JSON to memory as a single value nested depth levels deep in a document.
+// The result can be inserted into that document with rawValue()
+JsonWriter::JsonWriter(int depth, bool pretty)
+	: pretty(pretty), afterKey(true), counts(depth, 0)
+{
+
+}
+
+JsonWriter::~JsonWriter()
+{
+	flush();
+}
+
+void JsonWriter::beginObject()
+{
+	beginValue();
+	buffer += '{';
+	counts.push_back(0);
+}
+
+void JsonWriter::endObject()
+{
+	bool empty = counts.back() == 0;
+	counts.pop_back();
+	if (!empty)
+		newLine();
+	buffer += '}';
+}
+
+void JsonWriter::beginArray()
+{
+	beginValue();
+	buffer += '[';
+	counts.push_back(0);
+}
+
+void JsonWriter::endArray()
+{
+	bool empty = counts.back() == 0;
+	counts.pop_back();
+	if (!empty)
+		newLine();
+	buffer += ']';
+}
+
+// Writes an object key. Must be followed by a value, object, or array
+void JsonWriter::key(std::string_view name)
+{
+	beginValue();
+	writeString(name);
+	buffer += pretty ? ": " : ":";
+	afterKey = true;
+}
+
+void JsonWriter::value(bool value)
+{
+	beginValue();
+	buffer += value ? "true" : "false";
+}
+
+void JsonWriter::value(int64_t value)
+{
+	beginValue();
+	char digits[24];
+	buffer.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+}
+
+void JsonWriter::value(uint64_t value)
+{
+	beginValue();
+	char digits[24];
+	buffer.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+}
+
+void JsonWriter::value(double value)
+{
+	// JSON has no representation for NaN or infinity
+	if (!std::isfinite(value))
+	{
+		nullValue();
+		return;
+	}
+
+	beginValue();
+	char digits[32];
+	buffer.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+}
+
+void JsonWriter::value(std::string_view value)
+{
+	beginValue();
+	writeString(value);
+}
+
+void JsonWriter::nullValue()
+{
+	beginValue();
+	buffer += "null";
+}
+
+// Writes a value serialized by another writer
+void JsonWriter::rawValue(std::string_view json)
+{
+	beginValue();
+	buffer += json;
+}
+
+// Writes buffered output to the device. Returns false if the device failed to write
+bool JsonWriter::flush()
+{
+	// Without a device, everything stays in the buffer
+	if (device == nullptr)
+		return true;
+
+	if (!buffer.empty() && !failed)
+	{
+		if (device->write(buffer.data(), buffer.size()) != (qint64)buffer.size())
+			failed = true;
+	}
+	flushedSize += buffer.size();
+	buffer.clear();
+	return !failed;
+}
+
+// Get the number of bytes produced so far, including any still buffered
+qint64 JsonWriter::size()
+{
+	return flushedSize + buffer.size();
+}
+
+// Adds the separator before a value, unless it directly follows its key
+void JsonWriter::beginValue()
+{
+	if (afterKey)
+	{
+		afterKey = false;
+		return;
+	}
+
+	if (!counts.empty())
+	{
+		if (counts.back()++ > 0)
+			buffer += ',';
+		newLine();
+	}
+
+	if (buffer.size() >= flushThreshold && device != nullptr)
+		flush();
+}
+
+void JsonWriter::newLine()
+{
+	if (!pretty)
+		return;
+	buffer += '\n';
+	buffer.append(counts.size() * 2, ' ');
+}
+
+void JsonWriter::writeString(std::string_view string)
+{
+	static const char hex[] = "0123456789abcdef";
+
+	buffer += '"';
+	for (char c : string)
+	{
+		switch (c)
+		{
+		case '"':
+			buffer += "\\\"";
+			break;
+		case '\\':
+			buffer += "\\\\";
+			break;
+		case '\n':
+			buffer += "\\n";
+			break;
+		case '\r':
+			buffer += "\\r";
+			break;
+		case '\t':
+			buffer += "\\t";
+			break;
+		default:
+			if ((unsigned char)c < 0x20)
+			{
+				buffer += "\\u00";
+				buffer += hex[(c >> 4) & 0xF];
+				buffer += hex[c & 0xF];
+			}
+			else
+				buffer += c;
+		}
+	}
+	buffer += '"';
+}
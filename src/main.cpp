@@ -1,9 +1,57 @@
+#include <batch-converter.h>
 #include <converter.h>
+#include <overlap-finder.h>
+#include <point-query.h>
+#include <savegame-evaluator.h>
+#include <trajectory-sweep.h>
+#include <watch-converter.h>
 
 #include <QScopedPointer>
 
 int main(int argc, char* argv[])
 {
+	// Convert many files in one process
+	if (argc > 1 && strcmp(argv[1], "--batch") == 0)
+	{
+		QScopedPointer<BatchConverter> batch(new BatchConverter(argc, argv));
+		return batch->result;
+	}
+
+	// Convert files again whenever they change
+	if (argc > 1 && strcmp(argv[1], "--watch") == 0)
+	{
+		QScopedPointer<WatchConverter> watch(new WatchConverter(argc, argv));
+		return watch->result;
+	}
+
+	// Check many savegames against one input
+	if (argc > 1 && strcmp(argv[1], "--saves") == 0)
+	{
+		QScopedPointer<SavegameEvaluator> saves(new SavegameEvaluator(argc, argv));
+		return saves->result;
+	}
+
+	// Find the triggers containing points
+	if (argc > 1 && strcmp(argv[1], "--query") == 0)
+	{
+		QScopedPointer<PointQuery> query(new PointQuery(argc, argv));
+		return query->result;
+	}
+
+	// Find where trajectories enter and exit triggers
+	if (argc > 1 && strcmp(argv[1], "--sweep") == 0)
+	{
+		QScopedPointer<TrajectorySweep> sweep(new TrajectorySweep(argc, argv));
+		return sweep->result;
+	}
+
+	// Find overlapping triggers
+	if (argc > 1 && strcmp(argv[1], "--overlaps") == 0)
+	{
+		QScopedPointer<OverlapFinder> overlaps(new OverlapFinder(argc, argv));
+		return overlaps->result;
+	}
+
 	QScopedPointer<Converter> app(new Converter(argc, argv));
 	return app->result;
 }
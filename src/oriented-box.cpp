@@ -0,0 +1,79 @@
+#include <oriented-box.h>
+#include <rotation.h>
+
+#include <cmath>
+
+using namespace BrnTrigger;
+
+// Gets the boxes of landmarks, blackspots, VFX box regions, generic regions, and the
+// regions only listed in the region table. Stunt elements and killzone triggers are
+// generic regions, so they are included once.
+// Rotations are converted like the exported nodes, so boxes match the glTF
+std::vector<OrientedBox> getOrientedBoxes(TriggerData& data, const TriggerIndex& index)
+{
+	std::vector<const TriggerRegion*> regions;
+	for (int i = 0; i < data.landmarkCount; ++i)
+		regions.push_back(&data.landmarks[i]);
+	for (int i = 0; i < data.blackspotCount; ++i)
+		regions.push_back(&data.blackspots[i]);
+	for (int i = 0; i < data.vfxBoxRegionCount; ++i)
+		regions.push_back(&data.vfxBoxRegions[i]);
+	for (int i = 0; i < data.genericRegionCount; ++i)
+		regions.push_back(&data.genericRegions[i]);
+
+	// Same check as Converter::triggerRegionExists()
+	uint8_t listedCategories = (uint8_t)TriggerIndex::Category::landmark
+		| (uint8_t)TriggerIndex::Category::blackspot
+		| (uint8_t)TriggerIndex::Category::vfxBoxRegion
+		| (uint8_t)TriggerIndex::Category::genericRegion;
+	for (int i = 0; i < data.regionCount; ++i)
+	{
+		if (!index.contains(data.regions[i].id, listedCategories))
+			regions.push_back(&data.regions[i]);
+	}
+
+	std::vector<float> rotationsX(regions.size()), rotationsY(regions.size()), rotationsZ(regions.size());
+	for (size_t i = 0; i < regions.size(); ++i)
+	{
+		rotationsX[i] = regions[i]->boxRegion.rotationX;
+		rotationsY[i] = regions[i]->boxRegion.rotationY;
+		rotationsZ[i] = regions[i]->boxRegion.rotationZ;
+	}
+	std::vector<float> quats(regions.size() * 4);
+	eulerToQuats(rotationsX.data(), rotationsY.data(), rotationsZ.data(), quats.data(), (qsizetype)regions.size());
+
+	std::vector<OrientedBox> boxes(regions.size());
+	for (size_t i = 0; i < regions.size(); ++i)
+	{
+		const BoxRegion& region = regions[i]->boxRegion;
+		OrientedBox& box = boxes[i];
+		quatToMatrix(&quats[i * 4], box.rotation);
+		box.center[0] = region.positionX;
+		box.center[1] = region.positionY;
+		box.center[2] = region.positionZ;
+		box.half[0] = std::fabs(region.dimensionX) * 0.5f;
+		box.half[1] = std::fabs(region.dimensionY) * 0.5f;
+		box.half[2] = std::fabs(region.dimensionZ) * 0.5f;
+		box.id = regions[i]->id;
+		box.type = regions[i]->type;
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			float extent = std::fabs(box.rotation[axis * 3]) * box.half[0]
+				+ std::fabs(box.rotation[axis * 3 + 1]) * box.half[1]
+				+ std::fabs(box.rotation[axis * 3 + 2]) * box.half[2];
+			extent += extent * 1e-5f + 1e-5f;
+			box.min[axis] = box.center[axis] - extent;
+			box.max[axis] = box.center[axis] + extent;
+		}
+	}
+
+	return boxes;
+}
+
+// Get the name of a TriggerRegion type as used in reports
+const char* getTriggerRegionTypeName(TriggerRegion::Type type)
+{
+	static const char* names[] = { "landmark", "blackspot", "genericRegion", "vfxBoxRegion" };
+	return (uint8_t)type < 4 ? names[(uint8_t)type] : "unknown";
+}
@@ -0,0 +1,300 @@
+#include <overlap-finder.h>
+#include <json-writer.h>
+#include <thread-pool.h>
+
+#include <QFileInfo>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	// Added to the products of box axes, so nearly parallel edges don't give
+	// degenerate cross product axes that separate overlapping boxes
+	const float parallelEpsilon = 1e-6f;
+
+	// Checks whether two oriented boxes overlap with the separating axis test.
+	// Touching boxes overlap
+	bool boxesOverlap(const OrientedBox& a, const OrientedBox& b)
+	{
+		// Box axes are the columns of their rotations
+		float r[3][3];
+		float absR[3][3];
+		for (int i = 0; i < 3; ++i)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				r[i][j] = a.rotation[i] * b.rotation[j] + a.rotation[3 + i] * b.rotation[3 + j]
+					+ a.rotation[6 + i] * b.rotation[6 + j];
+				absR[i][j] = std::fabs(r[i][j]) + parallelEpsilon;
+			}
+		}
+
+		// Offset between the centers in the frame of a
+		float d[3] = { b.center[0] - a.center[0], b.center[1] - a.center[1], b.center[2] - a.center[2] };
+		float t[3];
+		for (int i = 0; i < 3; ++i)
+			t[i] = a.rotation[i] * d[0] + a.rotation[3 + i] * d[1] + a.rotation[6 + i] * d[2];
+
+		const float* ha = a.half;
+		const float* hb = b.half;
+
+		// Axes of a
+		for (int i = 0; i < 3; ++i)
+		{
+			if (std::fabs(t[i]) > ha[i] + hb[0] * absR[i][0] + hb[1] * absR[i][1] + hb[2] * absR[i][2])
+				return false;
+		}
+
+		// Axes of b
+		for (int j = 0; j < 3; ++j)
+		{
+			float distance = t[0] * r[0][j] + t[1] * r[1][j] + t[2] * r[2][j];
+			if (std::fabs(distance) > ha[0] * absR[0][j] + ha[1] * absR[1][j] + ha[2] * absR[2][j] + hb[j])
+				return false;
+		}
+
+		// Cross products of an axis of a and an axis of b
+		for (int i = 0; i < 3; ++i)
+		{
+			int i1 = (i + 1) % 3;
+			int i2 = (i + 2) % 3;
+			for (int j = 0; j < 3; ++j)
+			{
+				int j1 = (j + 1) % 3;
+				int j2 = (j + 2) % 3;
+				float distance = t[i2] * r[i1][j] - t[i1] * r[i2][j];
+				float radiusA = ha[i1] * absR[i2][j] + ha[i2] * absR[i1][j];
+				float radiusB = hb[j1] * absR[i][j2] + hb[j2] * absR[i][j1];
+				if (std::fabs(distance) > radiusA + radiusB)
+					return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+OverlapFinder::OverlapFinder(int argc, char* argv[])
+{
+	result = getArgs(argc, argv);
+	if (result != 0)
+		return;
+
+	result = run();
+}
+
+int OverlapFinder::getArgs(int argc, char* argv[])
+{
+	// Ensure minimum argument count is reached
+	if (argc < minArgCount)
+	{
+		showUsage();
+		return 1;
+	}
+
+	QStringList args;
+	for (int i = 2; i < argc - 2; ++i)
+	{
+		// Set worker thread count
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc - 2)
+		{
+			threadCount = atoi(argv[i + 1]);
+			i++;
+		}
+		else
+			args.append(QString::fromLocal8Bit(argv[i]));
+	}
+	int parseResult = options.parse(args, std::cerr);
+	if (parseResult != 0)
+		return parseResult;
+
+	inFileName = QString::fromLocal8Bit(argv[argc - 2]);
+	outFileName = QString::fromLocal8Bit(argv[argc - 1]);
+	jsonOutput = QFileInfo(outFileName).suffix().toLower() == "json";
+
+	// Check input exists
+	if (!QFileInfo(inFileName).isFile())
+	{
+		std::cerr << "Invalid input file";
+		return 2;
+	}
+
+	// Check output does not exist as a non-file
+	QFileInfo outputInfo(outFileName);
+	if (outputInfo.exists() && !outputInfo.isFile())
+	{
+		std::cerr << "Output location exists and is not a file, cannot overwrite";
+		return 3;
+	}
+
+	return 0;
+}
+
+void OverlapFinder::showUsage()
+{
+	std::cout << "Usage: TriggersToGLTF --overlaps [options] <input triggers> <output CSV or JSON>\n\n"
+		<< "Lists every pair of overlapping box triggers. Boxes that only touch overlap.\n"
+		<< "Outputs ending in .json hold an overlaps array of id1, type1, id2, type2 objects.\n"
+		<< "Other outputs are id1,type1,id2,type2 CSV lines.\n\n"
+		<< "Options:\n"
+		<< " -p   File platform. PS3, X360, PC, PS4, or NX. Default: PC\n"
+		<< " -j   Number of worker threads. Default: one per hardware thread";
+}
+
+int OverlapFinder::run()
+{
+	TriggerData triggerData;
+	int readResult = readTriggerResource(inFileName, options.platform, triggerData, std::cerr);
+	if (readResult != 0)
+		return readResult;
+
+	TriggerIndex index;
+	index.build(triggerData);
+	std::vector<OrientedBox> boxes = getOrientedBoxes(triggerData, index);
+	std::vector<std::pair<int32_t, int32_t>> overlaps = findOverlaps(boxes);
+
+	QFile outFile(outFileName);
+	if (!outFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		std::cerr << "Failed to open output file";
+		return 6;
+	}
+	if (!(jsonOutput ? writeJson(outFile, boxes, overlaps) : writeCsv(outFile, boxes, overlaps)))
+	{
+		std::cerr << "Failed to write output file";
+		return 6;
+	}
+	outFile.close();
+
+	std::cout << "Found " << overlaps.size() << " overlapping pairs among " << boxes.size() << " triggers";
+	return 0;
+}
+
+// Finds the pairs of overlapping boxes, as indices into boxes ordered by first then second
+std::vector<std::pair<int32_t, int32_t>> OverlapFinder::findOverlaps(const std::vector<OrientedBox>& boxes)
+{
+	// Sweep along the axis the boxes are most spread out on, so the fewest bounds overlap on it
+	int sweepAxis = 0;
+	float largestSpread = -1.0f;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float lowest = INFINITY;
+		float highest = -INFINITY;
+		for (const OrientedBox& box : boxes)
+		{
+			lowest = std::min(lowest, box.center[axis]);
+			highest = std::max(highest, box.center[axis]);
+		}
+		if (highest - lowest > largestSpread)
+		{
+			largestSpread = highest - lowest;
+			sweepAxis = axis;
+		}
+	}
+	int otherAxis1 = (sweepAxis + 1) % 3;
+	int otherAxis2 = (sweepAxis + 2) % 3;
+
+	std::vector<int32_t> order(boxes.size());
+	for (size_t i = 0; i < boxes.size(); ++i)
+		order[i] = (int32_t)i;
+	std::sort(order.begin(), order.end(), [&](int32_t a, int32_t b)
+	{
+		return boxes[a].min[sweepAxis] < boxes[b].min[sweepAxis];
+	});
+
+	// Bounds in sweep order as columns, so the inner loop reads them sequentially
+	std::vector<float> sweepMin(order.size()), sweepMax(order.size());
+	std::vector<float> min1(order.size()), max1(order.size());
+	std::vector<float> min2(order.size()), max2(order.size());
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		const OrientedBox& box = boxes[order[i]];
+		sweepMin[i] = box.min[sweepAxis];
+		sweepMax[i] = box.max[sweepAxis];
+		min1[i] = box.min[otherAxis1];
+		max1[i] = box.max[otherAxis1];
+		min2[i] = box.min[otherAxis2];
+		max2[i] = box.max[otherAxis2];
+	}
+
+	// Each box is checked against the boxes starting before it ends on the sweep axis.
+	// Ranges of boxes are checked in parallel, each gathering its own pairs
+	const size_t grain = 256;
+	std::vector<std::vector<std::pair<int32_t, int32_t>>> rangeOverlaps((order.size() + grain - 1) / grain);
+	ThreadPool pool(threadCount);
+	pool.parallelFor(order.size(), grain, [&](size_t begin, size_t end)
+	{
+		std::vector<std::pair<int32_t, int32_t>>& range = rangeOverlaps[begin / grain];
+		for (size_t i = begin; i < end; ++i)
+		{
+			for (size_t j = i + 1; j < order.size() && sweepMin[j] <= sweepMax[i]; ++j)
+			{
+				if (min1[j] > max1[i] || max1[j] < min1[i] || min2[j] > max2[i] || max2[j] < min2[i])
+					continue;
+
+				int32_t a = order[i];
+				int32_t b = order[j];
+				if (boxesOverlap(boxes[a], boxes[b]))
+					range.push_back({ std::min(a, b), std::max(a, b) });
+			}
+		}
+	});
+
+	std::vector<std::pair<int32_t, int32_t>> overlaps;
+	for (const std::vector<std::pair<int32_t, int32_t>>& range : rangeOverlaps)
+		overlaps.insert(overlaps.end(), range.begin(), range.end());
+	std::sort(overlaps.begin(), overlaps.end());
+	return overlaps;
+}
+
+// Writes overlapping pairs as CSV lines. Returns false if writing failed
+bool OverlapFinder::writeCsv(QFile& file, const std::vector<OrientedBox>& boxes,
+	const std::vector<std::pair<int32_t, int32_t>>& overlaps)
+{
+	std::string buffer = "id1,type1,id2,type2\n";
+	buffer.reserve(overlaps.size() * 48);
+	char number[16];
+	for (const auto& [first, second] : overlaps)
+	{
+		for (const OrientedBox* box : { &boxes[first], &boxes[second] })
+		{
+			buffer.append(number, std::to_chars(number, number + sizeof(number), box->id).ptr);
+			buffer += ',';
+			buffer += getTriggerRegionTypeName(box->type);
+			buffer += box == &boxes[first] ? ',' : '\n';
+		}
+	}
+	return file.write(buffer.data(), buffer.size()) == (qint64)buffer.size();
+}
+
+// Writes overlapping pairs as a JSON document. Returns false if writing failed
+bool OverlapFinder::writeJson(QFile& file, const std::vector<OrientedBox>& boxes,
+	const std::vector<std::pair<int32_t, int32_t>>& overlaps)
+{
+	JsonWriter json(&file, true);
+	json.beginObject();
+	json.key("triggerCount");
+	json.value((uint64_t)boxes.size());
+	json.key("overlaps");
+	json.beginArray();
+	for (const auto& [first, second] : overlaps)
+	{
+		json.beginObject();
+		json.key("id1");
+		json.value(boxes[first].id);
+		json.key("type1");
+		json.value(getTriggerRegionTypeName(boxes[first].type));
+		json.key("id2");
+		json.value(boxes[second].id);
+		json.key("type2");
+		json.value(getTriggerRegionTypeName(boxes[second].type));
+		json.endObject();
+	}
+	json.endArray();
+	json.endObject();
+	return json.flush();
+}
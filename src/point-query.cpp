@@ -0,0 +1,241 @@
+#include <point-query.h>
+#include <thread-pool.h>
+
+#include <QFileInfo>
+#include <QtEndian>
+
+#include <charconv>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	// Points read and queried at once
+	const size_t chunkSize = 1 << 20;
+
+	// Skips spaces and tabs
+	const char* skipBlanks(const char* begin, const char* end)
+	{
+		while (begin < end && (*begin == ' ' || *begin == '\t'))
+			begin++;
+		return begin;
+	}
+
+	// Parses the first three comma separated numbers of a line.
+	// Returns false if the line does not start with them
+	bool parsePoint(const char* begin, const char* end, float* point)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			begin = skipBlanks(begin, end);
+			if (begin < end && *begin == '+')
+				begin++;
+			auto [next, error] = std::from_chars(begin, end, point[i]);
+			if (error != std::errc())
+				return false;
+			begin = skipBlanks(next, end);
+			if (i < 2)
+			{
+				if (begin == end || *begin != ',')
+					return false;
+				begin++;
+			}
+		}
+		return begin == end || *begin == ',';
+	}
+}
+
+PointQuery::PointQuery(int argc, char* argv[])
+{
+	result = getArgs(argc, argv);
+	if (result != 0)
+		return;
+
+	result = run();
+}
+
+int PointQuery::getArgs(int argc, char* argv[])
+{
+	// Ensure minimum argument count is reached
+	if (argc < minArgCount)
+	{
+		showUsage();
+		return 1;
+	}
+
+	QStringList args;
+	for (int i = 2; i < argc - 3; ++i)
+	{
+		// Set worker thread count
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc - 3)
+		{
+			threadCount = atoi(argv[i + 1]);
+			i++;
+		}
+		else
+			args.append(QString::fromLocal8Bit(argv[i]));
+	}
+	int parseResult = options.parse(args, std::cerr);
+	if (parseResult != 0)
+		return parseResult;
+
+	inFileName = QString::fromLocal8Bit(argv[argc - 3]);
+	pointsFileName = QString::fromLocal8Bit(argv[argc - 2]);
+	outFileName = QString::fromLocal8Bit(argv[argc - 1]);
+	binaryPoints = QFileInfo(pointsFileName).suffix().toLower() == "bin";
+
+	// Check inputs exist
+	if (!QFileInfo(inFileName).isFile() || !QFileInfo(pointsFileName).isFile())
+	{
+		std::cerr << "Invalid input or points file";
+		return 2;
+	}
+
+	// Check output does not exist as a non-file
+	QFileInfo outputInfo(outFileName);
+	if (outputInfo.exists() && !outputInfo.isFile())
+	{
+		std::cerr << "Output location exists and is not a file, cannot overwrite";
+		return 3;
+	}
+
+	return 0;
+}
+
+void PointQuery::showUsage()
+{
+	std::cout << "Usage: TriggersToGLTF --query [options] <input triggers> <points file> <output CSV>\n\n"
+		<< "Lists the box triggers containing each point as point,id,type CSV lines,\n"
+		<< "where point is the index of the point in the file.\n"
+		<< "Points files ending in .bin hold little endian 32 bit float x, y, z triplets.\n"
+		<< "Other points files are CSV with x, y, z as the first columns, and an optional header.\n\n"
+		<< "Options:\n"
+		<< " -p   File platform. PS3, X360, PC, PS4, or NX. Default: PC\n"
+		<< " -j   Number of worker threads. Default: one per hardware thread";
+}
+
+int PointQuery::run()
+{
+	TriggerData triggerData;
+	int readResult = readTriggerResource(inFileName, options.platform, triggerData, std::cerr);
+	if (readResult != 0)
+		return readResult;
+
+	TriggerIndex index;
+	index.build(triggerData);
+	TriggerBvh bvh;
+	bvh.build(triggerData, index);
+
+	if (!pointsFile.open(pointsFileName))
+	{
+		std::cerr << "Failed to map points file";
+		return 5;
+	}
+	if (binaryPoints && pointsFile.size() % (sizeof(float) * 3) != 0)
+	{
+		std::cerr << "Binary points file size is not a multiple of 12 bytes";
+		return 5;
+	}
+
+	QFile outFile(outFileName);
+	if (!outFile.open(QIODevice::WriteOnly | QIODevice::Truncate) || outFile.write("point,id,type\n") < 0)
+	{
+		std::cerr << "Failed to open output file";
+		return 6;
+	}
+
+	// Each chunk is queried in parallel while its hits stay in point order
+	ThreadPool pool(threadCount);
+	std::vector<float> points;
+	std::vector<TriggerBvh::Hit> hits;
+	uint64_t pointCount = 0;
+	uint64_t hitCount = 0;
+	while (true)
+	{
+		readResult = readPoints(points, chunkSize);
+		if (readResult != 0)
+			return readResult;
+		if (points.empty())
+			break;
+
+		size_t count = points.size() / 3;
+		hits.clear();
+		bvh.query(points.data(), pointCount, count, &pool, hits);
+		if (!writeHits(outFile, hits))
+		{
+			std::cerr << "Failed to write output file";
+			return 6;
+		}
+		pointCount += count;
+		hitCount += hits.size();
+	}
+	pointsFile.close();
+	outFile.close();
+
+	std::cout << "Checked " << pointCount << " points against " << bvh.size() << " triggers, "
+		<< hitCount << " hits";
+	return 0;
+}
+
+// Reads up to maxCount points following the last read. Returns 0 on success
+int PointQuery::readPoints(std::vector<float>& points, size_t maxCount)
+{
+	points.clear();
+	const char* data = (const char*)pointsFile.data();
+	qint64 size = pointsFile.size();
+
+	if (binaryPoints)
+	{
+		size_t count = std::min<size_t>(maxCount, (size - pointsOffset) / (sizeof(float) * 3));
+		points.resize(count * 3);
+		qFromLittleEndian<float>(data + pointsOffset, count * 3, points.data());
+		pointsOffset += count * sizeof(float) * 3;
+		return 0;
+	}
+
+	while (pointsOffset < size && points.size() < maxCount * 3)
+	{
+		const char* line = data + pointsOffset;
+		const char* end = (const char*)memchr(line, '\n', size - pointsOffset);
+		if (end == nullptr)
+			end = data + size;
+		pointsOffset = end - data + 1;
+		lineNumber++;
+
+		if (end > line && end[-1] == '\r')
+			end--;
+		if (skipBlanks(line, end) == end)
+			continue;
+
+		float point[3];
+		if (!parsePoint(line, end, point))
+		{
+			// The first line may be a header
+			if (lineNumber == 1)
+				continue;
+			std::cerr << "Invalid point on line " << lineNumber << " of the points file";
+			return 5;
+		}
+		points.insert(points.end(), point, point + 3);
+	}
+
+	return 0;
+}
+
+// Writes hits as CSV lines. Returns false if writing failed
+bool PointQuery::writeHits(QFile& file, const std::vector<TriggerBvh::Hit>& hits)
+{
+	std::string buffer;
+	buffer.reserve(hits.size() * 32);
+	char number[24];
+	for (const TriggerBvh::Hit& hit : hits)
+	{
+		buffer.append(number, std::to_chars(number, number + sizeof(number), hit.point).ptr);
+		buffer += ',';
+		buffer.append(number, std::to_chars(number, number + sizeof(number), hit.id).ptr);
+		buffer += ',';
+		buffer += getTriggerRegionTypeName(hit.type);
+		buffer += '\n';
+	}
+	return file.write(buffer.data(), buffer.size()) == (qint64)buffer.size();
+}
@@ -0,0 +1,284 @@
+#include <rotation.h>
+#include <cpu-features.h>
+
+#include <cmath>
+
+namespace
+{
+	// Cody-Waite reduction by multiples of pi/4 and the sine and cosine polynomials
+	// on [-pi/4, pi/4], from the Cephes library's single precision sinf and cosf
+	const float fourOverPi = 1.27323954473516f;
+	const float reduction1 = 0.78515625f;
+	const float reduction2 = 2.4187564849853515625e-4f;
+	const float reduction3 = 3.77489497744594108e-8f;
+	const float sin1 = -1.9515295891e-4f;
+	const float sin2 = 8.3321608736e-3f;
+	const float sin3 = -1.6666654611e-1f;
+	const float cos1 = 2.443315711809948e-5f;
+	const float cos2 = -1.388731625493765e-3f;
+	const float cos3 = 4.166664568298827e-2f;
+
+	// Beyond this, the reduction loses too much precision
+	const float maxReducedAngle = 8192.0f;
+
+	void sinCosScalar(float angle, float& sine, float& cosine)
+	{
+		float absAngle = std::fabs(angle);
+		if (!(absAngle <= maxReducedAngle))
+		{
+			sine = std::sin(angle);
+			cosine = std::cos(angle);
+			return;
+		}
+
+		// Reduce to [-pi/4, pi/4] around the nearest even multiple of pi/4
+		int octant = ((int)(absAngle * fourOverPi) + 1) & ~1;
+		float y = (float)octant;
+		float r = ((absAngle - y * reduction1) - y * reduction2) - y * reduction3;
+		float r2 = r * r;
+		float cosPoly = ((cos1 * r2 + cos2) * r2 + cos3) * r2 * r2 - 0.5f * r2 + 1.0f;
+		float sinPoly = ((sin1 * r2 + sin2) * r2 + sin3) * r2 * r + r;
+
+		// Around odd multiples of pi/2, sine and cosine swap
+		bool swap = (octant & 2) != 0;
+		sine = swap ? cosPoly : sinPoly;
+		cosine = swap ? sinPoly : cosPoly;
+		if (((octant & 4) != 0) != (angle < 0.0f))
+			sine = -sine;
+		if (((octant - 2) & 4) == 0)
+			cosine = -cosine;
+	}
+
+	void eulerToQuatsScalar(const float* x, const float* y, const float* z, float* quats, qsizetype count)
+	{
+		for (qsizetype i = 0; i < count; ++i)
+		{
+			float sr, cr, sp, cp, sy, cy;
+			sinCosScalar(x[i] * 0.5f, sr, cr);
+			sinCosScalar(y[i] * 0.5f, sp, cp);
+			sinCosScalar(z[i] * 0.5f, sy, cy);
+
+			float* quat = quats + i * 4;
+			quat[0] = sr * cp * cy + cr * sp * sy;
+			quat[1] = cr * sp * cy - sr * cp * sy;
+			quat[2] = cr * cp * sy + sr * sp * cy;
+			quat[3] = cr * cp * cy - sr * sp * sy;
+		}
+	}
+
+#ifdef CPU_X86
+	// Computes four sines and cosines like sinCosScalar.
+	// Returns a nonzero lane mask if any angle is out of range for the reduction
+	TARGET_SSE2 int sinCosSse2(__m128 angle, __m128& sine, __m128& cosine)
+	{
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+		__m128 absAngle = _mm_andnot_ps(signMask, angle);
+		int outOfRange = _mm_movemask_ps(_mm_cmpnle_ps(absAngle, _mm_set1_ps(maxReducedAngle)));
+
+		__m128i octant = _mm_cvttps_epi32(_mm_mul_ps(absAngle, _mm_set1_ps(fourOverPi)));
+		octant = _mm_and_si128(_mm_add_epi32(octant, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+		__m128 y = _mm_cvtepi32_ps(octant);
+		__m128 r = _mm_sub_ps(absAngle, _mm_mul_ps(y, _mm_set1_ps(reduction1)));
+		r = _mm_sub_ps(r, _mm_mul_ps(y, _mm_set1_ps(reduction2)));
+		r = _mm_sub_ps(r, _mm_mul_ps(y, _mm_set1_ps(reduction3)));
+		__m128 r2 = _mm_mul_ps(r, r);
+
+		__m128 cosPoly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(cos1), r2), _mm_set1_ps(cos2));
+		cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, r2), _mm_set1_ps(cos3));
+		cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, r2), r2);
+		cosPoly = _mm_add_ps(_mm_sub_ps(cosPoly, _mm_mul_ps(r2, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+		__m128 sinPoly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(sin1), r2), _mm_set1_ps(sin2));
+		sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, r2), _mm_set1_ps(sin3));
+		sinPoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPoly, r2), r), r);
+
+		// Around odd multiples of pi/2, sine and cosine swap
+		__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_set1_epi32(2)));
+		sine = _mm_or_ps(_mm_and_ps(swap, cosPoly), _mm_andnot_ps(swap, sinPoly));
+		cosine = _mm_or_ps(_mm_and_ps(swap, sinPoly), _mm_andnot_ps(swap, cosPoly));
+
+		__m128 sineSign = _mm_xor_ps(_mm_and_ps(angle, signMask),
+			_mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, _mm_set1_epi32(4)), 29)));
+		__m128 cosineSign = _mm_castsi128_ps(_mm_slli_epi32(
+			_mm_andnot_si128(_mm_sub_epi32(octant, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+		sine = _mm_xor_ps(sine, sineSign);
+		cosine = _mm_xor_ps(cosine, cosineSign);
+
+		return outOfRange;
+	}
+
+	TARGET_SSE2 void eulerToQuatsSse2(const float* x, const float* y, const float* z, float* quats, qsizetype count)
+	{
+		const __m128 half = _mm_set1_ps(0.5f);
+		qsizetype i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 sr, cr, sp, cp, sy, cy;
+			int outOfRange = sinCosSse2(_mm_mul_ps(_mm_loadu_ps(x + i), half), sr, cr)
+				| sinCosSse2(_mm_mul_ps(_mm_loadu_ps(y + i), half), sp, cp)
+				| sinCosSse2(_mm_mul_ps(_mm_loadu_ps(z + i), half), sy, cy);
+			if (outOfRange != 0)
+			{
+				eulerToQuatsScalar(x + i, y + i, z + i, quats + i * 4, 4);
+				continue;
+			}
+
+			__m128 cpcy = _mm_mul_ps(cp, cy);
+			__m128 spsy = _mm_mul_ps(sp, sy);
+			__m128 cpsy = _mm_mul_ps(cp, sy);
+			__m128 spcy = _mm_mul_ps(sp, cy);
+			__m128 qx = _mm_add_ps(_mm_mul_ps(sr, cpcy), _mm_mul_ps(cr, spsy));
+			__m128 qy = _mm_sub_ps(_mm_mul_ps(cr, spcy), _mm_mul_ps(sr, cpsy));
+			__m128 qz = _mm_add_ps(_mm_mul_ps(cr, cpsy), _mm_mul_ps(sr, spcy));
+			__m128 qw = _mm_sub_ps(_mm_mul_ps(cr, cpcy), _mm_mul_ps(sr, spsy));
+
+			// Interleave the components into x, y, z, w per quaternion
+			_MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+			_mm_storeu_ps(quats + i * 4, qx);
+			_mm_storeu_ps(quats + i * 4 + 4, qy);
+			_mm_storeu_ps(quats + i * 4 + 8, qz);
+			_mm_storeu_ps(quats + i * 4 + 12, qw);
+		}
+		eulerToQuatsScalar(x + i, y + i, z + i, quats + i * 4, count - i);
+	}
+
+	// Computes eight sines and cosines like sinCosSse2, with fused multiply-adds
+	TARGET_AVX2_FMA int sinCosAvx2(__m256 angle, __m256& sine, __m256& cosine)
+	{
+		const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x80000000));
+		__m256 absAngle = _mm256_andnot_ps(signMask, angle);
+		int outOfRange = _mm256_movemask_ps(_mm256_cmp_ps(absAngle, _mm256_set1_ps(maxReducedAngle), _CMP_NLE_UQ));
+
+		__m256i octant = _mm256_cvttps_epi32(_mm256_mul_ps(absAngle, _mm256_set1_ps(fourOverPi)));
+		octant = _mm256_and_si256(_mm256_add_epi32(octant, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+		__m256 y = _mm256_cvtepi32_ps(octant);
+		__m256 r = _mm256_fnmadd_ps(y, _mm256_set1_ps(reduction1), absAngle);
+		r = _mm256_fnmadd_ps(y, _mm256_set1_ps(reduction2), r);
+		r = _mm256_fnmadd_ps(y, _mm256_set1_ps(reduction3), r);
+		__m256 r2 = _mm256_mul_ps(r, r);
+
+		__m256 cosPoly = _mm256_fmadd_ps(_mm256_set1_ps(cos1), r2, _mm256_set1_ps(cos2));
+		cosPoly = _mm256_fmadd_ps(cosPoly, r2, _mm256_set1_ps(cos3));
+		cosPoly = _mm256_mul_ps(_mm256_mul_ps(cosPoly, r2), r2);
+		cosPoly = _mm256_add_ps(_mm256_fnmadd_ps(r2, _mm256_set1_ps(0.5f), cosPoly), _mm256_set1_ps(1.0f));
+		__m256 sinPoly = _mm256_fmadd_ps(_mm256_set1_ps(sin1), r2, _mm256_set1_ps(sin2));
+		sinPoly = _mm256_fmadd_ps(sinPoly, r2, _mm256_set1_ps(sin3));
+		sinPoly = _mm256_fmadd_ps(_mm256_mul_ps(sinPoly, r2), r, r);
+
+		// Around odd multiples of pi/2, sine and cosine swap
+		__m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+			_mm256_and_si256(octant, _mm256_set1_epi32(2)), _mm256_set1_epi32(2)));
+		sine = _mm256_blendv_ps(sinPoly, cosPoly, swap);
+		cosine = _mm256_blendv_ps(cosPoly, sinPoly, swap);
+
+		__m256 sineSign = _mm256_xor_ps(_mm256_and_ps(angle, signMask),
+			_mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(octant, _mm256_set1_epi32(4)), 29)));
+		__m256 cosineSign = _mm256_castsi256_ps(_mm256_slli_epi32(
+			_mm256_andnot_si256(_mm256_sub_epi32(octant, _mm256_set1_epi32(2)), _mm256_set1_epi32(4)), 29));
+		sine = _mm256_xor_ps(sine, sineSign);
+		cosine = _mm256_xor_ps(cosine, cosineSign);
+
+		return outOfRange;
+	}
+
+	TARGET_AVX2_FMA void eulerToQuatsAvx2(const float* x, const float* y, const float* z, float* quats, qsizetype count)
+	{
+		const __m256 half = _mm256_set1_ps(0.5f);
+		qsizetype i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 sr, cr, sp, cp, sy, cy;
+			int outOfRange = sinCosAvx2(_mm256_mul_ps(_mm256_loadu_ps(x + i), half), sr, cr)
+				| sinCosAvx2(_mm256_mul_ps(_mm256_loadu_ps(y + i), half), sp, cp)
+				| sinCosAvx2(_mm256_mul_ps(_mm256_loadu_ps(z + i), half), sy, cy);
+			if (outOfRange != 0)
+			{
+				eulerToQuatsScalar(x + i, y + i, z + i, quats + i * 4, 8);
+				continue;
+			}
+
+			__m256 cpcy = _mm256_mul_ps(cp, cy);
+			__m256 spsy = _mm256_mul_ps(sp, sy);
+			__m256 cpsy = _mm256_mul_ps(cp, sy);
+			__m256 spcy = _mm256_mul_ps(sp, cy);
+			__m256 qx = _mm256_fmadd_ps(sr, cpcy, _mm256_mul_ps(cr, spsy));
+			__m256 qy = _mm256_fmsub_ps(cr, spcy, _mm256_mul_ps(sr, cpsy));
+			__m256 qz = _mm256_fmadd_ps(cr, cpsy, _mm256_mul_ps(sr, spcy));
+			__m256 qw = _mm256_fmsub_ps(cr, cpcy, _mm256_mul_ps(sr, spsy));
+
+			// Interleave the components into x, y, z, w per quaternion.
+			// Shuffles stay within 128 bit lanes, giving quaternions i and i + 4 per register
+			__m256 xy0 = _mm256_unpacklo_ps(qx, qy);
+			__m256 xy1 = _mm256_unpackhi_ps(qx, qy);
+			__m256 zw0 = _mm256_unpacklo_ps(qz, qw);
+			__m256 zw1 = _mm256_unpackhi_ps(qz, qw);
+			__m256 q04 = _mm256_shuffle_ps(xy0, zw0, 0x44);
+			__m256 q15 = _mm256_shuffle_ps(xy0, zw0, 0xEE);
+			__m256 q26 = _mm256_shuffle_ps(xy1, zw1, 0x44);
+			__m256 q37 = _mm256_shuffle_ps(xy1, zw1, 0xEE);
+			_mm256_storeu_ps(quats + i * 4, _mm256_permute2f128_ps(q04, q15, 0x20));
+			_mm256_storeu_ps(quats + i * 4 + 8, _mm256_permute2f128_ps(q26, q37, 0x20));
+			_mm256_storeu_ps(quats + i * 4 + 16, _mm256_permute2f128_ps(q04, q15, 0x31));
+			_mm256_storeu_ps(quats + i * 4 + 24, _mm256_permute2f128_ps(q26, q37, 0x31));
+		}
+		eulerToQuatsSse2(x + i, y + i, z + i, quats + i * 4, count - i);
+	}
+
+	enum class Kernel
+	{
+		scalar,
+		sse2,
+		avx2
+	};
+
+	Kernel detectKernel()
+	{
+		const CpuFeatures& features = getCpuFeatures();
+		if (features.avx2 && features.fma)
+			return Kernel::avx2;
+		if (features.sse2)
+			return Kernel::sse2;
+		return Kernel::scalar;
+	}
+#endif
+}
+
+// Converts count Euler rotations in radians, given as separate x, y and z arrays,
+// to quaternions written to quats as x, y, z, w.
+// Sine and cosine of the half angles use polynomials after reducing them to
+// [-pi/4, pi/4]. For half angles up to 8192 in magnitude each sine and cosine is
+// within 1e-7 of the exact value, which bounds each quaternion component's error
+// by 1e-6. Larger angles fall back to the standard library.
+// Uses AVX2 with FMA or SSE2 when the CPU supports them, with a scalar fallback.
+void eulerToQuats(const float* x, const float* y, const float* z, float* quats, qsizetype count)
+{
+#ifdef CPU_X86
+	static const Kernel kernel = detectKernel();
+	switch (kernel)
+	{
+	case Kernel::avx2:
+		eulerToQuatsAvx2(x, y, z, quats, count);
+		return;
+	case Kernel::sse2:
+		eulerToQuatsSse2(x, y, z, quats, count);
+		return;
+	case Kernel::scalar:
+		break;
+	}
+#endif
+	eulerToQuatsScalar(x, y, z, quats, count);
+}
+
+// Converts a unit quaternion given as x, y, z, w to a row major 3x3 rotation matrix
+void quatToMatrix(const float* quat, float* matrix)
+{
+	float x = quat[0], y = quat[1], z = quat[2], w = quat[3];
+	matrix[0] = 1.0f - 2.0f * (y * y + z * z);
+	matrix[1] = 2.0f * (x * y - z * w);
+	matrix[2] = 2.0f * (x * z + y * w);
+	matrix[3] = 2.0f * (x * y + z * w);
+	matrix[4] = 1.0f - 2.0f * (x * x + z * z);
+	matrix[5] = 2.0f * (y * z - x * w);
+	matrix[6] = 2.0f * (x * z - y * w);
+	matrix[7] = 2.0f * (y * z + x * w);
+	matrix[8] = 1.0f - 2.0f * (x * x + y * y);
+}
@@ -0,0 +1,392 @@
+#include <run-stats.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+	// Allocations made by one thread. Only that thread writes its count, so
+	// threads allocating at once never write to the same cache line
+	struct ThreadAllocations
+	{
+		ThreadAllocations();
+		~ThreadAllocations();
+
+		std::atomic<uint64_t> count = 0;
+		ThreadAllocations* previous = nullptr;
+		ThreadAllocations* next = nullptr;
+	};
+
+	// Allocations are only counted once a report asks for them
+	std::atomic<bool> countingEnabled = false;
+
+	// Counters of running threads, linked without allocating, and the
+	// allocations of threads that have exited
+	std::mutex threadsMutex;
+	ThreadAllocations* threads = nullptr;
+	std::atomic<uint64_t> exitedAllocations = 0;
+
+	// Set once the counter of the thread is destroyed. Trivially destructible, so
+	// allocations made by later thread_local and static destructors can still check it
+	thread_local bool threadExited = false;
+	thread_local ThreadAllocations threadAllocations;
+
+	ThreadAllocations::ThreadAllocations()
+	{
+		std::lock_guard<std::mutex> lock(threadsMutex);
+		next = threads;
+		if (next != nullptr)
+			next->previous = this;
+		threads = this;
+	}
+
+	ThreadAllocations::~ThreadAllocations()
+	{
+		std::lock_guard<std::mutex> lock(threadsMutex);
+		exitedAllocations.fetch_add(count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		threadExited = true;
+		if (previous != nullptr)
+			previous->next = next;
+		else
+			threads = next;
+		if (next != nullptr)
+			next->previous = previous;
+	}
+
+	void countAllocation()
+	{
+		if (!countingEnabled.load(std::memory_order_relaxed))
+			return;
+
+		// Allocations made after the counter of the thread is gone are rare
+		if (threadExited)
+		{
+			exitedAllocations.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		std::atomic<uint64_t>& count = threadAllocations.count;
+		count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	// Allocates with an alignment larger than malloc's. Returns nullptr on failure
+	void* alignedAlloc(std::size_t size, std::align_val_t alignment)
+	{
+		std::size_t align = (std::size_t)alignment;
+#ifdef _WIN32
+		return _aligned_malloc(size > 0 ? size : 1, align);
+#else
+		// aligned_alloc needs a multiple of the alignment
+		std::size_t alignedSize = size > 0 ? (size + align - 1) / align * align : align;
+		return std::aligned_alloc(align, alignedSize);
+#endif
+	}
+
+	void alignedFree(void* pointer)
+	{
+#ifdef _WIN32
+		_aligned_free(pointer);
+#else
+		std::free(pointer);
+#endif
+	}
+}
+
+// Every allocation of the process is counted once enabled. Every form of new and delete
+// is replaced, so they all pair with malloc and free, or their aligned versions
+void* operator new(std::size_t size)
+{
+	countAllocation();
+	void* pointer = std::malloc(size > 0 ? size : 1);
+	if (pointer == nullptr)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	countAllocation();
+	return std::malloc(size > 0 ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	countAllocation();
+	void* pointer = alignedAlloc(size, alignment);
+	if (pointer == nullptr)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	countAllocation();
+	return alignedAlloc(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t& tag) noexcept
+{
+	return operator new(size, alignment, tag);
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+	alignedFree(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept
+{
+	alignedFree(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept
+{
+	alignedFree(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept
+{
+	alignedFree(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	alignedFree(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	alignedFree(pointer);
+}
+
+RunStats::RunStats(bool processWide)
+	: processWide(processWide), start(Sample::now(processWide))
+{
+
+}
+
+RunStats::Sample RunStats::Sample::now(bool processWide)
+{
+	Sample sample;
+	sample.wallTime = std::chrono::steady_clock::now();
+	if (processWide)
+	{
+		sample.cpuTime = getProcessCpuTime();
+		sample.allocations = getAllocationCount();
+	}
+	return sample;
+}
+
+// Starts timing a phase, ending the current one
+void RunStats::beginPhase(const char* name)
+{
+	endPhase();
+	phaseName = name;
+	phaseStart = Sample::now(processWide);
+}
+
+// Ends the current phase
+void RunStats::endPhase()
+{
+	if (phaseName == nullptr)
+		return;
+
+	phases.push_back(getPhase(phaseName, phaseStart, Sample::now(processWide)));
+	phaseName = nullptr;
+}
+
+// Sets a record count reported under the name
+void RunStats::setCount(const char* name, int64_t count)
+{
+	for (auto& [countName, value] : counts)
+	{
+		if (strcmp(countName, name) == 0)
+		{
+			value = count;
+			return;
+		}
+	}
+	counts.push_back({ name, count });
+}
+
+// Writes the report as keys of the current object. Ends the current phase
+void RunStats::write(JsonWriter& json)
+{
+	endPhase();
+
+	json.key("total");
+	writePhase(json, getPhase("total", start, Sample::now(processWide)));
+
+	json.key("phases");
+	json.beginArray();
+	for (const Phase& phase : phases)
+		writePhase(json, phase);
+	json.endArray();
+
+	json.key("counts");
+	json.beginObject();
+	for (const auto& [name, count] : counts)
+	{
+		json.key(name);
+		json.value(count);
+	}
+	json.endObject();
+
+	json.key("bytesRead");
+	json.value(bytesRead);
+	json.key("bytesWritten");
+	json.value(bytesWritten);
+	if (processWide)
+	{
+		json.key("peakResidentBytes");
+		json.value(getPeakResidentSize());
+	}
+}
+
+RunStats::Phase RunStats::getPhase(const char* name, const Sample& start, const Sample& end)
+{
+	Phase phase;
+	phase.name = name;
+	phase.wallTime = std::chrono::duration<double>(end.wallTime - start.wallTime).count();
+	phase.cpuTime = end.cpuTime - start.cpuTime;
+	phase.allocations = end.allocations - start.allocations;
+	return phase;
+}
+
+// CPU time and allocations are left out of reports that don't have the process to themselves
+void RunStats::writePhase(JsonWriter& json, const Phase& phase) const
+{
+	json.beginObject();
+	json.key("name");
+	json.value(phase.name);
+	json.key("wallMs");
+	json.value(phase.wallTime * 1000.0);
+	if (processWide)
+	{
+		json.key("cpuMs");
+		json.value(phase.cpuTime * 1000.0);
+		json.key("allocations");
+		json.value(phase.allocations);
+	}
+	json.endObject();
+}
+
+// Starts counting heap allocations, for reports asking for them
+void RunStats::enableAllocationCounting()
+{
+	countingEnabled.store(true, std::memory_order_relaxed);
+}
+
+// Get the number of heap allocations made by the process since counting was enabled
+uint64_t RunStats::getAllocationCount()
+{
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	uint64_t count = exitedAllocations.load(std::memory_order_relaxed);
+	for (ThreadAllocations* thread = threads; thread != nullptr; thread = thread->next)
+		count += thread->count.load(std::memory_order_relaxed);
+	return count;
+}
+
+// Get the CPU time used by all threads of the process so far, in seconds
+double RunStats::getProcessCpuTime()
+{
+#ifdef _WIN32
+	FILETIME creation, exit, kernel, user;
+	if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+		return 0.0;
+
+	// 100 ns units
+	auto toSeconds = [](const FILETIME& time)
+	{
+		return (((uint64_t)time.dwHighDateTime << 32) | time.dwLowDateTime) * 1e-7;
+	};
+	return toSeconds(kernel) + toSeconds(user);
+#else
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0.0;
+
+	return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+		+ (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#endif
+}
+
+// Get the largest resident set size of the process so far, in bytes
+int64_t RunStats::getPeakResidentSize()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+
+	return counters.PeakWorkingSetSize;
+#else
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+
+	// Reported in bytes on macOS and kilobytes elsewhere
+#ifdef __APPLE__
+	return usage.ru_maxrss;
+#else
+	return (int64_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
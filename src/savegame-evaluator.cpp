@@ -0,0 +1,373 @@
+#include <savegame-evaluator.h>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QTextStream>
+
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+namespace
+{
+	// Quotes a CSV field if it holds a separator, quote or line break
+	std::string csvField(const std::string& text)
+	{
+		if (text.find_first_of(",\"\r\n") == std::string::npos)
+			return text;
+
+		std::string quoted = "\"";
+		for (char c : text)
+		{
+			if (c == '"')
+				quoted += '"';
+			quoted += c;
+		}
+		return quoted + "\"";
+	}
+
+	// An export path as the file system compares it. Windows and macOS ignore case by default
+	QString getPathKey(const QString& path)
+	{
+#if defined(_WIN32) || defined(__APPLE__)
+		return path.toLower();
+#else
+		return path;
+#endif
+	}
+}
+
+SavegameEvaluator::SavegameEvaluator(int argc, char* argv[])
+{
+	result = getArgs(argc, argv);
+	if (result != 0)
+		return;
+
+	result = QFileInfo(source).isDir() ? readSaveDirectory() : readSaveList();
+	if (result != 0)
+		return;
+
+	ThreadPool pool(threadCount);
+	result = matrixOutput ? writeMatrix(pool) : writeExports(pool);
+	if (result != 0)
+		return;
+
+	report();
+}
+
+int SavegameEvaluator::getArgs(int argc, char* argv[])
+{
+	// Ensure minimum argument count is reached
+	if (argc < minArgCount)
+	{
+		showUsage();
+		return 1;
+	}
+
+	QStringList args;
+	for (int i = 2; i < argc - 3; ++i)
+	{
+		// Set worker thread count
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc - 3)
+		{
+			threadCount = atoi(argv[i + 1]);
+			i++;
+		}
+		else
+			args.append(QString::fromLocal8Bit(argv[i]));
+	}
+	int parseResult = options.parse(args, std::cerr);
+	if (parseResult != 0)
+		return parseResult;
+	if (options.writesDirectory())
+	{
+		std::cerr << "--grid, --quadtree and --split cannot be combined with --saves";
+		return 4;
+	}
+
+	options.inFileName = QString::fromLocal8Bit(argv[argc - 3]).toStdString();
+	source = QString::fromLocal8Bit(argv[argc - 2]);
+	outFileName = QString::fromLocal8Bit(argv[argc - 1]);
+	matrixOutput = QFileInfo(outFileName).suffix().toLower() == "csv";
+
+	// Check inputs exist
+	if (!QFileInfo(QString::fromStdString(options.inFileName)).isFile())
+	{
+		std::cerr << "Invalid input file";
+		return 2;
+	}
+	if (!QFileInfo::exists(source))
+	{
+		std::cerr << "Invalid savegame list or directory";
+		return 2;
+	}
+
+	// The matrix is a file, and exports go to a directory created if needed
+	QFileInfo outputInfo(outFileName);
+	if (matrixOutput && outputInfo.exists() && !outputInfo.isFile())
+	{
+		std::cerr << "Output location exists and is not a file, cannot overwrite";
+		return 3;
+	}
+	if (!matrixOutput && ((outputInfo.exists() && !outputInfo.isDir()) || !QDir().mkpath(outFileName)))
+	{
+		std::cerr << "Output location is not a directory and cannot be created";
+		return 3;
+	}
+
+	return 0;
+}
+
+void SavegameEvaluator::showUsage()
+{
+	std::cout << "Usage: TriggersToGLTF --saves [options] <input triggers> <savegame list or directory> <output CSV or directory>\n\n"
+		<< "Checks every savegame of the directory, or every savegame listed, against one read\n"
+		<< "of the input. Each list line is [-p platform] <savegame>, relative to the list.\n"
+		<< "Lines starting with # are ignored.\n"
+		<< "Outputs ending in .csv hold a completion matrix, with a row per savegame and a\n"
+		<< "column per collectible, 1 if collected. Otherwise, the output directory gets a\n"
+		<< "glTF per savegame of the collectibles not collected in it.\n\n"
+		<< "Options:\n"
+		<< " -p   Platform of the input, and of savegames not listed with one. Default: PC\n"
+		<< " -j   Number of worker threads. Default: one per hardware thread\n"
+		<< " -m, -b, -f, --select  As for single files, applied to every export.\n"
+		<< "      Exports hold generic regions of types 8, 9 and 13 unless -f or --select is given.";
+}
+
+int SavegameEvaluator::readSaveList()
+{
+	QFile list(source);
+	if (!list.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		std::cerr << "Failed to open savegame list";
+		return 2;
+	}
+
+	// Savegames are relative to the list
+	QDir listDir = QFileInfo(source).absoluteDir();
+
+	QTextStream stream(&list);
+	int lineNumber = 0;
+	while (!stream.atEnd())
+	{
+		QString line = stream.readLine().trimmed();
+		lineNumber++;
+		if (line.isEmpty() || line.startsWith('#'))
+			continue;
+
+		Save save;
+		QStringList args = QProcess::splitCommand(line);
+		save.name = args.back();
+		save.fileName = listDir.filePath(args.back());
+
+		// Only the platform of a line is used
+		ConverterOptions lineOptions = options;
+		std::ostringstream err;
+		save.result = lineOptions.parse(args.mid(0, args.size() - 1), err);
+		save.error = err.str();
+		save.platform = lineOptions.platform;
+		if (save.result != 0)
+			save.name = "List line " + QString::number(lineNumber);
+		saves.push_back(save);
+	}
+
+	return 0;
+}
+
+int SavegameEvaluator::readSaveDirectory()
+{
+	QFileInfoList inputs = QDir(source).entryInfoList(QDir::Files, QDir::Name);
+	for (const QFileInfo& input : inputs)
+	{
+		Save save;
+		save.name = input.fileName();
+		save.fileName = input.filePath();
+		save.platform = options.platform;
+		saves.push_back(save);
+	}
+
+	return 0;
+}
+
+// Maps and decodes a savegame. Returns 0 on success
+int SavegameEvaluator::readSavegame(Save& save, CollectedSet& collected)
+{
+	MappedFile file;
+	if (!file.open(save.fileName))
+	{
+		save.error = "Failed to map savegame file";
+		return 5;
+	}
+
+	if (parseSavegame(file.data(), file.size(), save.platform, collected) != QDataStream::Ok)
+	{
+		save.error = "Savegame file is truncated or not a valid savegame";
+		return 5;
+	}
+
+	return 0;
+}
+
+// Writes a glTF per savegame of the triggers it has not collected.
+// The input is read and selected once, and exports only read the shared converter
+int SavegameEvaluator::writeExports(ThreadPool& pool)
+{
+	ConverterOptions exportOptions = options;
+	if (exportOptions.selection.empty())
+		exportOptions.selection = "type=8,9,13";
+	exportOptions.profileFileName.clear();
+
+	std::ostringstream err;
+	Converter converter(exportOptions, err, &pool, false);
+	if (converter.result != 0)
+	{
+		std::cerr << err.str();
+		return converter.result;
+	}
+
+	// Exports keep the listed path of their savegame, with the glTF extension.
+	// Savegames whose export would leave the output directory, or is already written
+	// by another savegame, are not exported. Case is ignored for case-insensitive file systems
+	QDir outDir(outFileName);
+	QString extension = exportOptions.getGltfExtension();
+	std::map<QString, const Save*> exports;
+	for (Save& save : saves)
+	{
+		if (save.result != 0)
+			continue;
+
+		QFileInfo nameInfo(save.name);
+		QString exportPath = QDir::cleanPath(nameInfo.path() + "/" + nameInfo.completeBaseName() + extension);
+		if (QDir::isAbsolutePath(exportPath) || exportPath == ".." || exportPath.startsWith("../"))
+		{
+			save.result = 4;
+			save.error = "Export " + exportPath.toStdString() + " would be outside the output directory";
+			continue;
+		}
+
+		save.exportFileName = outDir.filePath(exportPath);
+		auto [first, inserted] = exports.emplace(getPathKey(exportPath), &save);
+		if (!inserted)
+		{
+			save.result = 4;
+			save.error = "Export " + exportPath.toStdString() + " is also written by " + first->second->name.toStdString();
+		}
+	}
+
+	pool.parallelFor(saves.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			Save& save = saves[i];
+			CollectedSet collected;
+			if (save.result != 0 || (save.result = readSavegame(save, collected)) != 0)
+				continue;
+
+			QDir().mkpath(QFileInfo(save.exportFileName).absolutePath());
+			int nodeCount = 0;
+			if (!converter.exportSavegame(collected, save.exportFileName, nodeCount))
+			{
+				save.result = 6;
+				save.error = "Failed to write output file";
+			}
+		}
+	});
+
+	return 0;
+}
+
+// Writes the completion matrix, with a row per savegame and a column per collectible
+int SavegameEvaluator::writeMatrix(ThreadPool& pool)
+{
+	// Every collectible is a generic region, so only they are read
+	MappedFile inFile;
+	if (!inFile.open(QString::fromStdString(options.inFileName)))
+	{
+		std::cerr << "Failed to map input file";
+		return 5;
+	}
+	TriggerData triggerData;
+	if (parseTriggerResource(inFile.data(), inFile.size(), options.platform, triggerData,
+		(uint16_t)TriggerData::Section::genericRegions) != QDataStream::Ok)
+	{
+		std::cerr << "Input file is truncated or not a valid triggers resource";
+		return 5;
+	}
+
+	std::vector<const GenericRegion*> collectibles;
+	for (int i = 0; i < triggerData.genericRegionCount; ++i)
+	{
+		if (Converter::isCollectible(triggerData.genericRegions[i]))
+			collectibles.push_back(&triggerData.genericRegions[i]);
+	}
+
+	// Rows are built in parallel, then written in savegame order
+	std::vector<std::string> rows(saves.size());
+	pool.parallelFor(saves.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			Save& save = saves[i];
+			CollectedSet collected;
+			if (save.result != 0 || (save.result = readSavegame(save, collected)) != 0)
+				continue;
+
+			std::string cells;
+			cells.reserve(collectibles.size() * 2);
+			size_t collectedCount = 0;
+			for (const GenericRegion* region : collectibles)
+			{
+				bool isCollected = Converter::isCollected(*region, collected);
+				collectedCount += isCollected;
+				cells += isCollected ? ",1" : ",0";
+			}
+			rows[i] = csvField(save.name.toStdString()) + "," + std::to_string(collectedCount) + ","
+				+ std::to_string(collectibles.size() - collectedCount) + cells + "\n";
+		}
+	});
+
+	QFile outFile(outFileName);
+	if (!outFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		std::cerr << "Failed to open output file";
+		return 6;
+	}
+
+	std::string header = "savegame,collected,remaining";
+	for (const GenericRegion* region : collectibles)
+		header += "," + std::to_string(region->id);
+	header += "\n";
+	bool written = outFile.write(header.data(), header.size()) == (qint64)header.size();
+	for (size_t i = 0; i < saves.size() && written; ++i)
+	{
+		if (saves[i].result == 0)
+			written = outFile.write(rows[i].data(), rows[i].size()) == (qint64)rows[i].size();
+	}
+	if (!written)
+	{
+		std::cerr << "Failed to write output file";
+		return 6;
+	}
+
+	return 0;
+}
+
+// Lists the savegames that failed, then how many were evaluated
+void SavegameEvaluator::report()
+{
+	size_t failed = 0;
+	for (const Save& save : saves)
+	{
+		if (save.result == 0)
+			continue;
+		std::cerr << save.name.toStdString() << ": " << save.error << "\n";
+		failed++;
+	}
+	std::cout << "Evaluated " << saves.size() - failed << " of " << saves.size() << " savegames";
+
+	if (failed > 0)
+		result = 7;
+}
@@ -0,0 +1,173 @@
+#include <structural-metadata.h>
+
+using namespace tinygltf;
+
+namespace
+{
+	// Property table buffer views must be aligned to 8 bytes
+	const size_t valueAlignment = 8;
+
+	int addBufferView(GltfStreamWriter& writer, const void* data, size_t length)
+	{
+		// Buffer views may not be empty, which arrays of a table can be
+		const uint8_t zero = 0;
+		if (length == 0)
+		{
+			data = &zero;
+			length = 1;
+		}
+
+		BufferView view;
+		view.buffer = 0;
+		view.byteOffset = writer.addBufferData(data, length, valueAlignment);
+		view.byteLength = length;
+		return writer.addBufferView(view);
+	}
+}
+
+// Starts a feature of a class, creating its property table on first use.
+// Its properties are then set with add() and addArray()
+void StructuralMetadata::beginFeature(const char* classId, const char* name)
+{
+	// Features of a class usually follow each other
+	if (currentTable < 0 || tables[currentTable].classId != classId)
+	{
+		currentTable = -1;
+		for (size_t i = 0; i < tables.size(); ++i)
+		{
+			if (tables[i].classId == classId)
+				currentTable = (int)i;
+		}
+		if (currentTable < 0)
+		{
+			PropertyTable table;
+			table.classId = classId;
+			table.name = name;
+			tables.push_back(table);
+			currentTable = (int)tables.size() - 1;
+		}
+	}
+
+	tables[currentTable].count++;
+	currentProperty = 0;
+}
+
+StructuralMetadata::Property& StructuralMetadata::nextProperty(const char* id, const char* name, const char* componentType, bool isArray)
+{
+	// The first feature of a class defines its properties
+	PropertyTable& table = tables[currentTable];
+	if (currentProperty == table.properties.size())
+	{
+		Property property;
+		property.id = id;
+		property.name = name;
+		property.componentType = componentType;
+		property.isArray = isArray;
+		table.properties.push_back(property);
+	}
+	return table.properties[currentProperty++];
+}
+
+// Appends the property tables to the buffer and adds the extension to the asset
+void StructuralMetadata::write(GltfStreamWriter& writer)
+{
+	if (tables.empty())
+		return;
+
+	// Buffer views of each property's values and array offsets
+	std::vector<std::vector<std::pair<int, int>>> views;
+	for (const PropertyTable& table : tables)
+	{
+		views.emplace_back();
+		for (const Property& property : table.properties)
+		{
+			int values = addBufferView(writer, property.values.data(), property.values.size());
+			int arrayOffsets = -1;
+			if (property.isArray)
+				arrayOffsets = addBufferView(writer, property.arrayOffsets.data(), property.arrayOffsets.size() * sizeof(uint32_t));
+			views.back().push_back({ values, arrayOffsets });
+		}
+	}
+
+	writer.addExtension("EXT_structural_metadata", [&](JsonWriter& json)
+	{
+		json.beginObject();
+		json.key("schema");
+		json.beginObject();
+		json.key("id");
+		json.value("TriggerData");
+		json.key("classes");
+		json.beginObject();
+		for (const PropertyTable& table : tables)
+		{
+			json.key(table.classId);
+			json.beginObject();
+			json.key("name");
+			json.value(table.name);
+			json.key("properties");
+			json.beginObject();
+			for (const Property& property : table.properties)
+			{
+				json.key(property.id);
+				json.beginObject();
+				json.key("name");
+				json.value(property.name);
+				if (property.componentType == nullptr)
+				{
+					json.key("type");
+					json.value("BOOLEAN");
+				}
+				else
+				{
+					json.key("type");
+					json.value("SCALAR");
+					json.key("componentType");
+					json.value(property.componentType);
+				}
+				if (property.isArray)
+				{
+					json.key("array");
+					json.value(true);
+				}
+				json.endObject();
+			}
+			json.endObject();
+			json.endObject();
+		}
+		json.endObject();
+		json.endObject();
+
+		json.key("propertyTables");
+		json.beginArray();
+		for (size_t i = 0; i < tables.size(); ++i)
+		{
+			json.beginObject();
+			json.key("name");
+			json.value(tables[i].name);
+			json.key("class");
+			json.value(tables[i].classId);
+			json.key("count");
+			json.value(tables[i].count);
+			json.key("properties");
+			json.beginObject();
+			for (size_t j = 0; j < tables[i].properties.size(); ++j)
+			{
+				json.key(tables[i].properties[j].id);
+				json.beginObject();
+				json.key("values");
+				json.value(views[i][j].first);
+				if (views[i][j].second >= 0)
+				{
+					json.key("arrayOffsets");
+					json.value(views[i][j].second);
+				}
+				json.endObject();
+			}
+			json.endObject();
+			json.endObject();
+		}
+		json.endArray();
+		json.endObject();
+	});
+	writer.addExtensionUsed("EXT_structural_metadata");
+}
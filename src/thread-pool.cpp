@@ -0,0 +1,162 @@
+#include <thread-pool.h>
+
+#include <algorithm>
+
+namespace
+{
+	// The pool and queue index of the worker running on this thread
+	thread_local ThreadPool* currentPool = nullptr;
+	thread_local int currentIndex = -1;
+}
+
+ThreadPool::ThreadPool(int threadCount)
+{
+	if (threadCount <= 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	for (int i = 0; i < threadCount; ++i)
+		queues.push_back(std::make_unique<Queue>());
+	for (int i = 0; i < threadCount; ++i)
+		threads.emplace_back(&ThreadPool::work, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	taskQueued.notify_all();
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+// Queues a task. Tasks submitted from a worker go to that worker's queue
+void ThreadPool::submit(std::function<void()> task)
+{
+	{
+		// Queued under the pool lock so a worker cannot miss the wakeup
+		std::lock_guard<std::mutex> lock(mutex);
+		size_t index = currentPool == this ? currentIndex : nextQueue++ % queues.size();
+		pending++;
+
+		std::lock_guard<std::mutex> queueLock(queues[index]->mutex);
+		queues[index]->tasks.push_back(std::move(task));
+		queued++;
+	}
+	taskQueued.notify_one();
+}
+
+// Blocks until every submitted task has finished
+void ThreadPool::wait()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	tasksDone.wait(lock, [this] { return pending == 0; });
+}
+
+// Runs body(begin, end) over [0, count) in ranges of up to grain items and
+// waits for them. The calling thread takes part, so this may also be called
+// from a task without waiting on itself
+void ThreadPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body)
+{
+	if (count == 0)
+		return;
+	grain = std::max<size_t>(grain, 1);
+
+	// Shared with the helper tasks, which may only start after the call returns
+	struct State
+	{
+		std::function<void(size_t, size_t)> body;
+		size_t count = 0;
+		size_t grain = 0;
+		size_t ranges = 0;
+		std::atomic<size_t> next = 0;
+		std::atomic<size_t> done = 0;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+	auto state = std::make_shared<State>();
+	state->body = body;
+	state->count = count;
+	state->grain = grain;
+	state->ranges = (count + grain - 1) / grain;
+
+	auto run = [state]()
+	{
+		size_t range;
+		while ((range = state->next++) < state->ranges)
+		{
+			size_t begin = range * state->grain;
+			state->body(begin, std::min(begin + state->grain, state->count));
+			if (++state->done == state->ranges)
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->finished.notify_all();
+			}
+		}
+	};
+
+	size_t helpers = std::min(threads.size(), state->ranges) - 1;
+	for (size_t i = 0; i < helpers; ++i)
+		submit(run);
+	run();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished.wait(lock, [&state] { return state->done == state->ranges; });
+}
+
+void ThreadPool::work(int index)
+{
+	currentPool = this;
+	currentIndex = index;
+
+	std::function<void()> task;
+	while (true)
+	{
+		if (pop(index, task))
+		{
+			task();
+			task = nullptr;
+
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--pending == 0)
+				tasksDone.notify_all();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		taskQueued.wait(lock, [this] { return stopping || queued > 0; });
+		if (stopping && queued == 0)
+			return;
+	}
+}
+
+// Takes the newest task of the worker's own queue, or else the oldest task of another
+bool ThreadPool::pop(int index, std::function<void()>& task)
+{
+	if (queued == 0)
+		return false;
+
+	for (size_t i = 0; i < queues.size(); ++i)
+	{
+		Queue& queue = *queues[(index + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty())
+			continue;
+
+		if (i == 0)
+		{
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+		else
+		{
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+		queued--;
+		return true;
+	}
+
+	return false;
+}
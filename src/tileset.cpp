@@ -0,0 +1,234 @@
+#include <tileset.h>
+
+#include <QFile>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+
+namespace
+{
+	// Depth quadtree tiles are no longer split at, for triggers sharing a position
+	const size_t maxQuadtreeDepth = 16;
+}
+
+// Splits items into square tiles of a size
+void Tileset::buildGrid(const std::vector<Item>& items, float size)
+{
+	tiles.clear();
+	nodes.clear();
+	nodes.emplace_back();
+
+	// Cells are ordered by their coordinates, so tiles are too
+	std::map<std::pair<int64_t, int64_t>, std::vector<int>> cells;
+	for (int i = 0; i < (int)items.size(); ++i)
+	{
+		int64_t x = (int64_t)std::floor(items[i].position[0] / size);
+		int64_t z = (int64_t)std::floor(items[i].position[2] / size);
+		cells[{ x, z }].push_back(i);
+	}
+
+	for (const auto& [cell, indices] : cells)
+	{
+		std::string name = "tile_" + std::to_string(cell.first) + "_" + std::to_string(cell.second);
+		addChild(0, addTile(items, name, indices));
+	}
+}
+
+// Splits items into quadtree tiles of at most capacity triggers.
+// Tiles may hold more when a single item or position does
+void Tileset::buildQuadtree(const std::vector<Item>& items, int capacity)
+{
+	tiles.clear();
+	nodes.clear();
+	if (items.empty())
+	{
+		nodes.emplace_back();
+		return;
+	}
+
+	// The root is the smallest square holding every position
+	float min[2] = { INFINITY, INFINITY };
+	float max[2] = { -INFINITY, -INFINITY };
+	std::vector<int> indices(items.size());
+	for (int i = 0; i < (int)items.size(); ++i)
+	{
+		min[0] = std::min(min[0], items[i].position[0]);
+		min[1] = std::min(min[1], items[i].position[2]);
+		max[0] = std::max(max[0], items[i].position[0]);
+		max[1] = std::max(max[1], items[i].position[2]);
+		indices[i] = i;
+	}
+	Square root = { min[0], min[1], std::max(max[0] - min[0], max[1] - min[1]) };
+	addQuadtreeNode(items, indices, root, "", capacity);
+}
+
+// Adds a tile of items and its leaf node. Returns the index of the node
+int Tileset::addTile(const std::vector<Item>& items, const std::string& name, const std::vector<int>& indices)
+{
+	Tile tile;
+	tile.name = name;
+	tile.items = indices;
+
+	Node node;
+	node.tile = (int)tiles.size();
+	for (int i : indices)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			node.min[axis] = std::min(node.min[axis], items[i].min[axis]);
+			node.max[axis] = std::max(node.max[axis], items[i].max[axis]);
+		}
+		tile.count += items[i].count;
+	}
+	node.count = tile.count;
+
+	tiles.push_back(std::move(tile));
+	nodes.push_back(std::move(node));
+	return (int)nodes.size() - 1;
+}
+
+// Adds the quadtree node of a square, splitting it while it holds too many triggers.
+// Child squares are numbered by their X half, plus two for their Z half, and
+// tiles are named by the numbers of the squares leading to them.
+// Returns the index of the node
+int Tileset::addQuadtreeNode(const std::vector<Item>& items, std::vector<int>& indices, Square square,
+	const std::string& path, int capacity)
+{
+	int count = 0;
+	for (int i : indices)
+		count += items[i].count;
+	if (count <= capacity || indices.size() == 1 || path.size() >= maxQuadtreeDepth)
+		return addTile(items, path.empty() ? "tile" : "tile_" + path, indices);
+
+	int node = (int)nodes.size();
+	nodes.emplace_back();
+
+	float half = square.size * 0.5f;
+	std::vector<int> quadrants[4];
+	for (int i : indices)
+	{
+		int quadrant = (items[i].position[0] >= square.x + half ? 1 : 0)
+			+ (items[i].position[2] >= square.z + half ? 2 : 0);
+		quadrants[quadrant].push_back(i);
+	}
+	std::vector<int>().swap(indices);
+
+	for (int quadrant = 0; quadrant < 4; ++quadrant)
+	{
+		if (quadrants[quadrant].empty())
+			continue;
+		Square child = { square.x + (quadrant & 1) * half, square.z + (quadrant >> 1) * half, half };
+		addChild(node, addQuadtreeNode(items, quadrants[quadrant], child, path + (char)('0' + quadrant), capacity));
+	}
+
+	return node;
+}
+
+// Adds a child to a node, growing its bounds to cover the child
+void Tileset::addChild(int node, int child)
+{
+	Node& parent = nodes[node];
+	parent.children.push_back(child);
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		parent.min[axis] = std::min(parent.min[axis], nodes[child].min[axis]);
+		parent.max[axis] = std::max(parent.max[axis], nodes[child].max[axis]);
+	}
+	parent.count += nodes[child].count;
+}
+
+// Writes the index, where each tile is stored in its name plus extension.
+// Returns false if writing failed
+bool Tileset::write(const QString& fileName, const std::string& extension) const
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+
+	JsonWriter json(&file, true);
+	json.beginObject();
+	json.key("asset");
+	json.beginObject();
+	json.key("version");
+	json.value("1.1");
+	json.endObject();
+	json.key("geometricError");
+	json.value(getSize(nodes[0]));
+	json.key("root");
+	writeNode(json, 0, extension);
+	json.endObject();
+	return json.flush();
+}
+
+// Get the diagonal of the bounds of a node.
+// Viewers refine nodes whose error would be too large on screen, and only leaves
+// have content, so inner nodes use their size as their error
+double Tileset::getSize(const Node& node)
+{
+	if (node.min[0] > node.max[0])
+		return 0.0;
+	return std::hypot(node.max[0] - node.min[0], node.max[1] - node.min[1], node.max[2] - node.min[2]);
+}
+
+void Tileset::writeNode(JsonWriter& json, int index, const std::string& extension) const
+{
+	const Node& node = nodes[index];
+	bool hasBounds = node.min[0] <= node.max[0];
+
+	// Content is Y up glTF, which tilesets place Z up,
+	// so Y and Z are swapped and the new Y is negated
+	float center[3] = { 0.0f, 0.0f, 0.0f };
+	float half[3] = { 0.0f, 0.0f, 0.0f };
+	for (int axis = 0; axis < 3 && hasBounds; ++axis)
+	{
+		center[axis] = (node.min[axis] + node.max[axis]) * 0.5f;
+		half[axis] = (node.max[axis] - node.min[axis]) * 0.5f;
+	}
+	double box[12] = {
+		center[0], -center[2], center[1],
+		half[0], 0.0, 0.0,
+		0.0, half[2], 0.0,
+		0.0, 0.0, half[1]
+	};
+
+	json.beginObject();
+	json.key("boundingVolume");
+	json.beginObject();
+	json.key("box");
+	json.beginArray();
+	for (double value : box)
+		json.value(value);
+	json.endArray();
+	json.endObject();
+	json.key("geometricError");
+	json.value(node.children.empty() ? 0.0 : getSize(node));
+	if (index == 0)
+	{
+		json.key("refine");
+		json.value("ADD");
+	}
+	if (node.tile >= 0)
+	{
+		json.key("content");
+		json.beginObject();
+		json.key("uri");
+		json.value(tiles[node.tile].name + extension);
+		json.endObject();
+	}
+	json.key("extras");
+	json.beginObject();
+	json.key("triggerCount");
+	json.value(node.count);
+	json.endObject();
+	if (!node.children.empty())
+	{
+		json.key("children");
+		json.beginArray();
+		for (int child : node.children)
+			writeNode(json, child, extension);
+		json.endArray();
+	}
+	json.endObject();
+}
@@ -0,0 +1,390 @@
+#include <trajectory-sweep.h>
+#include <thread-pool.h>
+
+#include <QFile>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	// Trajectories swept before their events are written
+	const size_t chunkSize = 1024;
+
+	// Distance around a segment that candidate boxes are gathered for.
+	// Larger regions are gathered less often but test more boxes per segment
+	const float candidateMargin = 64.0f;
+
+	// Skips spaces and tabs
+	const char* skipBlanks(const char* begin, const char* end)
+	{
+		while (begin < end && (*begin == ' ' || *begin == '\t'))
+			begin++;
+		return begin;
+	}
+
+	// Parses a number followed by a comma or the end of the line.
+	// Returns the position after the comma, or null if there is no number
+	template <typename T>
+	const char* parseField(const char* begin, const char* end, T& value)
+	{
+		begin = skipBlanks(begin, end);
+		if (begin < end && *begin == '+')
+			begin++;
+		auto [next, error] = std::from_chars(begin, end, value);
+		if (error != std::errc())
+			return nullptr;
+		next = skipBlanks(next, end);
+		if (next == end)
+			return end;
+		return *next == ',' ? next + 1 : nullptr;
+	}
+
+	// Get the first field of a line, which names its trajectory
+	std::string_view getTrajectoryId(const char* begin, const char* end)
+	{
+		const char* comma = (const char*)memchr(begin, ',', end - begin);
+		return std::string_view(begin, (comma != nullptr ? comma : end) - begin);
+	}
+
+	// Checks whether a line is a header, with text in every field after the trajectory ID.
+	// Lines with any number there are samples, invalid or not
+	bool isHeader(const char* begin, const char* end)
+	{
+		std::string_view id = getTrajectoryId(begin, end);
+		if (begin + id.size() == end)
+			return false;
+
+		for (const char* field = begin + id.size() + 1; ; )
+		{
+			const char* comma = (const char*)memchr(field, ',', end - field);
+			const char* fieldEnd = comma != nullptr ? comma : end;
+			double value;
+			if (skipBlanks(field, fieldEnd) == fieldEnd || parseField(field, fieldEnd, value) != nullptr)
+				return false;
+			if (comma == nullptr)
+				return true;
+			field = comma + 1;
+		}
+	}
+
+	// Finds the end of the line starting at begin, without its line break
+	const char* findLineEnd(const char* begin, const char* end)
+	{
+		const char* lineEnd = (const char*)memchr(begin, '\n', end - begin);
+		return lineEnd != nullptr ? lineEnd : end;
+	}
+}
+
+TrajectorySweep::TrajectorySweep(int argc, char* argv[])
+{
+	result = getArgs(argc, argv);
+	if (result != 0)
+		return;
+
+	result = run();
+}
+
+int TrajectorySweep::getArgs(int argc, char* argv[])
+{
+	// Ensure minimum argument count is reached
+	if (argc < minArgCount)
+	{
+		showUsage();
+		return 1;
+	}
+
+	QStringList args;
+	for (int i = 2; i < argc - 3; ++i)
+	{
+		// Set worker thread count
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc - 3)
+		{
+			threadCount = atoi(argv[i + 1]);
+			i++;
+		}
+		else
+			args.append(QString::fromLocal8Bit(argv[i]));
+	}
+	int parseResult = options.parse(args, std::cerr);
+	if (parseResult != 0)
+		return parseResult;
+
+	inFileName = QString::fromLocal8Bit(argv[argc - 3]);
+	trajectoriesFileName = QString::fromLocal8Bit(argv[argc - 2]);
+	outFileName = QString::fromLocal8Bit(argv[argc - 1]);
+
+	// Check inputs exist
+	if (!QFileInfo(inFileName).isFile() || !QFileInfo(trajectoriesFileName).isFile())
+	{
+		std::cerr << "Invalid input or trajectories file";
+		return 2;
+	}
+
+	// Check output does not exist as a non-file
+	QFileInfo outputInfo(outFileName);
+	if (outputInfo.exists() && !outputInfo.isFile())
+	{
+		std::cerr << "Output location exists and is not a file, cannot overwrite";
+		return 3;
+	}
+
+	return 0;
+}
+
+void TrajectorySweep::showUsage()
+{
+	std::cout << "Usage: TriggersToGLTF --sweep [options] <input triggers> <trajectories CSV> <output CSV>\n\n"
+		<< "Lists where each trajectory enters and exits box triggers as\n"
+		<< "trajectory,time,event,id,type CSV lines, where event is enter or exit.\n"
+		<< "Trajectories are trajectory,time,x,y,z CSV lines with an optional header.\n"
+		<< "The lines of a trajectory must be consecutive and in time order.\n"
+		<< "Times between samples are interpolated.\n\n"
+		<< "Options:\n"
+		<< " -p   File platform. PS3, X360, PC, PS4, or NX. Default: PC\n"
+		<< " -j   Number of worker threads. Default: one per hardware thread";
+}
+
+int TrajectorySweep::run()
+{
+	TriggerData triggerData;
+	int readResult = readTriggerResource(inFileName, options.platform, triggerData, std::cerr);
+	if (readResult != 0)
+		return readResult;
+
+	TriggerIndex index;
+	index.build(triggerData);
+	bvh.build(triggerData, index);
+
+	if (!trajectoriesFile.open(trajectoriesFileName))
+	{
+		std::cerr << "Failed to map trajectories file";
+		return 5;
+	}
+
+	QFile outFile(outFileName);
+	if (!outFile.open(QIODevice::WriteOnly | QIODevice::Truncate) || outFile.write("trajectory,time,event,id,type\n") < 0)
+	{
+		std::cerr << "Failed to open output file";
+		return 6;
+	}
+
+	// Trajectories are swept in parallel a chunk at a time, then written in order
+	std::vector<Trajectory> trajectories = splitTrajectories();
+	ThreadPool pool(threadCount);
+	uint64_t eventCount = 0;
+	for (size_t chunk = 0; chunk < trajectories.size(); chunk += chunkSize)
+	{
+		size_t count = std::min(chunkSize, trajectories.size() - chunk);
+		pool.parallelFor(count, 1, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+				sweep(trajectories[chunk + i]);
+		});
+
+		for (size_t i = chunk; i < chunk + count; ++i)
+		{
+			Trajectory& trajectory = trajectories[i];
+			if (!trajectory.error.empty())
+			{
+				std::cerr << trajectory.error;
+				return 5;
+			}
+			if (outFile.write(trajectory.events.data(), trajectory.events.size()) != (qint64)trajectory.events.size())
+			{
+				std::cerr << "Failed to write output file";
+				return 6;
+			}
+			eventCount += std::count(trajectory.events.begin(), trajectory.events.end(), '\n');
+			std::string().swap(trajectory.events);
+		}
+	}
+	trajectoriesFile.close();
+	outFile.close();
+
+	std::cout << "Swept " << trajectories.size() << " trajectories through " << bvh.size() << " triggers, "
+		<< eventCount << " events";
+	return 0;
+}
+
+// Splits the input into runs of lines with the same trajectory
+std::vector<TrajectorySweep::Trajectory> TrajectorySweep::splitTrajectories()
+{
+	std::vector<Trajectory> trajectories;
+	const char* data = (const char*)trajectoriesFile.data();
+	const char* dataEnd = data + trajectoriesFile.size();
+	std::string_view currentId;
+	int64_t lineNumber = 0;
+	for (const char* line = data; line < dataEnd; )
+	{
+		const char* lineEnd = findLineEnd(line, dataEnd);
+		const char* next = lineEnd + (lineEnd < dataEnd);
+		lineNumber++;
+
+		const char* contentEnd = lineEnd > line && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd;
+		std::string_view id = getTrajectoryId(line, contentEnd);
+
+		// The first line may be a header, and is otherwise checked as a sample
+		if (lineNumber == 1 && isHeader(line, contentEnd))
+		{
+			line = next;
+			continue;
+		}
+
+		// Blank lines belong to the trajectory before them
+		if (skipBlanks(line, contentEnd) != contentEnd && (trajectories.empty() || id != currentId))
+		{
+			Trajectory trajectory;
+			trajectory.begin = line - data;
+			trajectory.end = line - data;
+			trajectory.firstLine = lineNumber;
+			trajectories.push_back(trajectory);
+			currentId = id;
+		}
+		if (!trajectories.empty())
+			trajectories.back().end = next - data;
+		line = next;
+	}
+
+	return trajectories;
+}
+
+// Finds the events of a trajectory
+void TrajectorySweep::sweep(Trajectory& trajectory)
+{
+	const char* data = (const char*)trajectoriesFile.data();
+	const char* dataEnd = data + trajectory.end;
+	int64_t lineNumber = trajectory.firstLine - 1;
+
+	Candidates candidates;
+	std::vector<int32_t> inside; // Boxes containing the last sample
+	std::vector<int32_t> stillInside;
+	std::vector<Event> events;
+	float previous[3] = { 0.0f, 0.0f, 0.0f };
+	double previousTime = 0.0;
+	bool first = true;
+	for (const char* line = data + trajectory.begin; line < dataEnd; )
+	{
+		const char* lineEnd = findLineEnd(line, dataEnd);
+		const char* next = lineEnd + (lineEnd < dataEnd);
+		lineNumber++;
+		if (lineEnd > line && lineEnd[-1] == '\r')
+			lineEnd--;
+		if (skipBlanks(line, lineEnd) == lineEnd)
+		{
+			line = next;
+			continue;
+		}
+
+		// Sample
+		std::string_view id = getTrajectoryId(line, lineEnd);
+		const char* field = line + std::min<size_t>(id.size() + 1, lineEnd - line);
+		double time = 0.0;
+		float point[3];
+		if ((field = parseField(field, lineEnd, time)) == nullptr
+			|| (field = parseField(field, lineEnd, point[0])) == nullptr
+			|| (field = parseField(field, lineEnd, point[1])) == nullptr
+			|| parseField(field, lineEnd, point[2]) == nullptr)
+		{
+			trajectory.error = "Invalid sample on line " + std::to_string(lineNumber) + " of the trajectories file";
+			return;
+		}
+		if (!first && time < previousTime)
+		{
+			trajectory.error = "Samples are out of time order on line " + std::to_string(lineNumber) + " of the trajectories file";
+			return;
+		}
+		line = next;
+
+		// The trajectory starts in every box containing its first sample
+		if (first)
+		{
+			gatherCandidates(point, point, candidates);
+			for (int32_t box : candidates.boxes)
+			{
+				float enter, exit;
+				if (bvh.clipSegment(box, point, point, enter, exit))
+				{
+					inside.push_back(box);
+					addEvent(trajectory, id, time, true, box);
+				}
+			}
+			std::copy(point, point + 3, previous);
+			previousTime = time;
+			first = false;
+			continue;
+		}
+
+		// Candidates are kept while segments stay in the region they were gathered for
+		bool covered = true;
+		for (int axis = 0; axis < 3; ++axis)
+			covered = covered && point[axis] >= candidates.min[axis] && point[axis] <= candidates.max[axis];
+		if (!covered)
+			gatherCandidates(previous, point, candidates);
+
+		// Boxes containing the last sample are candidates too, as candidates cover it
+		events.clear();
+		stillInside.clear();
+		for (int32_t box : candidates.boxes)
+		{
+			bool wasInside = std::find(inside.begin(), inside.end(), box) != inside.end();
+			float enter, exit;
+			bool crossed = bvh.clipSegment(box, previous, point, enter, exit);
+			if (wasInside)
+			{
+				if (!crossed)
+					events.push_back({ 0.0f, false, box });
+				else if (exit < 1.0f)
+					events.push_back({ exit, false, box });
+				else
+					stillInside.push_back(box);
+			}
+			else if (crossed)
+			{
+				events.push_back({ enter, true, box });
+				if (exit < 1.0f)
+					events.push_back({ exit, false, box });
+				else
+					stillInside.push_back(box);
+			}
+		}
+		inside.swap(stillInside);
+
+		std::stable_sort(events.begin(), events.end(),
+			[](const Event& a, const Event& b) { return a.fraction < b.fraction; });
+		for (const Event& event : events)
+			addEvent(trajectory, id, previousTime + (time - previousTime) * event.fraction, event.enter, event.box);
+
+		std::copy(point, point + 3, previous);
+		previousTime = time;
+	}
+}
+
+// Gathers the boxes near a segment
+void TrajectorySweep::gatherCandidates(const float* start, const float* end, Candidates& candidates)
+{
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		candidates.min[axis] = std::min(start[axis], end[axis]) - candidateMargin;
+		candidates.max[axis] = std::max(start[axis], end[axis]) + candidateMargin;
+	}
+	candidates.boxes.clear();
+	bvh.findCandidates(candidates.min, candidates.max, candidates.boxes);
+}
+
+// Appends an event as a CSV line
+void TrajectorySweep::addEvent(Trajectory& trajectory, std::string_view id, double time, bool enter, int32_t box)
+{
+	char number[32];
+	trajectory.events += id;
+	trajectory.events += ',';
+	trajectory.events.append(number, std::to_chars(number, number + sizeof(number), time).ptr);
+	trajectory.events += enter ? ",enter," : ",exit,";
+	trajectory.events.append(number, std::to_chars(number, number + sizeof(number), bvh.getId(box)).ptr);
+	trajectory.events += ',';
+	trajectory.events += getTriggerRegionTypeName(bvh.getType(box));
+	trajectory.events += '\n';
+}
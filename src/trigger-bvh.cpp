@@ -0,0 +1,359 @@
+#include <trigger-bvh.h>
+#include <cpu-features.h>
+#include <oriented-box.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace BrnTrigger;
+
+namespace
+{
+	// Tests a point against the boxes of a packet given as its first column.
+	// Returns a mask with a bit set for each box containing the point
+	int containsScalar(const float* point, const float* centerX, const float* centerY, const float* centerZ,
+		const float (*rotation)[TriggerBvh::packetSize], const float* halfX, const float* halfY, const float* halfZ)
+	{
+		int mask = 0;
+		for (int i = 0; i < TriggerBvh::packetSize; ++i)
+		{
+			float dx = point[0] - centerX[i];
+			float dy = point[1] - centerY[i];
+			float dz = point[2] - centerZ[i];
+			float x = rotation[0][i] * dx + rotation[1][i] * dy + rotation[2][i] * dz;
+			float y = rotation[3][i] * dx + rotation[4][i] * dy + rotation[5][i] * dz;
+			float z = rotation[6][i] * dx + rotation[7][i] * dy + rotation[8][i] * dz;
+			if (std::fabs(x) <= halfX[i] && std::fabs(y) <= halfY[i] && std::fabs(z) <= halfZ[i])
+				mask |= 1 << i;
+		}
+		return mask;
+	}
+
+#ifdef CPU_X86
+	// Tests four boxes like containsScalar. Multiplies and adds in the same order,
+	// so every kernel gives the same result for points on a face
+	TARGET_SSE2 int containsSse2(const float* point, const float* centerX, const float* centerY, const float* centerZ,
+		const float (*rotation)[TriggerBvh::packetSize], const float* halfX, const float* halfY, const float* halfZ, int offset)
+	{
+		const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+		__m128 dx = _mm_sub_ps(_mm_set1_ps(point[0]), _mm_load_ps(centerX + offset));
+		__m128 dy = _mm_sub_ps(_mm_set1_ps(point[1]), _mm_load_ps(centerY + offset));
+		__m128 dz = _mm_sub_ps(_mm_set1_ps(point[2]), _mm_load_ps(centerZ + offset));
+		__m128 outside = _mm_setzero_ps();
+		const float* halves[3] = { halfX, halfY, halfZ };
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			__m128 local = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(_mm_load_ps(rotation[axis * 3] + offset), dx),
+				_mm_mul_ps(_mm_load_ps(rotation[axis * 3 + 1] + offset), dy)),
+				_mm_mul_ps(_mm_load_ps(rotation[axis * 3 + 2] + offset), dz));
+			outside = _mm_or_ps(outside,
+				_mm_cmpnle_ps(_mm_and_ps(local, absMask), _mm_load_ps(halves[axis] + offset)));
+		}
+		return ~_mm_movemask_ps(outside) & 0xF;
+	}
+
+	TARGET_SSE2 int containsSse2(const float* point, const float* centerX, const float* centerY, const float* centerZ,
+		const float (*rotation)[TriggerBvh::packetSize], const float* halfX, const float* halfY, const float* halfZ)
+	{
+		return containsSse2(point, centerX, centerY, centerZ, rotation, halfX, halfY, halfZ, 0)
+			| containsSse2(point, centerX, centerY, centerZ, rotation, halfX, halfY, halfZ, 4) << 4;
+	}
+
+	// Tests eight boxes like containsSse2
+	TARGET_AVX2 int containsAvx2(const float* point, const float* centerX, const float* centerY, const float* centerZ,
+		const float (*rotation)[TriggerBvh::packetSize], const float* halfX, const float* halfY, const float* halfZ)
+	{
+		const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+		__m256 dx = _mm256_sub_ps(_mm256_set1_ps(point[0]), _mm256_load_ps(centerX));
+		__m256 dy = _mm256_sub_ps(_mm256_set1_ps(point[1]), _mm256_load_ps(centerY));
+		__m256 dz = _mm256_sub_ps(_mm256_set1_ps(point[2]), _mm256_load_ps(centerZ));
+		__m256 outside = _mm256_setzero_ps();
+		const float* halves[3] = { halfX, halfY, halfZ };
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			__m256 local = _mm256_add_ps(_mm256_add_ps(
+				_mm256_mul_ps(_mm256_load_ps(rotation[axis * 3]), dx),
+				_mm256_mul_ps(_mm256_load_ps(rotation[axis * 3 + 1]), dy)),
+				_mm256_mul_ps(_mm256_load_ps(rotation[axis * 3 + 2]), dz));
+			outside = _mm256_or_ps(outside,
+				_mm256_cmp_ps(_mm256_and_ps(local, absMask), _mm256_load_ps(halves[axis]), _CMP_NLE_UQ));
+		}
+		return ~_mm256_movemask_ps(outside) & 0xFF;
+	}
+
+	enum class Kernel
+	{
+		scalar,
+		sse2,
+		avx2
+	};
+
+	Kernel detectKernel()
+	{
+		const CpuFeatures& features = getCpuFeatures();
+		if (features.avx2)
+			return Kernel::avx2;
+		if (features.sse2)
+			return Kernel::sse2;
+		return Kernel::scalar;
+	}
+#endif
+}
+
+// Builds the hierarchy from the boxes of getOrientedBoxes()
+void TriggerBvh::build(TriggerData& data, const TriggerIndex& index)
+{
+	nodes.clear();
+	packets.clear();
+
+	std::vector<OrientedBox> boxes = getOrientedBoxes(data, index);
+	boxCount = (int32_t)boxes.size();
+	if (!boxes.empty())
+		buildNode(boxes, 0, boxes.size());
+}
+
+// Builds the subtree of a range of boxes, splitting at the median centroid
+// of the longest axis. Returns the index of its root
+int32_t TriggerBvh::buildNode(std::vector<OrientedBox>& boxes, size_t begin, size_t end)
+{
+	int32_t nodeIndex = (int32_t)nodes.size();
+	nodes.emplace_back();
+
+	float min[3] = { INFINITY, INFINITY, INFINITY };
+	float max[3] = { -INFINITY, -INFINITY, -INFINITY };
+	float centroidMin[3] = { INFINITY, INFINITY, INFINITY };
+	float centroidMax[3] = { -INFINITY, -INFINITY, -INFINITY };
+	for (size_t i = begin; i < end; ++i)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			min[axis] = std::min(min[axis], boxes[i].min[axis]);
+			max[axis] = std::max(max[axis], boxes[i].max[axis]);
+			centroidMin[axis] = std::min(centroidMin[axis], boxes[i].center[axis]);
+			centroidMax[axis] = std::max(centroidMax[axis], boxes[i].center[axis]);
+		}
+	}
+	std::copy(min, min + 3, nodes[nodeIndex].min);
+	std::copy(max, max + 3, nodes[nodeIndex].max);
+
+	if (end - begin <= packetSize)
+	{
+		nodes[nodeIndex].packet = (int32_t)packets.size();
+		addPacket(&boxes[begin], end - begin);
+		return nodeIndex;
+	}
+
+	int axis = 0;
+	for (int i = 1; i < 3; ++i)
+	{
+		if (centroidMax[i] - centroidMin[i] > centroidMax[axis] - centroidMin[axis])
+			axis = i;
+	}
+	size_t middle = begin + (end - begin) / 2;
+	std::nth_element(boxes.begin() + begin, boxes.begin() + middle, boxes.begin() + end,
+		[axis](const OrientedBox& a, const OrientedBox& b) { return a.center[axis] < b.center[axis]; });
+
+	buildNode(boxes, begin, middle);
+	int32_t secondChild = buildNode(boxes, middle, end);
+	nodes[nodeIndex].secondChild = secondChild;
+	return nodeIndex;
+}
+
+// Stores up to packetSize boxes as a packet
+void TriggerBvh::addPacket(const OrientedBox* boxes, size_t count)
+{
+	Packet& packet = packets.emplace_back();
+	for (size_t i = 0; i < packetSize; ++i)
+	{
+		if (i >= count)
+		{
+			packet.centerX[i] = packet.centerY[i] = packet.centerZ[i] = 0.0f;
+			for (int j = 0; j < 9; ++j)
+				packet.inverseRotation[j][i] = 0.0f;
+			packet.halfX[i] = packet.halfY[i] = packet.halfZ[i] = -1.0f;
+			packet.ids[i] = 0;
+			packet.types[i] = (TriggerRegion::Type)0;
+			continue;
+		}
+
+		const OrientedBox& box = boxes[i];
+
+		// The inverse of a rotation is its transpose
+		for (int row = 0; row < 3; ++row)
+		{
+			for (int column = 0; column < 3; ++column)
+				packet.inverseRotation[row * 3 + column][i] = box.rotation[column * 3 + row];
+		}
+		packet.centerX[i] = box.center[0];
+		packet.centerY[i] = box.center[1];
+		packet.centerZ[i] = box.center[2];
+		packet.halfX[i] = box.half[0];
+		packet.halfY[i] = box.half[1];
+		packet.halfZ[i] = box.half[2];
+		packet.ids[i] = box.id;
+		packet.types[i] = box.type;
+	}
+}
+
+// Appends the triggers containing a point
+void TriggerBvh::query(const float* point, uint64_t pointIndex, std::vector<Hit>& hits) const
+{
+	if (nodes.empty())
+		return;
+
+#ifdef CPU_X86
+	static const Kernel kernel = detectKernel();
+#endif
+
+	// Balanced, so the depth is about log2 of the packet count
+	int32_t stack[64];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		const Node& node = nodes[stack[--stackSize]];
+		if (point[0] < node.min[0] || point[0] > node.max[0]
+			|| point[1] < node.min[1] || point[1] > node.max[1]
+			|| point[2] < node.min[2] || point[2] > node.max[2])
+			continue;
+
+		if (node.packet < 0)
+		{
+			// First child is visited first
+			stack[stackSize++] = node.secondChild;
+			stack[stackSize++] = (int32_t)(&node - nodes.data()) + 1;
+			continue;
+		}
+
+		const Packet& packet = packets[node.packet];
+		int mask = 0;
+#ifdef CPU_X86
+		switch (kernel)
+		{
+		case Kernel::avx2:
+			mask = containsAvx2(point, packet.centerX, packet.centerY, packet.centerZ,
+				packet.inverseRotation, packet.halfX, packet.halfY, packet.halfZ);
+			break;
+		case Kernel::sse2:
+			mask = containsSse2(point, packet.centerX, packet.centerY, packet.centerZ,
+				packet.inverseRotation, packet.halfX, packet.halfY, packet.halfZ);
+			break;
+		case Kernel::scalar:
+			mask = containsScalar(point, packet.centerX, packet.centerY, packet.centerZ,
+				packet.inverseRotation, packet.halfX, packet.halfY, packet.halfZ);
+			break;
+		}
+#else
+		mask = containsScalar(point, packet.centerX, packet.centerY, packet.centerZ,
+			packet.inverseRotation, packet.halfX, packet.halfY, packet.halfZ);
+#endif
+		for (int i = 0; i < packetSize; ++i)
+		{
+			if ((mask & (1 << i)) != 0)
+				hits.push_back({ pointIndex, packet.ids[i], packet.types[i] });
+		}
+	}
+}
+
+// Appends the boxes of every leaf whose bounds overlap an axis aligned box.
+// Boxes are given as indices for clipSegment(), getId() and getType()
+void TriggerBvh::findCandidates(const float* min, const float* max, std::vector<int32_t>& boxes) const
+{
+	if (nodes.empty())
+		return;
+
+	int32_t stack[64];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		int32_t nodeIndex = stack[--stackSize];
+		const Node& node = nodes[nodeIndex];
+		if (max[0] < node.min[0] || min[0] > node.max[0]
+			|| max[1] < node.min[1] || min[1] > node.max[1]
+			|| max[2] < node.min[2] || min[2] > node.max[2])
+			continue;
+
+		if (node.packet < 0)
+		{
+			stack[stackSize++] = node.secondChild;
+			stack[stackSize++] = nodeIndex + 1;
+			continue;
+		}
+
+		// Unused slots have negative half dimensions
+		const Packet& packet = packets[node.packet];
+		for (int i = 0; i < packetSize && packet.halfX[i] >= 0.0f; ++i)
+			boxes.push_back(node.packet * packetSize + i);
+	}
+}
+
+// Gets the part of the segment from start to end inside a box, as fractions of
+// its length. Returns false if the segment misses the box
+bool TriggerBvh::clipSegment(int32_t box, const float* start, const float* end, float& enter, float& exit) const
+{
+	const Packet& packet = packets[box / packetSize];
+	int slot = box % packetSize;
+	const float center[3] = { packet.centerX[slot], packet.centerY[slot], packet.centerZ[slot] };
+	const float half[3] = { packet.halfX[slot], packet.halfY[slot], packet.halfZ[slot] };
+	float startDelta[3], endDelta[3];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		startDelta[axis] = start[axis] - center[axis];
+		endDelta[axis] = end[axis] - center[axis];
+	}
+
+	// Clip against each pair of faces in the box's frame
+	enter = 0.0f;
+	exit = 1.0f;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const float* row[3] = { packet.inverseRotation[axis * 3], packet.inverseRotation[axis * 3 + 1], packet.inverseRotation[axis * 3 + 2] };
+		float localStart = row[0][slot] * startDelta[0] + row[1][slot] * startDelta[1] + row[2][slot] * startDelta[2];
+		float localEnd = row[0][slot] * endDelta[0] + row[1][slot] * endDelta[1] + row[2][slot] * endDelta[2];
+		float direction = localEnd - localStart;
+		if (direction == 0.0f)
+		{
+			if (std::fabs(localStart) > half[axis])
+				return false;
+			continue;
+		}
+
+		float first = (-half[axis] - localStart) / direction;
+		float last = (half[axis] - localStart) / direction;
+		if (first > last)
+			std::swap(first, last);
+		enter = std::max(enter, first);
+		exit = std::min(exit, last);
+		if (enter > exit)
+			return false;
+	}
+	return true;
+}
+
+// Appends the triggers containing each of count points, given as x, y, z.
+// Hits are ordered by point, and by position in the hierarchy for each point.
+// Ranges of points are queried in parallel if a pool is given
+void TriggerBvh::query(const float* points, uint64_t firstIndex, size_t count, ThreadPool* pool, std::vector<Hit>& hits) const
+{
+	if (pool == nullptr)
+	{
+		for (size_t i = 0; i < count; ++i)
+			query(points + i * 3, firstIndex + i, hits);
+		return;
+	}
+
+	// Each range gathers its own hits, which are then appended in order
+	const size_t grain = 1024;
+	std::vector<std::vector<Hit>> rangeHits((count + grain - 1) / grain);
+	pool->parallelFor(count, grain, [&](size_t begin, size_t end)
+	{
+		std::vector<Hit>& range = rangeHits[begin / grain];
+		for (size_t i = begin; i < end; ++i)
+			query(points + i * 3, firstIndex + i, range);
+	});
+
+	for (const std::vector<Hit>& range : rangeHits)
+		hits.insert(hits.end(), range.begin(), range.end());
+}
@@ -2,7 +2,8 @@
 
 using namespace BrnTrigger;
 
-void TriggerData::read(DataStream& file)
+template <typename Traits>
+void TriggerData::read(MappedStream<Traits>& file, uint16_t sections)
 {
 	file >> versionNumber;
 	file >> size;
@@ -37,43 +38,160 @@ void TriggerData::read(DataStream& file)
 	file >> regionCount;
 	file.skip(0x4);
 
-	// Allocate and read each trigger chunk
-	file.cAllocAndCustomRead(landmarks, landmarkCount);
-	file.cAllocAndCustomRead(signatureStunts, signatureStuntCount);
-	file.cAllocAndCustomRead(genericRegions, genericRegionCount);
-	file.cAllocAndCustomRead(killzones, killzoneCount);
-	file.cAllocAndCustomRead(blackspots, blackspotCount);
-	file.cAllocAndCustomRead(vfxBoxRegions, vfxBoxRegionCount);
-	file.cAllocAndCustomRead(roamingLocations, roamingLocationCount);
-	file.cAllocAndCustomRead(spawnLocations, spawnLocationCount);
-	file.cAllocAndQtRead(regions, regionCount);
-	for (int i = 0; i < regionCount; ++i)
-		file.cAllocAndCustomRead(regions[i], 1);
+	// Size one arena for everything the sections contain
+	readSections = sections;
+	arena.reserve(arenaSize(file));
+	file.setArena(&arena);
+
+	// Allocate and read the trigger chunks of each section.
+	// Arrays of other sections are cleared, since they still hold offsets
+	if (hasSection(Section::landmarks))
+		file.allocAndCustomRead(landmarks, landmarkCount);
+	else
+		landmarks = nullptr;
+	if (hasSection(Section::signatureStunts))
+		file.allocAndCustomRead(signatureStunts, signatureStuntCount);
+	else
+		signatureStunts = nullptr;
+	if (hasSection(Section::genericRegions))
+		file.allocAndCustomRead(genericRegions, genericRegionCount);
+	else
+		genericRegions = nullptr;
+	if (hasSection(Section::killzones))
+		file.allocAndCustomRead(killzones, killzoneCount);
+	else
+		killzones = nullptr;
+	if (hasSection(Section::blackspots))
+		file.allocAndCustomRead(blackspots, blackspotCount);
+	else
+		blackspots = nullptr;
+	if (hasSection(Section::vfxBoxRegions))
+		file.allocAndCustomRead(vfxBoxRegions, vfxBoxRegionCount);
+	else
+		vfxBoxRegions = nullptr;
+	if (hasSection(Section::roamingLocations))
+		file.allocAndCustomRead(roamingLocations, roamingLocationCount);
+	else
+		roamingLocations = nullptr;
+	if (hasSection(Section::spawnLocations))
+		file.allocAndCustomRead(spawnLocations, spawnLocationCount);
+	else
+		spawnLocations = nullptr;
+	if (hasSection(Section::regions))
+		file.allocAndIndirectRead(regions, regionCount);
+	else
+		regions = nullptr;
+
+	file.setArena(nullptr);
 }
 
-void BoxRegion::read(DataStream& file)
+namespace
 {
-	file >> positionX;
-	file >> positionY;
-	file >> positionZ;
-	file >> rotationX;
-	file >> rotationY;
-	file >> rotationZ;
-	file >> dimensionX;
-	file >> dimensionY;
-	file >> dimensionZ;
+	// Arena space for an array of count entries
+	// Counts that cannot fit in the file are left for the read to reject
+	template <typename T, typename Traits>
+	qint64 arraySize(MappedStream<Traits>& file, qint64 count)
+	{
+		if (count <= 0 || count > file.size())
+			return 0;
+		return Arena::sizeFor<T>(count);
+	}
+
+	// Arena space for the arrays of type T nested in an array of count records.
+	// countOffset is the offset of the nested array's count within each record.
+	template <typename T, typename Count, typename Traits>
+	qint64 nestedArraySize(MappedStream<Traits>& file, void* records, int count, qint64 recordSize, qint64 countOffset)
+	{
+		qint64 size = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			const uchar* data = file.peek((qint64)records + i * recordSize + countOffset, sizeof(Count));
+			if (data == nullptr)
+				break;
+			size += arraySize<T>(file, decode<Traits, Count>(data));
+		}
+		return size;
+	}
 }
 
-void TriggerRegion::read(DataStream& file)
+// Get the arena space needed for everything in the sections being read.
+// Must be called after the header is read, while the array pointers are still offsets.
+template <typename Traits>
+qint64 TriggerData::arenaSize(MappedStream<Traits>& file)
 {
-	boxRegion.read(file);
-	file >> id;
-	file >> regionIndex;
-	file >> type;
-	file >> unk0;
+	qint64 size = 0;
+	if (hasSection(Section::landmarks))
+	{
+		// With their starting grids
+		size += arraySize<Landmark>(file, landmarkCount);
+		size += nestedArraySize<StartingGrid, int8_t>(file, landmarks, landmarkCount, Landmark::recordSize<Traits>,
+			TriggerRegion::recordSize<Traits> + Traits::padIf64(0x4) + Traits::pointerSize);
+	}
+	if (hasSection(Section::signatureStunts))
+	{
+		// With their stunt elements
+		size += arraySize<SignatureStunt>(file, signatureStuntCount);
+		size += nestedArraySize<GenericRegion, int32_t>(file, signatureStunts, signatureStuntCount,
+			SignatureStunt::recordSize<Traits>, 0x10 + Traits::pointerSize);
+	}
+	if (hasSection(Section::genericRegions))
+		size += arraySize<GenericRegion>(file, genericRegionCount);
+	if (hasSection(Section::killzones))
+	{
+		// With their triggers and region IDs
+		size += arraySize<Killzone>(file, killzoneCount);
+		size += nestedArraySize<GenericRegion, int32_t>(file, killzones, killzoneCount,
+			Killzone::recordSize<Traits>, Traits::pointerSize);
+		size += nestedArraySize<CgsID, int32_t>(file, killzones, killzoneCount,
+			Killzone::recordSize<Traits>, Traits::pointerSize * 2 + 0x4 + Traits::padIf64(0x4));
+	}
+	if (hasSection(Section::blackspots))
+		size += arraySize<Blackspot>(file, blackspotCount);
+	if (hasSection(Section::vfxBoxRegions))
+		size += arraySize<VFXBoxRegion>(file, vfxBoxRegionCount);
+	if (hasSection(Section::roamingLocations))
+		size += arraySize<RoamingLocation>(file, roamingLocationCount);
+	if (hasSection(Section::spawnLocations))
+		size += arraySize<SpawnLocation>(file, spawnLocationCount);
+	if (hasSection(Section::regions))
+		size += arraySize<TriggerRegion>(file, regionCount);
+
+	return size;
+}
+
+template <typename Traits>
+void BoxRegion::read(MappedStream<Traits>& file)
+{
+	const uchar* data = file.take(recordSize<Traits>);
+	if (data == nullptr)
+		return;
+	read<Traits>(data);
+}
+
+template <typename Traits>
+void BoxRegion::read(const uchar* data)
+{
+	// All nine fields are floats, stored in the same order as the resource
+	static_assert(sizeof(BoxRegion) == 9 * sizeof(float32_t) && std::is_standard_layout_v<BoxRegion>);
+	decodeFloats<Traits>(data, &positionX, 9);
 }
 
-void Landmark::read(DataStream& file)
+template <typename Traits>
+void TriggerRegion::read(MappedStream<Traits>& file)
+{
+	// Fixed-size record, bounds checked once and decoded in place
+	const uchar* data = file.take(recordSize<Traits>);
+	if (data == nullptr)
+		return;
+	boxRegion.read<Traits>(data);
+	id = decode<Traits, int32_t>(data + 0x24);
+	regionIndex = decode<Traits, int16_t>(data + 0x28);
+	type = decode<Traits, Type>(data + 0x2A);
+	unk0 = decode<Traits, uint8_t>(data + 0x2B);
+}
+
+template <typename Traits>
+void Landmark::read(MappedStream<Traits>& file)
 {
 	TriggerRegion::read(file);
 	file.skipIf64(0x4);
@@ -87,7 +205,7 @@ void Landmark::read(DataStream& file)
 	qint64 nextLandmark = file.pos();
 
 	// Allocate and read starting grids
-	file.cAllocAndCustomRead(startingGrids, startingGridCount);
+	file.allocAndCustomRead(startingGrids, startingGridCount);
 
 	file.seek(nextLandmark);
 }
@@ -101,15 +219,24 @@ StartingGrid::StartingGrid()
 	}
 }
 
-void StartingGrid::read(DataStream& file)
+template <typename Traits>
+void StartingGrid::read(MappedStream<Traits>& file)
 {
+	// 16 padded vectors, decoded as one run of floats
+	const uchar* data = file.take(recordSize<Traits>);
+	if (data == nullptr)
+		return;
+	float values[recordSize<Traits> / sizeof(float)];
+	decodeFloats<Traits>(data, values, recordSize<Traits> / sizeof(float));
 	for (int i = 0; i < 8; ++i)
-		startingPositions[i].read(file);
-	for (int i = 0; i < 8; ++i)
-		startingDirections[i].read(file);
+	{
+		startingPositions[i] = Vector3(values[i * 4], values[i * 4 + 1], values[i * 4 + 2], true);
+		startingDirections[i] = Vector3(values[32 + i * 4], values[32 + i * 4 + 1], values[32 + i * 4 + 2], true);
+	}
 }
 
-void SignatureStunt::read(DataStream& file)
+template <typename Traits>
+void SignatureStunt::read(MappedStream<Traits>& file)
 {
 	file >> id;
 	file >> camera;
@@ -118,15 +245,14 @@ void SignatureStunt::read(DataStream& file)
 	file.skipIf64(0x4);
 	qint64 nextSignatureStunt = file.pos(); // Save offset to return to it later
 
-	// Allocate and read generic region pointers and generic regions
-	file.cAllocAndQtRead(stuntElements, stuntElementCount);
-	for (int i = 0; i < stuntElementCount; ++i)
-		file.cAllocAndCustomRead(stuntElements[i], 1);
+	// Allocate and read the generic regions in the pointer table
+	file.allocAndIndirectRead(stuntElements, stuntElementCount);
 
 	file.seek(nextSignatureStunt);
 }
 
-void GenericRegion::read(DataStream& file)
+template <typename Traits>
+void GenericRegion::read(MappedStream<Traits>& file)
 {
 	TriggerRegion::read(file);
 	file >> groupId;
@@ -138,7 +264,8 @@ void GenericRegion::read(DataStream& file)
 	file >> isOneWay;
 }
 
-void Killzone::read(DataStream& file)
+template <typename Traits>
+void Killzone::read(MappedStream<Traits>& file)
 {
 	file >> triggers;
 	file >> triggerCount;
@@ -148,16 +275,15 @@ void Killzone::read(DataStream& file)
 	file.skipIf64(0x4);
 	qint64 nextKillzone = file.pos(); // Save offset to return to it later
 
-	// Allocate and read generic region pointers, generic regions, and region IDs
-	file.cAllocAndQtRead(triggers, triggerCount);
-	for (int i = 0; i < triggerCount; ++i)
-		file.cAllocAndCustomRead(triggers[i], 1);
-	file.cAllocAndQtRead(regionIds, regionIdCount);
+	// Allocate and read the generic regions in the pointer table, and region IDs
+	file.allocAndIndirectRead(triggers, triggerCount);
+	file.allocAndQtRead(regionIds, regionIdCount);
 
 	file.seek(nextKillzone);
 }
 
-void Blackspot::read(DataStream& file)
+template <typename Traits>
+void Blackspot::read(MappedStream<Traits>& file)
 {
 	TriggerRegion::read(file);
 	file >> scoreType;
@@ -165,19 +291,22 @@ void Blackspot::read(DataStream& file)
 	file >> scoreAmount;
 }
 
-void VFXBoxRegion::read(DataStream& file)
+template <typename Traits>
+void VFXBoxRegion::read(MappedStream<Traits>& file)
 {
 	TriggerRegion::read(file);
 }
 
-void RoamingLocation::read(DataStream& file)
+template <typename Traits>
+void RoamingLocation::read(MappedStream<Traits>& file)
 {
 	position.read(file);
 	file >> districtIndex;
 	file.skip(0xF);
 }
 
-void SpawnLocation::read(DataStream& file)
+template <typename Traits>
+void SpawnLocation::read(MappedStream<Traits>& file)
 {
 	position.read(file);
 	direction.read(file);
@@ -185,3 +314,8 @@ void SpawnLocation::read(DataStream& file)
 	file >> type;
 	file.skip(0x7);
 }
+
+// Parsers for each resource layout
+template void TriggerData::read(MappedStream<PCTraits>& file, uint16_t sections);
+template void TriggerData::read(MappedStream<BigEndian32Traits>& file, uint16_t sections);
+template void TriggerData::read(MappedStream<LittleEndian64Traits>& file, uint16_t sections);
@@ -0,0 +1,82 @@
+#include <trigger-index.h>
+
+using namespace BrnTrigger;
+
+// Builds the index from every TriggerRegion in the data
+void TriggerIndex::build(TriggerData& data)
+{
+	int64_t total = (int64_t)data.landmarkCount + data.blackspotCount + data.vfxBoxRegionCount + data.genericRegionCount;
+	for (int i = 0; i < data.signatureStuntCount; ++i)
+		total += data.signatureStunts[i].stuntElementCount;
+	for (int i = 0; i < data.killzoneCount; ++i)
+		total += data.killzones[i].triggerCount;
+
+	// Power of two capacity at no more than half full
+	uint32_t capacity = 16;
+	while (capacity < total * 2)
+		capacity <<= 1;
+	slots.assign(capacity, Slot());
+	mask = capacity - 1;
+	count = 0;
+
+	for (int i = 0; i < data.landmarkCount; ++i)
+		insert(data.landmarks[i].id, Category::landmark);
+	for (int i = 0; i < data.blackspotCount; ++i)
+		insert(data.blackspots[i].id, Category::blackspot);
+	for (int i = 0; i < data.vfxBoxRegionCount; ++i)
+		insert(data.vfxBoxRegions[i].id, Category::vfxBoxRegion);
+	for (int i = 0; i < data.genericRegionCount; ++i)
+		insert(data.genericRegions[i].id, Category::genericRegion);
+	for (int i = 0; i < data.signatureStuntCount; ++i)
+	{
+		for (int j = 0; j < data.signatureStunts[i].stuntElementCount; ++j)
+			insert(data.signatureStunts[i].stuntElements[j].id, Category::stuntElement);
+	}
+	for (int i = 0; i < data.killzoneCount; ++i)
+	{
+		for (int j = 0; j < data.killzones[i].triggerCount; ++j)
+			insert(data.killzones[i].triggers[j].id, Category::killzoneTrigger);
+	}
+}
+
+// Get the categories an ID appears in as a mask of Category values, or 0 if not present
+uint8_t TriggerIndex::find(int32_t id) const
+{
+	if (slots.empty())
+		return 0;
+
+	for (uint32_t i = slotIndex(id); ; i = (i + 1) & mask)
+	{
+		const Slot& slot = slots[i];
+		if (slot.categories == 0)
+			return 0;
+		if (slot.id == id)
+			return slot.categories;
+	}
+}
+
+void TriggerIndex::insert(int32_t id, Category category)
+{
+	for (uint32_t i = slotIndex(id); ; i = (i + 1) & mask)
+	{
+		Slot& slot = slots[i];
+		if (slot.categories == 0)
+		{
+			slot.id = id;
+			slot.categories = (uint8_t)category;
+			count++;
+			return;
+		}
+		if (slot.id == id)
+		{
+			slot.categories |= (uint8_t)category;
+			return;
+		}
+	}
+}
+
+// Fibonacci hashing spreads sequential IDs across the table
+uint32_t TriggerIndex::slotIndex(int32_t id) const
+{
+	return (uint32_t)(((uint64_t)(uint32_t)id * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
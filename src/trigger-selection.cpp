@@ -0,0 +1,472 @@
+#include <trigger-selection.h>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+using namespace BrnTrigger;
+
+namespace
+{
+	const char* fieldNames[] = { "kind", "type", "district", "oneWay", "groupId", "flags", "id", "box" };
+
+	const uint8_t allKinds = (1 << TriggerTable::kindCount) - 1;
+
+	uint8_t kindBit(TriggerTable::Kind kind)
+	{
+		return 1 << (int)kind;
+	}
+
+	// Kinds that are TriggerRegions
+	const uint8_t regionKinds = kindBit(TriggerTable::Kind::landmark) | kindBit(TriggerTable::Kind::blackspot)
+		| kindBit(TriggerTable::Kind::vfxBoxRegion) | kindBit(TriggerTable::Kind::genericRegion);
+
+	// Splits an expression into words and parentheses
+	std::vector<std::string> tokenize(const std::string& expression)
+	{
+		std::vector<std::string> tokens;
+		std::string token;
+		for (char c : expression)
+		{
+			if (std::isspace((unsigned char)c) || c == '(' || c == ')')
+			{
+				if (!token.empty())
+					tokens.push_back(token);
+				token.clear();
+				if (!std::isspace((unsigned char)c))
+					tokens.push_back(std::string(1, c));
+			}
+			else
+				token += c;
+		}
+		if (!token.empty())
+			tokens.push_back(token);
+		return tokens;
+	}
+
+	// Splits a list of values at commas
+	std::vector<std::string> splitValues(const std::string& values)
+	{
+		std::vector<std::string> parts;
+		size_t begin = 0;
+		while (true)
+		{
+			size_t end = values.find(',', begin);
+			parts.push_back(values.substr(begin, end - begin));
+			if (end == std::string::npos)
+				return parts;
+			begin = end + 1;
+		}
+	}
+
+	// Parses a whole string as a number. Returns false if it is not one
+	template <typename T>
+	bool parseNumber(const std::string& text, T& value)
+	{
+		const char* end = text.data() + text.size();
+		auto [next, error] = std::from_chars(text.data(), end, value);
+		return error == std::errc() && next == end && !text.empty();
+	}
+
+	// Finds a name in a list. Returns its index, or -1 if not found
+	template <size_t count>
+	int findName(const char* (&names)[count], const std::string& name)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (name == names[i])
+				return (int)i;
+		}
+		return -1;
+	}
+
+	// Finds a name in a list of count names. Returns its index, or -1 if not found
+	template <typename GetName>
+	int findName(int count, GetName getName, const std::string& name)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			if (name == getName(i))
+				return i;
+		}
+		return -1;
+	}
+
+	// Sets the bits of the rows passing a test. Each word of 64 rows is built
+	// without branches, so compilers can vectorize the tests
+	template <typename Test>
+	void scan(std::vector<uint64_t>& bitmap, int64_t rowCount, Test test)
+	{
+		for (int64_t word = 0; word < (int64_t)bitmap.size(); ++word)
+		{
+			int64_t begin = word * 64;
+			int64_t count = std::min<int64_t>(64, rowCount - begin);
+			uint64_t bits = 0;
+			for (int64_t i = 0; i < count; ++i)
+				bits |= (uint64_t)test(begin + i) << i;
+			bitmap[word] |= bits;
+		}
+	}
+
+	// Sets the bits of the rows whose byte column value is set in a table
+	template <typename T>
+	void scanTable(std::vector<uint64_t>& bitmap, const std::vector<T>& column, const bool (&table)[256])
+	{
+		const uint8_t* values = (const uint8_t*)column.data();
+		scan(bitmap, (int64_t)column.size(), [&](int64_t i) { return table[values[i]]; });
+	}
+
+	// Sets the bits of the rows whose value is within a range
+	void scanRange(std::vector<uint64_t>& bitmap, const std::vector<int32_t>& column, int64_t min, int64_t max)
+	{
+		const int32_t* values = column.data();
+		scan(bitmap, (int64_t)column.size(), [&](int64_t i) { return (values[i] >= min) & (values[i] <= max); });
+	}
+}
+
+// Parses an expression. Returns false and sets error if it is invalid
+bool TriggerSelection::parse(const std::string& expression, std::string& error)
+{
+	nodes.clear();
+	tokens = tokenize(expression);
+	nextToken = 0;
+	if (tokens.empty())
+	{
+		error = "Empty selection";
+		return false;
+	}
+
+	root = parseDisjunction(error);
+	if (root >= 0 && nextToken < tokens.size())
+	{
+		error = "Unexpected " + tokens[nextToken];
+		root = -1;
+	}
+	tokens.clear();
+	return root >= 0;
+}
+
+// Parses conditions joined by or. Returns the node, or -1 on error
+int TriggerSelection::parseDisjunction(std::string& error)
+{
+	int left = parseConjunction(error);
+	while (left >= 0 && nextToken < tokens.size() && tokens[nextToken] == "or")
+	{
+		nextToken++;
+		int right = parseConjunction(error);
+		if (right < 0)
+			return -1;
+
+		Node node;
+		node.op = Node::Op::disjunction;
+		node.left = left;
+		node.right = right;
+		left = addNode(node);
+	}
+	return left;
+}
+
+// Parses conditions joined by and, or next to each other. Returns the node, or -1 on error
+int TriggerSelection::parseConjunction(std::string& error)
+{
+	int left = parseNegation(error);
+	while (left >= 0 && nextToken < tokens.size() && tokens[nextToken] != "or" && tokens[nextToken] != ")")
+	{
+		if (tokens[nextToken] == "and")
+			nextToken++;
+		int right = parseNegation(error);
+		if (right < 0)
+			return -1;
+
+		Node node;
+		node.op = Node::Op::conjunction;
+		node.left = left;
+		node.right = right;
+		left = addNode(node);
+	}
+	return left;
+}
+
+// Parses a condition, a negated condition, or an expression in parentheses.
+// Returns the node, or -1 on error
+int TriggerSelection::parseNegation(std::string& error)
+{
+	if (nextToken >= tokens.size())
+	{
+		error = "Expected a condition at the end";
+		return -1;
+	}
+
+	std::string token = tokens[nextToken++];
+	if (token == "not")
+	{
+		int negated = parseNegation(error);
+		if (negated < 0)
+			return -1;
+
+		Node node;
+		node.op = Node::Op::negation;
+		node.left = negated;
+		return addNode(node);
+	}
+
+	if (token == "(")
+	{
+		int inner = parseDisjunction(error);
+		if (inner < 0)
+			return -1;
+		if (nextToken >= tokens.size() || tokens[nextToken] != ")")
+		{
+			error = "Expected )";
+			return -1;
+		}
+		nextToken++;
+		return inner;
+	}
+
+	return parseCondition(token, error);
+}
+
+// Parses a field=values condition. Returns the node, or -1 on error
+int TriggerSelection::parseCondition(const std::string& token, std::string& error)
+{
+	size_t equals = token.find('=');
+	if (equals == std::string::npos)
+	{
+		error = "Expected a condition instead of " + token;
+		return -1;
+	}
+
+	Node node;
+	int field = findName(fieldNames, token.substr(0, equals));
+	if (field < 0)
+	{
+		error = "Unknown field " + token.substr(0, equals);
+		return -1;
+	}
+	node.field = (Field)field;
+
+	std::vector<std::string> values = splitValues(token.substr(equals + 1));
+	if (node.field == Field::box)
+	{
+		// Minimum then maximum corner
+		if (values.size() != 6)
+		{
+			error = "Expected six numbers in " + token;
+			return -1;
+		}
+		for (int i = 0; i < 6; ++i)
+		{
+			if (!parseNumber(values[i], node.box[i]))
+			{
+				error = "Invalid number " + values[i] + " in " + token;
+				return -1;
+			}
+		}
+		return addNode(node);
+	}
+
+	for (const std::string& value : values)
+	{
+		// Names of kinds and generic region types
+		int name = -1;
+		if (node.field == Field::kind)
+			name = findName(TriggerTable::kindCount, [](int i) { return TriggerTable::getKindName((TriggerTable::Kind)i); }, value);
+		else if (node.field == Field::type)
+			name = findName(TriggerTable::typeCount, [](int i) { return TriggerTable::getTypeName((uint8_t)i); }, value);
+		if (name >= 0)
+		{
+			node.ranges.push_back({ name, name });
+			continue;
+		}
+
+		// Numbers and min..max ranges
+		Range range;
+		size_t dots = value.find("..");
+		bool valid = node.field != Field::kind;
+		if (dots == std::string::npos)
+		{
+			valid = valid && parseNumber(value, range.min);
+			range.max = range.min;
+		}
+		else
+		{
+			valid = valid && parseNumber(value.substr(0, dots), range.min)
+				&& parseNumber(value.substr(dots + 2), range.max);
+		}
+		if (!valid)
+		{
+			error = "Invalid value " + value + " in " + token;
+			return -1;
+		}
+		node.ranges.push_back(range);
+	}
+
+	return addNode(node);
+}
+
+int TriggerSelection::addNode(Node node)
+{
+	nodes.push_back(std::move(node));
+	return (int)nodes.size() - 1;
+}
+
+// Get the mask of TriggerData::Section values holding the triggers the
+// expression can select
+uint16_t TriggerSelection::getSections() const
+{
+	uint8_t kinds = root >= 0 ? getKinds(root) : 0;
+	uint16_t sections = 0;
+	for (int kind = 0; kind < TriggerTable::kindCount; ++kind)
+	{
+		if (kinds & (1 << kind))
+			sections |= (uint16_t)TriggerTable::getSection((TriggerTable::Kind)kind);
+	}
+	return sections;
+}
+
+// Get the mask of kinds of triggers a node can select, as bits of TriggerTable::Kind values
+uint8_t TriggerSelection::getKinds(int index) const
+{
+	const Node& node = nodes[index];
+	switch (node.op)
+	{
+	case Node::Op::conjunction:
+		return getKinds(node.left) & getKinds(node.right);
+	case Node::Op::disjunction:
+		return getKinds(node.left) | getKinds(node.right);
+	case Node::Op::negation:
+		return allKinds;
+	case Node::Op::condition:
+		break;
+	}
+
+	switch (node.field)
+	{
+	case Field::kind:
+	{
+		uint8_t kinds = 0;
+		for (const Range& range : node.ranges)
+		{
+			for (int64_t kind = range.min; kind <= range.max; ++kind)
+				kinds |= 1 << kind;
+		}
+		return kinds;
+	}
+	case Field::type:
+	case Field::oneWay:
+	case Field::groupId:
+		return kindBit(TriggerTable::Kind::genericRegion);
+	case Field::district:
+		return kindBit(TriggerTable::Kind::landmark) | kindBit(TriggerTable::Kind::roamingLocation);
+	case Field::flags:
+	case Field::id:
+		return regionKinds;
+	case Field::box:
+		break;
+	}
+	return allKinds;
+}
+
+// Get a bitmap of the selected rows. Row i is bit i % 64 of word i / 64
+std::vector<uint64_t> TriggerSelection::evaluate(const TriggerTable& table) const
+{
+	if (root < 0)
+		return std::vector<uint64_t>((table.size() + 63) / 64, 0);
+	return evaluateNode(table, root);
+}
+
+std::vector<uint64_t> TriggerSelection::evaluateNode(const TriggerTable& table, int index) const
+{
+	const Node& node = nodes[index];
+	int64_t rowCount = table.size();
+	std::vector<uint64_t> bitmap((rowCount + 63) / 64, 0);
+
+	if (node.op != Node::Op::condition)
+	{
+		bitmap = evaluateNode(table, node.left);
+		if (node.op == Node::Op::negation)
+		{
+			for (uint64_t& word : bitmap)
+				word = ~word;
+
+			// Bits past the last row stay clear
+			if (rowCount % 64 != 0)
+				bitmap.back() &= (1ULL << (rowCount % 64)) - 1;
+			return bitmap;
+		}
+
+		std::vector<uint64_t> right = evaluateNode(table, node.right);
+		for (size_t i = 0; i < bitmap.size(); ++i)
+		{
+			if (node.op == Node::Op::conjunction)
+				bitmap[i] &= right[i];
+			else
+				bitmap[i] |= right[i];
+		}
+		return bitmap;
+	}
+
+	// Byte columns are checked against a table of the values in the ranges
+	bool values[256] = {};
+	for (const Range& range : node.ranges)
+	{
+		for (int64_t value = std::max<int64_t>(range.min, 0); value <= std::min<int64_t>(range.max, 255); ++value)
+			values[value] = true;
+	}
+
+	switch (node.field)
+	{
+	case Field::kind:
+		scanTable(bitmap, table.kind, values);
+		break;
+	case Field::type:
+		scanTable(bitmap, table.type, values);
+		break;
+	case Field::district:
+		scanTable(bitmap, table.district, values);
+		break;
+	case Field::oneWay:
+		scanTable(bitmap, table.oneWay, values);
+		break;
+	case Field::flags:
+		scanTable(bitmap, table.flags, values);
+		break;
+	case Field::groupId:
+		for (const Range& range : node.ranges)
+			scanRange(bitmap, table.groupId, range.min, range.max);
+		break;
+	case Field::id:
+		for (const Range& range : node.ranges)
+			scanRange(bitmap, table.id, range.min, range.max);
+		break;
+	case Field::box:
+	{
+		const float* box = node.box;
+		const float* x = table.positionX.data();
+		const float* y = table.positionY.data();
+		const float* z = table.positionZ.data();
+		scan(bitmap, rowCount, [&](int64_t i)
+		{
+			return (x[i] >= box[0]) & (x[i] <= box[3]) & (y[i] >= box[1]) & (y[i] <= box[4])
+				& (z[i] >= box[2]) & (z[i] <= box[5]);
+		});
+		break;
+	}
+	}
+
+	// Fields only some kinds have don't select the others
+	uint8_t kinds = getKinds(index);
+	if (kinds != allKinds)
+	{
+		bool kindValues[256] = {};
+		for (int kind = 0; kind < TriggerTable::kindCount; ++kind)
+			kindValues[kind] = (kinds >> kind) & 1;
+		std::vector<uint64_t> kindBitmap(bitmap.size(), 0);
+		scanTable(kindBitmap, table.kind, kindValues);
+		for (size_t i = 0; i < bitmap.size(); ++i)
+			bitmap[i] &= kindBitmap[i];
+	}
+
+	return bitmap;
+}
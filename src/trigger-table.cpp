@@ -0,0 +1,129 @@
+#include <trigger-table.h>
+
+using namespace BrnTrigger;
+
+namespace
+{
+	// In Kind order
+	const char* kindNames[] = {
+		"landmark", "blackspot", "vfxBoxRegion", "genericRegion", "roamingLocation", "spawnLocation"
+	};
+
+	// In GenericRegion::Type order
+	const char* typeNames[] = {
+		"junkyard", "gasStation", "autoRepair", "paintShop", "carPark", "signatureTakedown", "killzone",
+		"jump", "smash", "signatureCrash", "signatureCrashCamera", "roadLimit", "overdriveBoost",
+		"overdriveStrength", "overdriveSpeed", "overdriveControl", "tireShop", "tuningShop",
+		"pictureParadise", "tunnel", "overpass", "bridge", "warehouse", "largeOverheadObject",
+		"narrowAlley", "passTunnel", "passOverpass", "passBridge", "passWarehouse",
+		"passLargeOverheadObject", "passNarrowAlley", "ramp"
+	};
+	static_assert(sizeof(typeNames) / sizeof(typeNames[0]) == TriggerTable::typeCount);
+}
+
+// Adds a row for every trigger in the sections that were read
+void TriggerTable::build(TriggerData& data)
+{
+	int64_t count = 0;
+	if (data.hasSection(TriggerData::Section::landmarks))
+		count += data.landmarkCount;
+	if (data.hasSection(TriggerData::Section::blackspots))
+		count += data.blackspotCount;
+	if (data.hasSection(TriggerData::Section::vfxBoxRegions))
+		count += data.vfxBoxRegionCount;
+	if (data.hasSection(TriggerData::Section::genericRegions))
+		count += data.genericRegionCount;
+	if (data.hasSection(TriggerData::Section::roamingLocations))
+		count += data.roamingLocationCount;
+	if (data.hasSection(TriggerData::Section::spawnLocations))
+		count += data.spawnLocationCount;
+
+	*this = TriggerTable();
+	kind.reserve(count);
+	index.reserve(count);
+	id.reserve(count);
+	type.reserve(count);
+	district.reserve(count);
+	oneWay.reserve(count);
+	groupId.reserve(count);
+	flags.reserve(count);
+	positionX.reserve(count);
+	positionY.reserve(count);
+	positionZ.reserve(count);
+
+	for (int i = 0; data.hasSection(TriggerData::Section::landmarks) && i < data.landmarkCount; ++i)
+	{
+		const Landmark& landmark = data.landmarks[i];
+		addRow(Kind::landmark, i, &landmark, Vector3());
+		district.back() = landmark.district;
+	}
+	for (int i = 0; data.hasSection(TriggerData::Section::blackspots) && i < data.blackspotCount; ++i)
+		addRow(Kind::blackspot, i, &data.blackspots[i], Vector3());
+	for (int i = 0; data.hasSection(TriggerData::Section::vfxBoxRegions) && i < data.vfxBoxRegionCount; ++i)
+		addRow(Kind::vfxBoxRegion, i, &data.vfxBoxRegions[i], Vector3());
+	for (int i = 0; data.hasSection(TriggerData::Section::genericRegions) && i < data.genericRegionCount; ++i)
+	{
+		const GenericRegion& region = data.genericRegions[i];
+		addRow(Kind::genericRegion, i, &region, Vector3());
+		type.back() = (uint8_t)region.type;
+		oneWay.back() = (uint8_t)region.isOneWay;
+		groupId.back() = region.groupId;
+	}
+	for (int i = 0; data.hasSection(TriggerData::Section::roamingLocations) && i < data.roamingLocationCount; ++i)
+	{
+		addRow(Kind::roamingLocation, i, nullptr, data.roamingLocations[i].position);
+		district.back() = data.roamingLocations[i].districtIndex;
+	}
+	for (int i = 0; data.hasSection(TriggerData::Section::spawnLocations) && i < data.spawnLocationCount; ++i)
+		addRow(Kind::spawnLocation, i, nullptr, data.spawnLocations[i].position);
+}
+
+// Get the TriggerData section holding a kind of trigger
+TriggerData::Section TriggerTable::getSection(Kind kind)
+{
+	switch (kind)
+	{
+	case Kind::landmark:
+		return TriggerData::Section::landmarks;
+	case Kind::blackspot:
+		return TriggerData::Section::blackspots;
+	case Kind::vfxBoxRegion:
+		return TriggerData::Section::vfxBoxRegions;
+	case Kind::genericRegion:
+		break;
+	case Kind::roamingLocation:
+		return TriggerData::Section::roamingLocations;
+	case Kind::spawnLocation:
+		return TriggerData::Section::spawnLocations;
+	}
+	return TriggerData::Section::genericRegions;
+}
+
+// Get the name of a kind of trigger, as used in selections
+const char* TriggerTable::getKindName(Kind kind)
+{
+	return kindNames[(int)kind];
+}
+
+// Get the name of a GenericRegion::Type, as used in selections, or nullptr if unknown
+const char* TriggerTable::getTypeName(uint8_t type)
+{
+	return type < typeCount ? typeNames[type] : nullptr;
+}
+
+// Adds a row with the attributes every kind has. Box triggers are placed at the
+// center of their box, and locations at their position
+void TriggerTable::addRow(Kind kind, int32_t index, const TriggerRegion* region, const Vector3& position)
+{
+	this->kind.push_back(kind);
+	this->index.push_back(index);
+	id.push_back(region != nullptr ? region->id : 0);
+	type.push_back(0);
+	district.push_back(0);
+	oneWay.push_back(0);
+	groupId.push_back(0);
+	flags.push_back(region != nullptr ? region->unk0 : 0);
+	positionX.push_back(region != nullptr ? region->boxRegion.positionX : position.x);
+	positionY.push_back(region != nullptr ? region->boxRegion.positionY : position.y);
+	positionZ.push_back(region != nullptr ? region->boxRegion.positionZ : position.z);
+}
@@ -12,11 +12,17 @@ Vector3::Vector3(float x, float y, float z, bool isVpu)
 	
 }
 
-void Vector3::read(DataStream& stream)
+template <typename Traits>
+void Vector3::read(MappedStream<Traits>& stream)
 {
-	stream >> x;
-	stream >> y;
-	stream >> z;
+	const uchar* data = stream.take(0xC);
+	if (data == nullptr)
+		return;
+	float values[3];
+	decodeFloats<Traits>(data, values, 3);
+	x = values[0];
+	y = values[1];
+	z = values[2];
 	if (isVpu)
 		stream.skip(0x4);
 }
@@ -41,12 +47,18 @@ Vector4::Vector4(float x, float y, float z, float w)
 	
 }
 
-void Vector4::read(DataStream& stream)
+template <typename Traits>
+void Vector4::read(MappedStream<Traits>& stream)
 {
-	stream >> x;
-	stream >> y;
-	stream >> z;
-	stream >> w;
+	const uchar* data = stream.take(0x10);
+	if (data == nullptr)
+		return;
+	float values[4];
+	decodeFloats<Traits>(data, values, 4);
+	x = values[0];
+	y = values[1];
+	z = values[2];
+	w = values[3];
 }
 
 void Vector4::write(DataStream& stream)
@@ -56,3 +68,10 @@ void Vector4::write(DataStream& stream)
 	stream << z;
 	stream << w;
 }
+
+template void Vector3::read(MappedStream<PCTraits>& stream);
+template void Vector3::read(MappedStream<BigEndian32Traits>& stream);
+template void Vector3::read(MappedStream<LittleEndian64Traits>& stream);
+template void Vector4::read(MappedStream<PCTraits>& stream);
+template void Vector4::read(MappedStream<BigEndian32Traits>& stream);
+template void Vector4::read(MappedStream<LittleEndian64Traits>& stream);
@@ -0,0 +1,279 @@
+#include <watch-converter.h>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QTimer>
+
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+namespace
+{
+	// Milliseconds without further changes before files are converted,
+	// so a save written in several steps is converted once
+	const int settleTime = 10;
+}
+
+WatchConverter::WatchConverter(int argc, char* argv[])
+{
+	result = getArgs(argc, argv);
+	if (result != 0)
+		return;
+
+	result = readJobs();
+	if (result != 0)
+		return;
+
+	result = watch(argc, argv);
+}
+
+int WatchConverter::getArgs(int argc, char* argv[])
+{
+	// Ensure minimum argument count is reached
+	if (argc < minArgCount)
+	{
+		showUsage();
+		return 1;
+	}
+
+	// Options apply to every file unless a manifest line overrides them
+	QStringList args;
+	for (int i = 2; i < argc - 2; ++i)
+	{
+		// Set worker thread count
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc - 2)
+		{
+			threadCount = atoi(argv[i + 1]);
+			i++;
+		}
+		else
+			args.append(QString::fromLocal8Bit(argv[i]));
+	}
+	int parseResult = defaults.parse(args, std::cerr);
+	if (parseResult != 0)
+		return parseResult;
+
+	source = QString::fromLocal8Bit(argv[argc - 2]);
+	outDir = QString::fromLocal8Bit(argv[argc - 1]);
+
+	// Check input exists
+	if (!QFileInfo::exists(source))
+	{
+		std::cerr << "Invalid manifest or input directory";
+		return 2;
+	}
+
+	// Check output is or can be made a directory
+	QFileInfo outputInfo(outDir);
+	if ((outputInfo.exists() && !outputInfo.isDir()) || !QDir().mkpath(outDir))
+	{
+		std::cerr << "Output location is not a directory and cannot be created";
+		return 3;
+	}
+
+	return 0;
+}
+
+void WatchConverter::showUsage()
+{
+	std::cout << "Usage: TriggersToGLTF --watch [options] <manifest or input directory> <output directory>\n\n"
+		<< "Converts files like --batch, then keeps running and converts each file again\n"
+		<< "whenever its input or savegame changes. Parsed inputs are kept in memory, so\n"
+		<< "only what changed is read again. Stop with Ctrl+C.\n\n"
+		<< "Options:\n"
+		<< " -j   Number of files converted at once. Default: one per hardware thread\n"
+		<< " --stats  Directory receiving a report per file, named after its output.\n"
+		<< " Any single file option, applied to every file. Manifest lines may override them.";
+}
+
+// Reads the files to convert and what each of them reads. Returns 0 on success
+int WatchConverter::readJobs()
+{
+	std::vector<BatchConverter::Job> batchJobs;
+	int readResult = BatchConverter::readJobs(source, outDir, defaults, batchJobs);
+	if (readResult != 0)
+		return readResult;
+
+	// Manifest lines with invalid options are reported and not watched
+	for (const BatchConverter::Job& batchJob : batchJobs)
+	{
+		if (batchJob.result != 0)
+		{
+			std::cerr << batchJob.options.inFileName << ": " << batchJob.error << "\n";
+			continue;
+		}
+
+		Job job;
+		job.options = batchJob.options;
+		job.err.reset(new std::ostringstream);
+		jobs.push_back(std::move(job));
+		addWatchedFile(QString::fromStdString(batchJob.options.inFileName), jobs.size() - 1, false);
+		if (!batchJob.options.profileFileName.empty())
+			addWatchedFile(QString::fromStdString(batchJob.options.profileFileName), jobs.size() - 1, true);
+	}
+
+	if (jobs.empty())
+	{
+		std::cerr << "No files to watch";
+		return 2;
+	}
+
+	return 0;
+}
+
+void WatchConverter::addWatchedFile(const QString& path, size_t job, bool savegame)
+{
+	WatchedFile& file = files[QFileInfo(path).absoluteFilePath()];
+	if (savegame)
+		file.savegameOf.push_back(job);
+	else
+		file.inputOf.push_back(job);
+}
+
+// Reads the modification time and size of a file.
+// Returns true if it exists and changed since last read
+bool WatchConverter::updateFile(const QString& path, WatchedFile& file)
+{
+	QFileInfo info(path);
+	if (!info.exists())
+	{
+		// Converted again once it is back
+		file.size = -1;
+		return false;
+	}
+
+	QDateTime lastModified = info.lastModified();
+	qint64 size = info.size();
+	if (lastModified == file.lastModified && size == file.size)
+		return false;
+
+	file.lastModified = lastModified;
+	file.size = size;
+	return true;
+}
+
+int WatchConverter::watch(int argc, char* argv[])
+{
+	QCoreApplication app(argc, argv);
+	pool.reset(new ThreadPool(threadCount));
+
+	// Every file is converted once before watching
+	for (auto& [path, file] : files)
+		updateFile(path, file);
+	firstChange = std::chrono::steady_clock::now();
+	for (Job& job : jobs)
+		job.inputChanged = true;
+	convertChanged();
+
+	// Directories are watched too, since editors often save by replacing a file,
+	// which ends the watch on it
+	QFileSystemWatcher watcher;
+	QStringList dirs;
+	for (const auto& [path, file] : files)
+	{
+		watcher.addPath(path);
+		QString dir = QFileInfo(path).absolutePath();
+		if (!dirs.contains(dir))
+			dirs.append(dir);
+	}
+	watcher.addPaths(dirs);
+
+	QTimer settleTimer;
+	settleTimer.setSingleShot(true);
+	settleTimer.setInterval(settleTime);
+
+	auto onChange = [this, &settleTimer]()
+	{
+		if (!changePending)
+		{
+			changePending = true;
+			firstChange = std::chrono::steady_clock::now();
+		}
+		settleTimer.start();
+	};
+	QObject::connect(&watcher, &QFileSystemWatcher::fileChanged, onChange);
+	QObject::connect(&watcher, &QFileSystemWatcher::directoryChanged, onChange);
+	QObject::connect(&settleTimer, &QTimer::timeout, [this, &watcher]()
+	{
+		// Replaced files are watched again
+		QStringList watchedFiles = watcher.files();
+		for (const auto& [path, file] : files)
+		{
+			if (!watchedFiles.contains(path) && QFileInfo::exists(path))
+				watcher.addPath(path);
+		}
+		convertChanged();
+	});
+
+	std::cout << "Watching " << files.size() << " files for " << jobs.size() << " conversions" << std::endl;
+	return app.exec();
+}
+
+// Converts the files whose input or savegame changed, in parallel
+void WatchConverter::convertChanged()
+{
+	std::chrono::steady_clock::time_point start = firstChange;
+	changePending = false;
+
+	for (auto& [path, file] : files)
+	{
+		if (!updateFile(path, file))
+			continue;
+		for (size_t job : file.inputOf)
+			jobs[job].inputChanged = true;
+		for (size_t job : file.savegameOf)
+			jobs[job].savegameChanged = true;
+	}
+
+	std::vector<Job*> changed;
+	for (Job& job : jobs)
+	{
+		if (job.inputChanged || job.savegameChanged)
+			changed.push_back(&job);
+	}
+
+	for (Job* job : changed)
+	{
+		pool->submit([this, job]()
+		{
+			job->err->str("");
+			try
+			{
+				if (job->converter == nullptr)
+					job->converter.reset(new Converter(job->options, *job->err, pool.get()));
+				else
+					job->converter->reconvert(job->inputChanged);
+			}
+			catch (const std::exception& e)
+			{
+				// The next change starts over with a new converter
+				*job->err << e.what();
+				job->converter.reset();
+			}
+		});
+	}
+	pool->wait();
+
+	for (Job* job : changed)
+	{
+		report(*job, start);
+		job->inputChanged = false;
+		job->savegameChanged = false;
+	}
+}
+
+// Prints the time from the first change to the end of a conversion, or its error
+void WatchConverter::report(const Job& job, std::chrono::steady_clock::time_point start)
+{
+	if (job.converter == nullptr || job.converter->result != 0)
+	{
+		std::cerr << job.options.inFileName << ": " << job.err->str() << std::endl;
+		return;
+	}
+
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+	std::cout << "Converted " << job.options.inFileName << " in " << elapsed.count() << " ms" << std::endl;
+}